@@ -0,0 +1,75 @@
+#include "avl_tree.h"
+#include "bench_common.h"
+
+// aggregate_range against an iterator scan for ranges of growing width.
+// Needs a build with aggregates: make clean && make AGGREGATE=1 bench
+#ifdef TREE_AGGREGATE
+
+static TreeAggregate scan_range(AVLTree *tree, int lo, int hi)
+{
+    TreeAggregate agg = aggregate_empty();
+    TreeIterator it;
+    AVLNode *node;
+    tree_iter_seek(&it, tree, lo);
+    while ((node = tree_iter_next(&it)) != NULL && node->key <= hi)
+        agg = aggregate_combine(agg, aggregate_of(node->key));
+    return agg;
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = bench_arg_size(argc, argv, 1000000);
+    uint64_t rng = 31;
+
+    int *keys = (int *)malloc(n * sizeof(int));
+    for (size_t i = 0; i < n; i++)
+        keys[i] = (int)(2 * i);
+    bench_shuffle(keys, n, &rng);
+
+    AVLTree *tree = create_tree(ENGINE_AVL);
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < n; i++)
+        tree_insert(tree, keys[i]);
+    double insert_ns = (double)(bench_now_ns() - start) / (double)n;
+    printf("%zu keys, %zu-byte nodes, %.1f ns per random insert\n", n, sizeof(AVLNode), insert_ns);
+    printf("%12s %12s %12s %9s\n", "range keys", "aggregate", "scan", "speedup");
+
+    size_t widths[] = {16, 1024, n / 100, n / 10, n};
+    for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); w++)
+    {
+        size_t width = widths[w] ? widths[w] : 1;
+        size_t queries = 2000000 / width + 10;
+        int *lo = (int *)malloc(queries * sizeof(int));
+        for (size_t q = 0; q < queries; q++)
+            lo[q] = (int)(2 * (bench_rand(&rng) % (n - width + 1)));
+
+        size_t checked = 0;
+        start = bench_now_ns();
+        for (size_t q = 0; q < queries; q++)
+            checked += aggregate_range(tree, lo[q], lo[q] + 2 * (int)width - 1).count;
+        double agg_ns = (double)(bench_now_ns() - start) / (double)queries;
+
+        start = bench_now_ns();
+        for (size_t q = 0; q < queries; q++)
+            checked -= scan_range(tree, lo[q], lo[q] + 2 * (int)width - 1).count;
+        double scan_ns = (double)(bench_now_ns() - start) / (double)queries;
+
+        printf("%12zu %9.0f ns %9.0f ns %8.1fx%s\n", width, agg_ns, scan_ns, scan_ns / agg_ns,
+               checked ? "  (mismatch)" : "");
+        free(lo);
+    }
+
+    destroy_tree(tree);
+    free(keys);
+    return 0;
+}
+
+#else
+
+int main(void)
+{
+    printf("bench_aggregate needs subtree aggregates: make clean && make AGGREGATE=1 bench\n");
+    return 0;
+}
+
+#endif
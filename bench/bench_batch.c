@@ -0,0 +1,55 @@
+#include "avl_tree.h"
+#include "bench_common.h"
+
+int main(int argc, char **argv)
+{
+    size_t n = bench_arg_size(argc, argv, (size_t)1 << 22);
+    size_t queries = argc > 2 ? (size_t)atoll(argv[2]) : (size_t)1 << 21;
+    uint64_t rng = 0xC0FFEEull;
+
+    // Random insertion order scatters nodes across the heap
+    int *keys = (int *)malloc(n * sizeof(int));
+    for (size_t i = 0; i < n; i++)
+        keys[i] = (int)(i * 2);
+    bench_shuffle(keys, n, &rng);
+
+    AVLTree *tree = create_tree(ENGINE_AVL);
+    for (size_t i = 0; i < n; i++)
+        tree_insert(tree, keys[i]);
+
+    // About half of the queries hit (even keys), half miss (odd keys)
+    int *probe = (int *)malloc(queries * sizeof(int));
+    for (size_t i = 0; i < queries; i++)
+        probe[i] = (int)(bench_rand(&rng) % (2 * n));
+
+    AVLNode **results = (AVLNode **)malloc(queries * sizeof(AVLNode *));
+
+    printf("Batched lookup, n = %zu (%.0f MB of nodes), %zu queries\n",
+           n, n * sizeof(AVLNode) / 1048576.0, queries);
+
+    for (int round = 0; round < 3; round++)
+    {
+        size_t hits_loop = 0, hits_batch = 0;
+
+        uint64_t start = bench_now_ns();
+        for (size_t i = 0; i < queries; i++)
+            hits_loop += search_node(tree->root, probe[i]) != NULL;
+        double loop_ns = (double)(bench_now_ns() - start) / queries;
+
+        start = bench_now_ns();
+        search_batch(tree->root, probe, queries, results);
+        double batch_ns = (double)(bench_now_ns() - start) / queries;
+        for (size_t i = 0; i < queries; i++)
+            hits_batch += results[i] != NULL;
+
+        printf("round %d | search_node %7.1f ns/key (%5.2f M/s) | search_batch %7.1f ns/key (%5.2f M/s) | %.2fx%s\n",
+               round, loop_ns, 1e3 / loop_ns, batch_ns, 1e3 / batch_ns, loop_ns / batch_ns,
+               hits_loop == hits_batch ? "" : "  MISMATCH");
+    }
+
+    free(results);
+    free(probe);
+    free(keys);
+    destroy_tree(tree);
+    return 0;
+}
\ No newline at end of file
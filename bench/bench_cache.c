@@ -0,0 +1,103 @@
+#include "avl_tree.h"
+#include "key_cache.h"
+#include "bench_common.h"
+
+// Bounded-cache mode: a skewed read-through workload against an unbounded
+// tree and capped ones, then TTL expiry driven by a simulated clock
+static uint64_t g_clock_ms;
+
+static uint64_t bench_clock(void)
+{
+    return g_clock_ms;
+}
+
+// Skewed key: a few hot keys, a long tail of cold ones
+static int skewed_key(uint64_t *rng, size_t universe)
+{
+    uint64_t r = bench_rand(rng);
+    size_t span = universe >> (r % 16);
+    return (int)((r >> 8) % (span ? span : 1));
+}
+
+// Look each key up and insert it on a miss; returns ns per request
+static double run(AVLTree *tree, size_t requests, size_t universe, size_t *hits)
+{
+    uint64_t rng = 77;
+    *hits = 0;
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < requests; i++)
+    {
+        int key = skewed_key(&rng, universe);
+        if (tree_search(tree, key))
+            (*hits)++;
+        else
+            tree_insert(tree, key);
+    }
+    return (double)(bench_now_ns() - start) / (double)requests;
+}
+
+static void report(const char *label, AVLTree *tree, size_t requests, size_t universe)
+{
+    size_t hits;
+    double ns = run(tree, requests, universe, &hits);
+    TreeMemory mem;
+    tree_memory(tree, &mem);
+    unsigned long evictions = tree->cache ? tree->cache->evictions : 0;
+    printf("%-18s %8.1f ns %7.1f%% %9zu %9.1f %10lu\n", label, ns, 100.0 * (double)hits / (double)requests,
+           tree->size, (double)(mem.reserved_bytes + mem.handle_bytes) / 1048576.0, evictions);
+}
+
+int main(int argc, char **argv)
+{
+    size_t requests = bench_arg_size(argc, argv, 2000000);
+    size_t universe = 4 * requests;
+
+    printf("%zu read-through requests over %zu keys\n", requests, universe);
+    printf("%-18s %11s %8s %9s %9s %10s\n", "", "per req", "hits", "keys", "MB", "evictions");
+
+    AVLTree *tree = create_tree(ENGINE_AVL);
+    report("unbounded", tree, requests, universe);
+    destroy_tree(tree);
+
+    size_t limits[] = {1u << 14, 1u << 17};
+    for (size_t i = 0; i < sizeof(limits) / sizeof(limits[0]); i++)
+    {
+        char label[32];
+        snprintf(label, sizeof(label), "LRU %zu keys", limits[i]);
+        tree = create_tree(ENGINE_AVL);
+        CacheConfig config = {limits[i], 0, 0, NULL};
+        tree_enable_cache(tree, &config);
+        report(label, tree, requests, universe);
+        destroy_tree(tree);
+    }
+
+    tree = create_tree(ENGINE_AVL);
+    CacheConfig config = {0, 4u << 20, 0, NULL};
+    tree_enable_cache(tree, &config);
+    report("LRU 4 MB", tree, requests, universe);
+    destroy_tree(tree);
+
+    // One write per simulated millisecond with a 10 s TTL: expiry keeps the
+    // tree at the last 10000 writes, sweeping as it goes
+    tree = create_tree(ENGINE_AVL);
+    CacheConfig ttl = {0, 0, 10000, bench_clock};
+    tree_enable_cache(tree, &ttl);
+    uint64_t rng = 5;
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < requests; i++)
+    {
+        g_clock_ms++;
+        tree_insert(tree, (int)(bench_rand(&rng) % universe));
+    }
+    double ns = (double)(bench_now_ns() - start) / (double)requests;
+    printf("TTL 10 s, 1 write/ms: %.1f ns per insert, %zu keys live, %lu expired\n", ns, tree->size,
+           tree->cache->expirations);
+
+    // A pause, then a bulk sweep of everything that expired meanwhile
+    g_clock_ms += 5000;
+    start = bench_now_ns();
+    size_t swept = tree_cache_sweep(tree, (size_t)-1);
+    printf("sweep after a 5 s pause: %zu keys in %.2f ms\n", swept, (double)(bench_now_ns() - start) / 1e6);
+    destroy_tree(tree);
+    return 0;
+}
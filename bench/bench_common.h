@@ -0,0 +1,52 @@
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Wall-clock time in nanoseconds
+static inline uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// xorshift64* generator, deterministic per seed
+static inline uint64_t bench_rand(uint64_t *state)
+{
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1Dull;
+}
+
+// Fisher-Yates shuffle of an int array
+static inline void bench_shuffle(int *keys, size_t n, uint64_t *state)
+{
+    for (size_t i = n; i > 1; i--)
+    {
+        size_t j = (size_t)(bench_rand(state) % i);
+        int tmp = keys[i - 1];
+        keys[i - 1] = keys[j];
+        keys[j] = tmp;
+    }
+}
+
+// Size argument helper: bench [n]
+static inline size_t bench_arg_size(int argc, char **argv, size_t fallback)
+{
+    if (argc > 1)
+    {
+        long long n = atoll(argv[1]);
+        if (n > 0)
+            return (size_t)n;
+    }
+    return fallback;
+}
+
+#endif // BENCH_COMMON_H
\ No newline at end of file
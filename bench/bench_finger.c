@@ -0,0 +1,105 @@
+#include "finger.h"
+#include "bench_common.h"
+
+typedef enum
+{
+    PATTERN_SEQUENTIAL,
+    PATTERN_NEAR,
+    PATTERN_RANDOM
+} KeyPattern;
+
+static const char *pattern_names[] = {"sequential", "near-seq", "random"};
+
+// Key stream for a pattern: ascending, ascending with +/-32 jitter, uniform
+static void fill_keys(int *keys, size_t n, KeyPattern pattern, uint64_t *rng)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        if (pattern == PATTERN_SEQUENTIAL)
+            keys[i] = (int)(i * 4);
+        else if (pattern == PATTERN_NEAR)
+            keys[i] = (int)(i * 4) + (int)(bench_rand(rng) % 65) - 32;
+        else
+            keys[i] = (int)(bench_rand(rng) % (4 * n));
+    }
+}
+
+static void bench_inserts(const int *keys, size_t n, KeyPattern pattern)
+{
+    AVLTree *root_tree = create_tree(ENGINE_AVL);
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < n; i++)
+        tree_insert(root_tree, keys[i]);
+    double root_ns = (double)(bench_now_ns() - start) / n;
+
+    AVLTree *finger_tree = create_tree(ENGINE_AVL);
+    TreeFinger finger;
+    finger_init(&finger, finger_tree);
+    start = bench_now_ns();
+    for (size_t i = 0; i < n; i++)
+        finger_insert(&finger, keys[i]);
+    double finger_ns = (double)(bench_now_ns() - start) / n;
+
+    printf("insert %-10s | root %7.1f ns | finger %7.1f ns | %.2fx%s\n",
+           pattern_names[pattern], root_ns, finger_ns, root_ns / finger_ns,
+           root_tree->size == finger_tree->size ? "" : "  MISMATCH");
+
+    destroy_tree(root_tree);
+    destroy_tree(finger_tree);
+}
+
+static void bench_lookups(AVLTree *tree, const int *keys, size_t n, KeyPattern pattern)
+{
+    size_t hits_root = 0, hits_finger = 0;
+
+    reset_tree_stats(tree);
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < n; i++)
+        hits_root += tree_search(tree, keys[i]) != NULL;
+    double root_ns = (double)(bench_now_ns() - start) / n;
+    double root_visits = (double)tree->stats.search_visits / n;
+
+    TreeFinger finger;
+    finger_init(&finger, tree);
+    reset_tree_stats(tree);
+    start = bench_now_ns();
+    for (size_t i = 0; i < n; i++)
+        hits_finger += finger_search(&finger, keys[i]) != NULL;
+    double finger_ns = (double)(bench_now_ns() - start) / n;
+    double finger_visits = (double)tree->stats.search_visits / n;
+
+    printf("search %-10s | root %7.1f ns %5.1f visits | finger %7.1f ns %5.1f visits | %.2fx%s\n",
+           pattern_names[pattern], root_ns, root_visits, finger_ns, finger_visits,
+           root_ns / finger_ns, hits_root == hits_finger ? "" : "  MISMATCH");
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = bench_arg_size(argc, argv, 2000000);
+    uint64_t rng = 0xF1A9E5ull;
+    int *keys = (int *)malloc(n * sizeof(int));
+
+    printf("Finger search, n = %zu\n", n);
+    for (int p = PATTERN_SEQUENTIAL; p <= PATTERN_RANDOM; p++)
+    {
+        fill_keys(keys, n, (KeyPattern)p, &rng);
+        bench_inserts(keys, n, (KeyPattern)p);
+    }
+
+    // Lookups run against one tree holding every multiple of 4
+    AVLTree *tree = create_tree(ENGINE_AVL);
+    TreeFinger loader;
+    finger_init(&loader, tree);
+    for (size_t i = 0; i < n; i++)
+        finger_insert(&loader, (int)(i * 4));
+
+    for (int p = PATTERN_SEQUENTIAL; p <= PATTERN_RANDOM; p++)
+    {
+        fill_keys(keys, n, (KeyPattern)p, &rng);
+        bench_lookups(tree, keys, n, (KeyPattern)p);
+    }
+
+    destroy_tree(tree);
+    free(keys);
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,100 @@
+#include "avl_tree.h"
+#include "key_import.h"
+#include "bench_common.h"
+
+#include <string.h>
+
+#define KEY_FILE "/tmp/bench_import.keys"
+
+// Write n keys as decimal lines or raw little-endian int32
+static size_t write_keys(size_t n, int sorted, int binary)
+{
+    FILE *fp = fopen(KEY_FILE, "wb");
+    if (fp == NULL)
+    {
+        perror(KEY_FILE);
+        exit(1);
+    }
+    uint64_t rng = 17;
+    for (size_t i = 0; i < n; i++)
+    {
+        int key = sorted ? (int)(i * 3) : (int)(bench_rand(&rng) % 2000000000u) - 1000000000;
+        if (binary)
+        {
+            unsigned char b[4] = {(unsigned char)key, (unsigned char)(key >> 8), (unsigned char)(key >> 16),
+                                  (unsigned char)(key >> 24)};
+            fwrite(b, 1, sizeof(b), fp);
+        }
+        else
+            fprintf(fp, "%d\n", key);
+    }
+    long bytes = ftell(fp);
+    fclose(fp);
+    return (size_t)bytes;
+}
+
+// Line-at-a-time reader with one tree_insert per key
+static size_t naive_import(AVLTree *tree, int binary)
+{
+    FILE *fp = fopen(KEY_FILE, "rb");
+    size_t keys = 0;
+    if (binary)
+    {
+        unsigned char b[4];
+        while (fread(b, 1, sizeof(b), fp) == sizeof(b))
+        {
+            tree_insert(tree, (int)(int32_t)((uint32_t)b[0] | (uint32_t)b[1] << 8 | (uint32_t)b[2] << 16 |
+                                             (uint32_t)b[3] << 24));
+            keys++;
+        }
+    }
+    else
+    {
+        char line[32];
+        while (fgets(line, sizeof(line), fp))
+        {
+            tree_insert(tree, (int)strtol(line, NULL, 10));
+            keys++;
+        }
+    }
+    fclose(fp);
+    return keys;
+}
+
+static void run_import(const char *label, size_t n, int sorted, int binary, size_t chunk)
+{
+    size_t bytes = write_keys(n, sorted, binary);
+
+    AVLTree *tree = create_tree(ENGINE_AVL);
+    uint64_t start = bench_now_ns();
+    size_t keys = naive_import(tree, binary);
+    double naive_s = (double)(bench_now_ns() - start) / 1e9;
+    size_t expect = tree->size;
+    destroy_tree(tree);
+
+    tree = create_tree(ENGINE_AVL);
+    ImportOptions options = {binary ? IMPORT_BINARY : IMPORT_TEXT, chunk};
+    ImportStats st;
+    int ok = tree_import_file(tree, KEY_FILE, &options, &st);
+
+    printf("%-14s %8zuK chunk | naive %7.1f MB/s %6.2f Mkeys/s | import %7.1f MB/s %6.2f Mkeys/s (%4.1fx)"
+           " | %zu/%zu appended%s\n",
+           label, chunk / 1024, (double)bytes / 1e6 / naive_s, (double)keys / 1e6 / naive_s, st.mb_per_sec,
+           st.keys_per_sec / 1e6, naive_s / st.seconds, st.appended_chunks, st.chunks,
+           ok && st.keys == keys && tree->size == expect ? "" : "  MISMATCH");
+    destroy_tree(tree);
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = bench_arg_size(argc, argv, 2000000);
+
+    printf("Importing %zu keys: fgets + tree_insert vs mmap + chunked bulk load\n", n);
+    run_import("sorted text", n, 1, 0, IMPORT_DEFAULT_CHUNK);
+    run_import("random text", n, 0, 0, IMPORT_DEFAULT_CHUNK);
+    run_import("random text", n, 0, 0, 64 * 1024);
+    run_import("sorted binary", n, 1, 1, IMPORT_DEFAULT_CHUNK);
+    run_import("random binary", n, 0, 1, IMPORT_DEFAULT_CHUNK);
+    remove(KEY_FILE);
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include "avl_tree.h"
+#include "key_index.h"
+#include "bench_common.h"
+
+// Exact-match lookups, duplicate inserts and absent deletes with and
+// without the hash side index, plus what keeping it in sync costs
+typedef struct
+{
+    double search_ns;
+    double batch_ns;
+    double check_ns; // duplicate insert / absent delete
+    double churn_ns; // real insert + delete
+} Timings;
+
+static double per_op(uint64_t start, size_t ops)
+{
+    return (double)(bench_now_ns() - start) / (double)ops;
+}
+
+static Timings run(AVLTree *tree, size_t n, size_t queries)
+{
+    Timings t;
+    uint64_t rng = 21;
+    int *keys = (int *)malloc(queries * sizeof(int));
+    AVLNode **found = (AVLNode **)malloc(queries * sizeof(AVLNode *));
+    for (size_t i = 0; i < queries; i++)
+        keys[i] = (int)(bench_rand(&rng) % (2 * n));
+
+    size_t hits = 0;
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < queries; i++)
+        hits += tree_search(tree, keys[i]) != NULL;
+    t.search_ns = per_op(start, queries);
+
+    start = bench_now_ns();
+    tree_search_batch(tree, keys, queries, found);
+    t.batch_ns = per_op(start, queries);
+
+    // Even keys are present, odd ones absent: both calls are no-ops
+    start = bench_now_ns();
+    for (size_t i = 0; i < queries; i++)
+    {
+        tree_insert(tree, keys[i] & ~1);
+        tree_delete(tree, keys[i] | 1);
+    }
+    t.check_ns = per_op(start, 2 * queries);
+
+    start = bench_now_ns();
+    for (size_t i = 0; i < queries; i++)
+    {
+        tree_insert(tree, keys[i] | 1);
+        tree_delete(tree, keys[i] | 1);
+    }
+    t.churn_ns = per_op(start, 2 * queries);
+
+    if (hits == 0)
+        printf("  (no hits)\n");
+    free(keys);
+    free(found);
+    return t;
+}
+
+static AVLTree *build(size_t n)
+{
+    AVLTree *tree = create_tree(ENGINE_AVL);
+    int *keys = (int *)malloc(n * sizeof(int));
+    uint64_t rng = 9;
+    for (size_t i = 0; i < n; i++)
+        keys[i] = (int)(2 * i);
+    bench_shuffle(keys, n, &rng);
+    for (size_t i = 0; i < n; i++)
+        tree_insert(tree, keys[i]);
+    free(keys);
+    return tree;
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = bench_arg_size(argc, argv, 1000000);
+    size_t queries = 1000000;
+
+    AVLTree *tree = build(n);
+    Timings plain = run(tree, n, queries);
+
+    TreeMemory before, after;
+    tree_memory(tree, &before);
+    uint64_t start = bench_now_ns();
+    tree_enable_index(tree);
+    double build_ms = (double)(bench_now_ns() - start) / 1e6;
+    tree_memory(tree, &after);
+    Timings indexed = run(tree, n, queries);
+
+    size_t index_bytes = after.handle_bytes - before.handle_bytes;
+    printf("%zu keys, %zu queries (half hits)\n", n, queries);
+    printf("%-26s %10s %10s %8s\n", "", "tree", "indexed", "speedup");
+    printf("%-26s %7.1f ns %7.1f ns %7.1fx\n", "tree_search", plain.search_ns, indexed.search_ns,
+           plain.search_ns / indexed.search_ns);
+    printf("%-26s %7.1f ns %7.1f ns %7.1fx\n", "tree_search_batch", plain.batch_ns, indexed.batch_ns,
+           plain.batch_ns / indexed.batch_ns);
+    printf("%-26s %7.1f ns %7.1f ns %7.1fx\n", "duplicate / absent no-op", plain.check_ns, indexed.check_ns,
+           plain.check_ns / indexed.check_ns);
+    printf("%-26s %7.1f ns %7.1f ns %7.1fx\n", "insert + delete", plain.churn_ns, indexed.churn_ns,
+           plain.churn_ns / indexed.churn_ns);
+    printf("index: %.2f MB (%.1f B/key, tree nodes %.1f B/key), built in %.1f ms\n",
+           (double)index_bytes / 1048576.0, (double)index_bytes / (double)tree->size,
+           (double)after.reserved_bytes / (double)tree->size, build_ms);
+
+    destroy_tree(tree);
+    return 0;
+}
@@ -0,0 +1,83 @@
+#include "avl_tree.h"
+#include "bench_common.h"
+
+typedef struct
+{
+    const char *name;
+    int lazy;
+    double ratio;
+} DeleteMode;
+
+// Time-ordered keys expire in sweeps: every sweep removes the oldest
+// `sweep` keys and appends as many new ones
+static void run_expiry(DeleteMode mode, size_t n, size_t sweep, size_t sweeps, int random_order)
+{
+    AVLTree *tree = create_tree(ENGINE_AVL);
+    set_lazy_delete(tree, mode.lazy, mode.ratio);
+
+    for (size_t i = 0; i < n; i++)
+        tree_insert(tree, (int)i);
+
+    uint64_t rng = 7;
+    int *batch = (int *)malloc(sweep * sizeof(int));
+    size_t oldest = 0, next = n;
+    uint64_t delete_ns = 0;
+
+    for (size_t s = 0; s < sweeps; s++)
+    {
+        for (size_t i = 0; i < sweep; i++)
+            batch[i] = (int)(oldest + i);
+        if (random_order)
+            bench_shuffle(batch, sweep, &rng);
+
+        uint64_t start = bench_now_ns();
+        for (size_t i = 0; i < sweep; i++)
+            tree_delete(tree, batch[i]);
+        delete_ns += bench_now_ns() - start;
+
+        for (size_t i = 0; i < sweep; i++)
+            tree_insert(tree, (int)(next + i));
+        oldest += sweep;
+        next += sweep;
+    }
+
+    // Lookups over the live window after the last sweep
+    uint64_t start = bench_now_ns();
+    size_t hits = 0;
+    for (size_t i = 0; i < n; i++)
+        hits += tree_search(tree, (int)(oldest + bench_rand(&rng) % n)) != NULL;
+    double search_ns = (double)(bench_now_ns() - start) / n;
+
+    TreeStats stats;
+    tree_stats(tree, &stats);
+    printf("%-12s | delete %7.1f ns | search %7.1f ns | rotations %9lu | compactions %3lu | tombstones %5.1f%%%s\n",
+           mode.name, (double)delete_ns / (sweep * sweeps), search_ns,
+           stats.rotations, stats.compactions, 100.0 * tombstone_ratio(tree),
+           hits == n ? "" : "  MISMATCH");
+
+    free(batch);
+    destroy_tree(tree);
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = bench_arg_size(argc, argv, 1000000);
+    size_t sweep = n / 10;
+    size_t sweeps = 20;
+
+    DeleteMode modes[] = {
+        {"eager", 0, 0.0},
+        {"lazy 25%", 1, 0.25},
+        {"lazy 50%", 1, 0.5},
+    };
+    size_t mode_count = sizeof(modes) / sizeof(modes[0]);
+
+    printf("Bulk expiry, %zu live keys, %zu sweeps of %zu oldest keys\n", n, sweeps, sweep);
+    printf("-- ascending expiry --\n");
+    for (size_t m = 0; m < mode_count; m++)
+        run_expiry(modes[m], n, sweep, sweeps, 0);
+    printf("-- shuffled expiry --\n");
+    for (size_t m = 0; m < mode_count; m++)
+        run_expiry(modes[m], n, sweep, sweeps, 1);
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,84 @@
+#include "avl_tree.h"
+#include "bench_common.h"
+
+// Node layout and allocator footprint: how many bytes a key really costs
+typedef struct
+{
+    const char *name;
+    size_t pool_chunk; // 0 = malloc per node
+} Allocator;
+
+static void print_layout(void)
+{
+    size_t payload = sizeof(int);
+    size_t fields = sizeof(int) * 3 + sizeof(unsigned int) + 2 * sizeof(AVLNode *);
+    printf("AVLNode: %zu bytes = key %zu + balance metadata %zu + links %zu + padding %zu\n",
+           sizeof(AVLNode), payload, sizeof(int) * 2 + sizeof(unsigned int), 2 * sizeof(AVLNode *),
+           sizeof(AVLNode) - fields);
+}
+
+static void report(const char *phase, const Allocator *alloc, AVLTree *tree, uint64_t ns, size_t ops)
+{
+    TreeMemory mem;
+    tree_memory(tree, &mem);
+    printf("%-14s | %-9s | %6.1f ns/op | keys %8zu | reserved %9.2f MB | slack %5.1f%% | peak %9.2f MB"
+           " | %5.1f B/key\n",
+           alloc->name, phase, ops ? (double)ns / (double)ops : 0.0, tree->size,
+           (double)mem.reserved_bytes / 1048576.0,
+           mem.reserved_bytes ? 100.0 * (double)(mem.reserved_bytes - mem.requested_bytes) / (double)mem.reserved_bytes
+                              : 0.0,
+           (double)mem.peak_reserved_bytes / 1048576.0, tree_bytes_per_key(tree));
+}
+
+// Fill with n random keys, churn (delete + insert) n times, then drain half
+static void run(const Allocator *alloc, size_t n)
+{
+    AVLTree *tree = create_tree(ENGINE_AVL);
+    if (alloc->pool_chunk)
+        tree_use_pool(tree, alloc->pool_chunk);
+
+    uint64_t rng = 3;
+    int *keys = (int *)malloc(n * sizeof(int));
+    for (size_t i = 0; i < n; i++)
+        keys[i] = (int)i;
+    bench_shuffle(keys, n, &rng);
+
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < n; i++)
+        tree_insert(tree, keys[i]);
+    report("fill", alloc, tree, bench_now_ns() - start, n);
+
+    start = bench_now_ns();
+    for (size_t i = 0; i < n; i++)
+    {
+        size_t j = (size_t)(bench_rand(&rng) % n);
+        tree_delete(tree, keys[j]);
+        keys[j] += (int)n;
+        tree_insert(tree, keys[j]);
+    }
+    report("churn", alloc, tree, bench_now_ns() - start, 2 * n);
+
+    start = bench_now_ns();
+    for (size_t i = 0; i < n / 2; i++)
+        tree_delete(tree, keys[i]);
+    report("drain 50%", alloc, tree, bench_now_ns() - start, n / 2);
+
+    free(keys);
+    destroy_tree(tree);
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = bench_arg_size(argc, argv, 1000000);
+    Allocator allocators[] = {
+        {"malloc", 0},
+        {"pool 256", 256},
+        {"pool 64K", 65536},
+    };
+
+    print_layout();
+    printf("Memory footprint, %zu random keys\n", n);
+    for (size_t i = 0; i < sizeof(allocators) / sizeof(allocators[0]); i++)
+        run(&allocators[i], n);
+    return 0;
+}
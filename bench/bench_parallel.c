@@ -0,0 +1,59 @@
+#include "parallel_tree.h"
+#include "bench_common.h"
+
+// Milliseconds since start
+static double elapsed_ms(uint64_t start)
+{
+    return (double)(bench_now_ns() - start) / 1e6;
+}
+
+static void run_threads(int threads, const int *keys, size_t n)
+{
+    TaskPool *pool = threads > 1 ? create_task_pool(threads) : NULL;
+    AVLTree tree;
+    init_tree(&tree, ENGINE_AVL);
+
+    uint64_t start = bench_now_ns();
+    build_tree_from_sorted(&tree, keys, n, pool);
+    double build_ms = elapsed_ms(start);
+
+    start = bench_now_ns();
+    size_t count = parallel_count_nodes(pool, tree.root);
+    double count_ms = elapsed_ms(start);
+
+    start = bench_now_ns();
+    int valid = validate_tree(&tree, pool);
+    double validate_ms = elapsed_ms(start);
+
+    start = bench_now_ns();
+    parallel_free_tree(pool, tree.root);
+    double free_ms = elapsed_ms(start);
+
+    printf("%7d | %9.1f | %9.1f | %9.1f | %9.1f | %s\n",
+           threads, build_ms, count_ms, validate_ms, free_ms,
+           (count == n && valid) ? "ok" : "MISMATCH");
+
+    destroy_task_pool(pool);
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = bench_arg_size(argc, argv, 10000000);
+    int max_threads = argc > 2 ? atoi(argv[2]) : cpu_count();
+    if (max_threads < 1)
+        max_threads = 1;
+
+    int *keys = (int *)malloc(n * sizeof(int));
+    for (size_t i = 0; i < n; i++)
+        keys[i] = (int)i;
+
+    printf("Parallel whole-tree operations, n = %zu (ms)\n", n);
+    printf("threads |     build |     count |  validate |      free |\n");
+    for (int t = 1; t <= max_threads; t *= 2)
+        run_threads(t, keys, n);
+    if ((max_threads & (max_threads - 1)) != 0)
+        run_threads(max_threads, keys, n);
+
+    free(keys);
+    return 0;
+}
\ No newline at end of file
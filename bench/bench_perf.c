@@ -0,0 +1,424 @@
+#include "avl_tree.h"
+#include "bench_common.h"
+
+#include <string.h>
+
+// Performance regression suite: a fixed matrix of sizes x key
+// distributions x op mixes against the tree API. Each workload gets a
+// warmup pass and several timed repetitions; the median ns/op and a
+// bootstrap 95% confidence interval are written as JSON and compared with
+// baseline runs. `make perf` alternates rounds of a git ref's build and the
+// working tree's on the same machine, then compares the fastest median of
+// each. A workload whose median is slower than the baseline by more than
+// the threshold fails the run.
+
+#define MAX_REPS 32
+#define MAX_WORKLOADS 64
+#define MAX_RUNS 16
+#define BOOTSTRAP_ROUNDS 2000
+
+typedef enum
+{
+    DIST_UNIFORM,    // any key in [0, 2n)
+    DIST_SEQUENTIAL, // ascending cursor over [0, 2n)
+    DIST_SKEWED      // 90% of operations inside a hot 1% of the key space
+} KeyDist;
+
+typedef struct
+{
+    const char *name;
+    int search_pct; // the rest splits evenly between insert and delete
+} OpMix;
+
+typedef struct
+{
+    char name[64];
+    double samples[MAX_REPS];
+    int reps;
+    double median;
+    double ci_low;
+    double ci_high;
+} Result;
+
+typedef struct
+{
+    char name[64];
+    double median;
+    double ci_low;
+    double ci_high;
+} Baseline;
+
+typedef struct
+{
+    uint64_t rng;
+    size_t span;   // keys are drawn from [0, span)
+    size_t cursor; // sequential position
+} KeySource;
+
+static const char *DIST_NAMES[] = {"uniform", "sequential", "skewed"};
+
+static int next_key(KeySource *src, KeyDist dist)
+{
+    switch (dist)
+    {
+    case DIST_SEQUENTIAL:
+        src->cursor = (src->cursor + 1) % src->span;
+        return (int)src->cursor;
+    case DIST_SKEWED:
+    {
+        size_t hot = src->span / 100 ? src->span / 100 : 1;
+        if (bench_rand(&src->rng) % 10 != 0)
+            return (int)(src->span / 2 + bench_rand(&src->rng) % hot);
+        return (int)(bench_rand(&src->rng) % src->span);
+    }
+    default:
+        return (int)(bench_rand(&src->rng) % src->span);
+    }
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double median_of(double *values, int n)
+{
+    qsort(values, (size_t)n, sizeof(double), compare_double);
+    return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2.0;
+}
+
+// Percentile bootstrap of the median
+static void bootstrap_ci(const double *samples, int n, double *low, double *high)
+{
+    static double medians[BOOTSTRAP_ROUNDS];
+    double resample[MAX_REPS];
+    uint64_t rng = 0xC0FFEE;
+
+    for (int r = 0; r < BOOTSTRAP_ROUNDS; r++)
+    {
+        for (int i = 0; i < n; i++)
+            resample[i] = samples[bench_rand(&rng) % (uint64_t)n];
+        medians[r] = median_of(resample, n);
+    }
+    qsort(medians, BOOTSTRAP_ROUNDS, sizeof(double), compare_double);
+    *low = medians[(int)(0.025 * (BOOTSTRAP_ROUNDS - 1))];
+    *high = medians[(int)(0.975 * (BOOTSTRAP_ROUNDS - 1))];
+}
+
+// One pass of ops operations; returns ns per operation
+static double run_pass(AVLTree *tree, KeySource *src, KeyDist dist, const OpMix *mix, int *ops, int *keys,
+                       size_t count)
+{
+    // Draw the operation stream up front so only tree work is timed
+    for (size_t i = 0; i < count; i++)
+    {
+        int roll = (int)(bench_rand(&src->rng) % 100);
+        ops[i] = roll < mix->search_pct ? 0 : roll < mix->search_pct + (100 - mix->search_pct) / 2 ? 1 : 2;
+        keys[i] = next_key(src, dist);
+    }
+
+    size_t hits = 0;
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < count; i++)
+    {
+        if (ops[i] == 0)
+            hits += tree_search(tree, keys[i]) != NULL;
+        else if (ops[i] == 1)
+            hits += (size_t)tree_insert(tree, keys[i]);
+        else
+            hits += (size_t)tree_delete(tree, keys[i]);
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+
+    // Keep the loop observable
+    if (hits == (size_t)-1)
+        printf("unreachable\n");
+    return (double)elapsed / (double)count;
+}
+
+static int run_matrix(Result *results, size_t ops_per_pass, int reps, int warmup, int quick)
+{
+    const size_t sizes[] = {1 << 10, 1 << 15, 1 << 19};
+    const OpMix mixes[] = {{"read", 100}, {"mixed", 50}, {"write", 0}};
+    int size_count = quick ? 2 : 3;
+    int count = 0;
+
+    int *ops = (int *)malloc(ops_per_pass * sizeof(int));
+    int *keys = (int *)malloc(ops_per_pass * sizeof(int));
+
+    for (int s = 0; s < size_count; s++)
+    {
+        for (int d = 0; d < 3; d++)
+        {
+            // Half of [0, 2n) present: the even keys, inserted in random order
+            size_t n = sizes[s];
+            AVLTree *tree = create_tree(ENGINE_AVL);
+            int *initial = (int *)malloc(n * sizeof(int));
+            uint64_t rng = 17 + (uint64_t)d;
+            for (size_t i = 0; i < n; i++)
+                initial[i] = (int)(2 * i);
+            bench_shuffle(initial, n, &rng);
+            for (size_t i = 0; i < n; i++)
+                tree_insert(tree, initial[i]);
+            free(initial);
+
+            for (int m = 0; m < 3; m++)
+            {
+                Result *res = &results[count++];
+                KeySource src = {99 + (uint64_t)(s * 9 + d * 3 + m), 2 * n, 0};
+                snprintf(res->name, sizeof(res->name), "%s/%zuk/%s", DIST_NAMES[d], n >> 10, mixes[m].name);
+
+                for (int w = 0; w < warmup; w++)
+                    run_pass(tree, &src, (KeyDist)d, &mixes[m], ops, keys, ops_per_pass);
+                for (int r = 0; r < reps; r++)
+                    res->samples[r] = run_pass(tree, &src, (KeyDist)d, &mixes[m], ops, keys, ops_per_pass);
+                res->reps = reps;
+
+                double sorted[MAX_REPS];
+                memcpy(sorted, res->samples, (size_t)reps * sizeof(double));
+                res->median = median_of(sorted, reps);
+                bootstrap_ci(res->samples, reps, &res->ci_low, &res->ci_high);
+                fprintf(stderr, "  %-28s %8.1f ns/op\n", res->name, res->median);
+            }
+            destroy_tree(tree);
+        }
+    }
+
+    free(ops);
+    free(keys);
+    return count;
+}
+
+static int write_json(const char *path, const Result *results, int count, size_t ops, int reps, int warmup)
+{
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL)
+        return 0;
+
+    fprintf(fp, "{\n  \"version\": 1,\n  \"unit\": \"ns/op\",\n");
+    fprintf(fp, "  \"config\": {\"ops_per_pass\": %zu, \"reps\": %d, \"warmup\": %d},\n", ops, reps, warmup);
+    fprintf(fp, "  \"results\": [\n");
+    for (int i = 0; i < count; i++)
+    {
+        const Result *r = &results[i];
+        fprintf(fp, "    {\"name\": \"%s\", \"median_ns\": %.2f, \"ci_low_ns\": %.2f, \"ci_high_ns\": %.2f, \"samples_ns\": [",
+                r->name, r->median, r->ci_low, r->ci_high);
+        for (int j = 0; j < r->reps; j++)
+            fprintf(fp, j ? ", %.2f" : "%.2f", r->samples[j]);
+        fprintf(fp, "]}%s\n", i + 1 < count ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+    fclose(fp);
+    return 1;
+}
+
+// Numeric field "key": value inside [from, end)
+static int json_number(const char *from, const char *end, const char *key, double *out)
+{
+    char pattern[32];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    const char *at = strstr(from, pattern);
+    if (at == NULL || at >= end)
+        return 0;
+    *out = strtod(at + strlen(pattern), NULL);
+    return 1;
+}
+
+// Read the results written by write_json; returns the number loaded
+static int read_baseline(const char *path, Baseline *out, int cap)
+{
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL)
+        return -1;
+    fseek(fp, 0, SEEK_END);
+    long len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char *text = (char *)malloc((size_t)len + 1);
+    size_t got = fread(text, 1, (size_t)len, fp);
+    text[got] = '\0';
+    fclose(fp);
+
+    int count = 0;
+    const char *at = text;
+    while (count < cap && (at = strstr(at, "{\"name\": \"")) != NULL)
+    {
+        at += strlen("{\"name\": \"");
+        const char *quote = strchr(at, '"');
+        const char *end = strchr(at, '}');
+        if (quote == NULL || end == NULL || (size_t)(quote - at) >= sizeof(out->name))
+            break;
+
+        Baseline *b = &out[count];
+        memcpy(b->name, at, (size_t)(quote - at));
+        b->name[quote - at] = '\0';
+        if (json_number(quote, end, "median_ns", &b->median) && json_number(quote, end, "ci_low_ns", &b->ci_low) &&
+            json_number(quote, end, "ci_high_ns", &b->ci_high))
+            count++;
+        at = end;
+    }
+    free(text);
+    return count;
+}
+
+// Fold one saved run into best, keeping the fastest median per workload
+// (the round least disturbed by the rest of the machine)
+static void keep_best(Baseline *best, int *best_count, const Baseline *run, int run_count)
+{
+    for (int i = 0; i < run_count; i++)
+    {
+        int j = 0;
+        while (j < *best_count && strcmp(best[j].name, run[i].name) != 0)
+            j++;
+        if (j == *best_count && *best_count < MAX_WORKLOADS)
+            best[(*best_count)++] = run[i];
+        else if (j < *best_count && run[i].median < best[j].median)
+            best[j] = run[i];
+    }
+}
+
+// Load and fold a list of saved runs; returns the workload count, -1 on error
+static int load_runs(const char **paths, int path_count, Baseline *best)
+{
+    static Baseline run[MAX_WORKLOADS];
+    int best_count = 0;
+    for (int i = 0; i < path_count; i++)
+    {
+        int count = read_baseline(paths[i], run, MAX_WORKLOADS);
+        if (count < 0)
+        {
+            perror(paths[i]);
+            return -1;
+        }
+        keep_best(best, &best_count, run, count);
+    }
+    return best_count;
+}
+
+// Print the comparison table; returns the number of regressions
+static int compare(const Result *results, int count, const Baseline *base, int base_count, double threshold)
+{
+    int regressions = 0, improvements = 0, missing = 0;
+
+    printf("%-28s %10s %10s  %-21s %8s  %s\n", "workload", "base ns", "now ns", "95% CI (now)", "change", "status");
+    for (int i = 0; i < count; i++)
+    {
+        const Result *r = &results[i];
+        const Baseline *b = NULL;
+        for (int j = 0; j < base_count; j++)
+        {
+            if (strcmp(base[j].name, r->name) == 0)
+                b = &base[j];
+        }
+
+        char ci[32];
+        snprintf(ci, sizeof(ci), "[%.1f, %.1f]", r->ci_low, r->ci_high);
+        if (b == NULL)
+        {
+            printf("%-28s %10s %10.1f  %-21s %8s  %s\n", r->name, "-", r->median, ci, "-", "new");
+            missing++;
+            continue;
+        }
+
+        double change = 100.0 * (r->median - b->median) / b->median;
+        const char *status = "ok";
+        if (change > threshold)
+        {
+            // Overlapping intervals suggest noise, but the median rule decides
+            status = r->ci_low <= b->ci_high ? "FAIL (CI overlaps)" : "FAIL";
+            regressions++;
+        }
+        else if (change < -threshold)
+        {
+            status = "faster";
+            improvements++;
+        }
+        printf("%-28s %10.1f %10.1f  %-21s %+7.1f%%  %s\n", r->name, b->median, r->median, ci, change, status);
+    }
+
+    printf("\n%d workloads: %d regressed by more than %.1f%%, %d faster, %d not in baseline\n",
+           count, regressions, threshold, improvements, missing);
+    return regressions;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [--out FILE] [--baseline FILE]... [--results FILE]... [--threshold PCT] [--reps N] [--ops N] [--quick]\n",
+            prog);
+}
+
+int main(int argc, char **argv)
+{
+    const char *out = NULL;
+    const char *baselines[MAX_RUNS];
+    const char *saved[MAX_RUNS]; // earlier runs to compare instead of running
+    int baseline_count = 0, saved_count = 0;
+    double threshold = 10.0;
+    int reps = 7;
+    int warmup = 1;
+    size_t ops = 50000;
+    int quick = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+            out = argv[++i];
+        else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc && baseline_count < MAX_RUNS)
+            baselines[baseline_count++] = argv[++i];
+        else if (strcmp(argv[i], "--results") == 0 && i + 1 < argc && saved_count < MAX_RUNS)
+            saved[saved_count++] = argv[++i];
+        else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc)
+            threshold = atof(argv[++i]);
+        else if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc && atoi(argv[i + 1]) >= 3 && atoi(argv[i + 1]) <= MAX_REPS)
+            reps = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--ops") == 0 && i + 1 < argc && atol(argv[i + 1]) > 0)
+            ops = (size_t)atol(argv[++i]);
+        else if (strcmp(argv[i], "--quick") == 0)
+            quick = 1;
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    static Result results[MAX_WORKLOADS];
+    int count;
+    if (saved_count > 0)
+    {
+        // Compare the best of the saved runs; nothing is timed
+        static Baseline best[MAX_WORKLOADS];
+        count = load_runs(saved, saved_count, best);
+        if (count < 0)
+            return 2;
+        for (int i = 0; i < count; i++)
+        {
+            memcpy(results[i].name, best[i].name, sizeof(results[i].name));
+            results[i].median = best[i].median;
+            results[i].ci_low = best[i].ci_low;
+            results[i].ci_high = best[i].ci_high;
+        }
+    }
+    else
+    {
+        fprintf(stderr, "Running %s workload matrix: %zu ops x (%d warmup + %d reps)\n",
+                quick ? "quick" : "full", ops, warmup, reps);
+        count = run_matrix(results, ops, reps, warmup, quick);
+
+        if (out && !write_json(out, results, count, ops, reps, warmup))
+        {
+            perror(out);
+            return 2;
+        }
+        if (out)
+            fprintf(stderr, "Results written to %s\n", out);
+    }
+    if (baseline_count == 0)
+        return 0;
+
+    static Baseline base[MAX_WORKLOADS];
+    int base_count = load_runs(baselines, baseline_count, base);
+    if (base_count < 0)
+        return 2;
+    return compare(results, count, base, base_count, threshold) ? 1 : 0;
+}
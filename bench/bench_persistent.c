@@ -0,0 +1,81 @@
+#include "avl_tree.h"
+#include "persistent_tree.h"
+#include "bench_common.h"
+
+// Random churn (alternating insert of a new key and delete of a live one)
+// on a mutable tree vs a persistent tree that keeps every version
+static void run_churn(size_t n, size_t updates)
+{
+    int *keys = (int *)malloc(n * sizeof(int));
+    uint64_t rng = 11;
+    for (size_t i = 0; i < n; i++)
+        keys[i] = (int)(2 * i);
+    bench_shuffle(keys, n, &rng);
+
+    AVLTree *tree = create_tree(ENGINE_AVL);
+    PersistentTree *pt = ptree_create(ENGINE_AVL, updates);
+    for (size_t i = 0; i < n; i++)
+    {
+        tree_insert(tree, keys[i]);
+        ptree_insert(pt, keys[i]);
+    }
+
+    // Odd keys are absent at the start; each one is inserted, then a random
+    // original key is removed
+    int *ops = (int *)malloc(updates * sizeof(int));
+    for (size_t i = 0; i < updates; i++)
+        ops[i] = i % 2 ? keys[bench_rand(&rng) % n] : (int)(2 * (bench_rand(&rng) % n) + 1);
+
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < updates; i++)
+    {
+        if (i % 2)
+            tree_delete(tree, ops[i]);
+        else
+            tree_insert(tree, ops[i]);
+    }
+    double mutable_ns = (double)(bench_now_ns() - start) / updates;
+
+    start = bench_now_ns();
+    for (size_t i = 0; i < updates; i++)
+    {
+        if (i % 2)
+            ptree_delete(pt, ops[i]);
+        else
+            ptree_insert(pt, ops[i]);
+    }
+    double persistent_ns = (double)(bench_now_ns() - start) / updates;
+
+    TreeMemory after;
+    tree_memory(ptree_handle(pt), &after);
+    size_t versions = ptree_undo_depth(pt);
+    // Nodes beyond one full tree, spread over the retained versions
+    double nodes_per_version = (double)(after.live_nodes - ptree_handle(pt)->size) / versions;
+
+    // Walking back through every version is a root swap per step
+    start = bench_now_ns();
+    while (ptree_undo(pt))
+        ;
+    double undo_ns = versions ? (double)(bench_now_ns() - start) / versions : 0.0;
+
+    printf("%9zu keys | update %7.1f ns mutable %7.1f ns persistent | %5.1f nodes (%6.0f B) per version"
+           " vs %9zu B full copy | undo %5.1f ns\n",
+           n, mutable_ns, persistent_ns, nodes_per_version, nodes_per_version * sizeof(AVLNode),
+           tree->size * sizeof(AVLNode), undo_ns);
+
+    free(ops);
+    free(keys);
+    destroy_tree(tree);
+    ptree_destroy(pt);
+}
+
+int main(int argc, char **argv)
+{
+    size_t max_n = bench_arg_size(argc, argv, 1000000);
+    size_t updates = 200000;
+
+    printf("Path-copying versions, %zu updates retained as undo history\n", updates);
+    for (size_t n = 1000; n <= max_n; n *= 10)
+        run_churn(n, updates);
+    return 0;
+}
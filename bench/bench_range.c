@@ -0,0 +1,65 @@
+#include "avl_tree.h"
+#include "split_join.h"
+#include "bench_common.h"
+
+static AVLTree *build(size_t n)
+{
+    AVLTree *tree = create_tree(ENGINE_AVL);
+    int *keys = (int *)malloc(n * sizeof(int));
+    uint64_t rng = 5;
+    for (size_t i = 0; i < n; i++)
+        keys[i] = (int)i;
+    bench_shuffle(keys, n, &rng);
+    for (size_t i = 0; i < n; i++)
+        tree_insert(tree, keys[i]);
+    free(keys);
+    return tree;
+}
+
+// Expire the k oldest (smallest) keys of an n-key tree, one delete per key
+// vs one tree_delete_range; then detach the same range and join it back
+static void run_range(size_t n, size_t k)
+{
+    int lo = 0, hi = (int)k - 1;
+
+    AVLTree *tree = build(n);
+    uint64_t start = bench_now_ns();
+    for (int key = lo; key <= hi; key++)
+        tree_delete(tree, key);
+    double per_key_us = (double)(bench_now_ns() - start) / 1000.0;
+    destroy_tree(tree);
+
+    tree = build(n);
+    start = bench_now_ns();
+    size_t removed = tree_delete_range(tree, lo, hi);
+    double range_us = (double)(bench_now_ns() - start) / 1000.0;
+    destroy_tree(tree);
+
+    tree = build(n);
+    start = bench_now_ns();
+    AVLTree *part = tree_extract_range(tree, lo, hi);
+    double extract_us = (double)(bench_now_ns() - start) / 1000.0;
+
+    // The detached keys are all smaller, so the rest joins onto them
+    start = bench_now_ns();
+    tree_join(part, tree);
+    double join_us = (double)(bench_now_ns() - start) / 1000.0;
+
+    printf("%8zu keys | per-key delete %10.1f us | delete_range %9.1f us (%5.0fx) | extract %9.1f us"
+           " | join back %6.1f us%s\n",
+           k, per_key_us, range_us, per_key_us / range_us, extract_us, join_us,
+           removed == k && part->size == n ? "" : "  MISMATCH");
+
+    destroy_tree(part);
+    destroy_tree(tree);
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = bench_arg_size(argc, argv, 1000000);
+
+    printf("Expiring the oldest keys of a %zu-key tree\n", n);
+    for (size_t k = 10; k <= n / 2; k *= 10)
+        run_range(n, k);
+    return 0;
+}
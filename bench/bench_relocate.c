@@ -0,0 +1,86 @@
+#include "avl_tree.h"
+#include "relocate.h"
+#include "bench_common.h"
+
+#define STEP_NODES 4096
+
+// Random searches over the key space, half of them hits
+static double search_ns(AVLTree *tree, size_t n, size_t queries)
+{
+    uint64_t rng = 11;
+    size_t hits = 0;
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < queries; i++)
+        hits += tree_search(tree, (int)(bench_rand(&rng) % (2 * n))) != NULL;
+    double ns = (double)(bench_now_ns() - start) / (double)queries;
+    if (hits == 0)
+        printf("  (no hits)\n");
+    return ns;
+}
+
+// Relocate in STEP_NODES increments, reporting the total and the longest step
+static void relocate_in_steps(AVLTree *tree, NodeLayout layout)
+{
+    Relocation *r = relocation_start(tree, layout);
+    if (r == NULL)
+    {
+        printf("  relocation unavailable\n");
+        return;
+    }
+
+    uint64_t total = 0, longest = 0;
+    size_t steps = 0;
+    RelocateStatus status;
+    do
+    {
+        uint64_t start = bench_now_ns();
+        status = relocation_step(r, STEP_NODES);
+        uint64_t ns = bench_now_ns() - start;
+        total += ns;
+        longest = ns > longest ? ns : longest;
+        steps++;
+    } while (status == RELOCATE_RUNNING);
+    relocation_free(r);
+
+    printf("  relocate %s: %6.1f ms in %zu steps of %d nodes, longest step %6.1f us%s\n", layout_name(layout),
+           (double)total / 1e6, steps, STEP_NODES, (double)longest / 1e3, status == RELOCATE_DONE ? "" : " (failed)");
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = bench_arg_size(argc, argv, 1000000);
+    size_t queries = 2000000;
+
+    // Even keys inserted in random order, then aged by replacing random
+    // keys with random odd ones so freed nodes get reused out of order
+    AVLTree *tree = create_tree(ENGINE_AVL);
+    int *keys = (int *)malloc(n * sizeof(int));
+    uint64_t rng = 5;
+    for (size_t i = 0; i < n; i++)
+        keys[i] = (int)(2 * i);
+    bench_shuffle(keys, n, &rng);
+    for (size_t i = 0; i < n; i++)
+        tree_insert(tree, keys[i]);
+
+    printf("Search throughput on a %zu-key tree, %zu random lookups\n", n, queries);
+    printf("%-30s %6.1f ns/search\n", "fresh (random insert order)", search_ns(tree, n, queries));
+
+    for (size_t i = 0; i < 4 * n; i++)
+    {
+        size_t slot = (size_t)(bench_rand(&rng) % n);
+        tree_delete(tree, keys[slot]);
+        keys[slot] = (int)(bench_rand(&rng) % (2 * n)) | 1;
+        tree_insert(tree, keys[slot]);
+    }
+    printf("%-30s %6.1f ns/search\n", "aged (4n replacements)", search_ns(tree, n, queries));
+
+    relocate_in_steps(tree, LAYOUT_VEB);
+    printf("%-30s %6.1f ns/search\n", "after vEB relocation", search_ns(tree, n, queries));
+
+    relocate_in_steps(tree, LAYOUT_BFS);
+    printf("%-30s %6.1f ns/search\n", "after BFS relocation", search_ns(tree, n, queries));
+
+    free(keys);
+    destroy_tree(tree);
+    return 0;
+}
@@ -0,0 +1,129 @@
+#include "render_worker.h"
+#include "bench_common.h"
+
+// Canvas and palette of the visualizer's tree area
+static const RenderConfig CONFIG = {
+    .width = 1200,
+    .height = 450,
+    .top = 60,
+    .margin = 50,
+    .node_radius = 28,
+    .level_height = 90,
+    .min_gap = 20,
+    .background = 0xF8F9FA,
+    .node = 0x3B82F6,
+    .rotation = 0xEF4444,
+    .search = 0x22C55E,
+    .tombstone = 0x94A3B8,
+    .edge = 0x94A3B8,
+    .border = 0x1E2832,
+    .text = 0xFFFFFF,
+};
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile_ms(uint64_t *sorted, size_t n, double p)
+{
+    return n ? (double)sorted[(size_t)(p * (double)(n - 1))] / 1e6 : 0.0;
+}
+
+// Write the frame as a binary PPM for eyeballing the rasterizer
+static void save_ppm(const RenderFrame *frame, const char *path)
+{
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL)
+        return;
+    fprintf(fp, "P6\n%d %d\n255\n", frame->width, frame->height);
+    for (size_t i = 0; i < (size_t)frame->width * (size_t)frame->height; i++)
+    {
+        uint32_t p = frame->pixels[i];
+        unsigned char rgb[3] = {(unsigned char)(p >> 16), (unsigned char)(p >> 8), (unsigned char)p};
+        fwrite(rgb, 1, 3, fp);
+    }
+    fclose(fp);
+}
+
+// Acquire the newest frame; records its latency if it is one not seen yet
+static size_t take_frame(RenderWorker *worker, unsigned long *shown, uint64_t *latency)
+{
+    const RenderFrame *frame = render_acquire(worker);
+    if (frame == NULL || frame->generation == *shown)
+        return 0;
+    *latency = frame->done_ns - frame->submit_ns;
+    *shown = frame->generation;
+    return 1;
+}
+
+// Mutate a tree of n keys `updates` times, submitting after every change.
+// With `paced` the UI waits for each frame; otherwise it keeps mutating
+// and acquires whatever finished, as a busy window would.
+static void run(size_t n, size_t updates, int paced, const char *ppm)
+{
+    AVLTree *tree = create_tree(ENGINE_AVL);
+    uint64_t rng = 11;
+    for (size_t i = 0; i < n; i++)
+        tree_insert(tree, (int)(bench_rand(&rng) % (4 * n)));
+
+    RenderWorker *worker = create_render_worker(&CONFIG, NULL, NULL);
+    uint64_t *latency = (uint64_t *)malloc((updates + 1) * sizeof(uint64_t));
+    size_t frames = 0;
+    uint64_t submit_ns = 0, submit_max = 0;
+    unsigned long shown = 0;
+
+    for (size_t i = 0; i < updates; i++)
+    {
+        int key = (int)(bench_rand(&rng) % (4 * n));
+        if (!tree_insert(tree, key))
+            tree_delete(tree, key);
+
+        uint64_t start = bench_now_ns();
+        render_submit(worker, tree, g_rotation_node, NULL);
+        uint64_t cost = bench_now_ns() - start;
+        submit_ns += cost;
+        if (cost > submit_max)
+            submit_max = cost;
+
+        if (paced)
+            render_wait_idle(worker);
+        frames += take_frame(worker, &shown, &latency[frames]);
+    }
+    render_wait_idle(worker);
+    frames += take_frame(worker, &shown, &latency[frames]);
+
+    RenderStats stats;
+    render_worker_stats(worker, &stats);
+    qsort(latency, frames, sizeof(uint64_t), compare_u64);
+    printf("%9zu | %-6s | submit %6.2f us (max %7.2f) | frame p50 %6.2f ms p99 %6.2f ms max %6.2f ms"
+           " | rendered %6lu/%lu | dropped %6lu | stale %5lu\n",
+           n, paced ? "paced" : "burst", (double)submit_ns / updates / 1e3, (double)submit_max / 1e3,
+           percentile_ms(latency, frames, 0.5), percentile_ms(latency, frames, 0.99),
+           percentile_ms(latency, frames, 1.0), stats.rendered, stats.submitted,
+           stats.dropped_snapshots, stats.stale_frames);
+
+    if (ppm)
+        save_ppm(render_acquire(worker), ppm);
+
+    free(latency);
+    destroy_render_worker(worker);
+    destroy_tree(tree);
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = bench_arg_size(argc, argv, 1000000);
+    const char *ppm = argc > 2 ? argv[2] : NULL;
+    size_t sizes[] = {15, 1000, n};
+
+    printf("Off-thread layout + rasterization, %dx%d canvas (submit = UI-thread cost)\n",
+           CONFIG.width, CONFIG.height);
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        run(sizes[i], 500, 1, i == 0 ? ppm : NULL);
+        run(sizes[i], 5000, 0, NULL);
+    }
+    return 0;
+}
@@ -0,0 +1,132 @@
+#include "sharded_tree.h"
+#include "task_pool.h"
+#include "bench_common.h"
+
+#include <pthread.h>
+
+// Write throughput of one mutex-guarded tree against the key-range sharded
+// tree as writer threads are added, then how a skewed load gets re-cut
+typedef struct
+{
+    pthread_mutex_t *lock; // single-tree mode
+    AVLTree *tree;
+    ShardedTree *sharded;  // sharded mode
+    const int *keys;
+    size_t count;
+} Writer;
+
+static void *write_keys(void *arg)
+{
+    Writer *w = (Writer *)arg;
+    for (size_t i = 0; i < w->count; i++)
+    {
+        if (w->sharded)
+        {
+            sharded_insert(w->sharded, w->keys[i]);
+        }
+        else
+        {
+            pthread_mutex_lock(w->lock);
+            tree_insert(w->tree, w->keys[i]);
+            pthread_mutex_unlock(w->lock);
+        }
+    }
+    return NULL;
+}
+
+// Mops/s for threads writers splitting keys between them
+static double run(int threads, const int *keys, size_t n, AVLTree *tree, ShardedTree *sharded)
+{
+    pthread_mutex_t lock;
+    pthread_mutex_init(&lock, NULL);
+    pthread_t ids[64];
+    Writer writers[64];
+    size_t per = n / (size_t)threads;
+
+    uint64_t start = bench_now_ns();
+    for (int t = 0; t < threads; t++)
+    {
+        writers[t] = (Writer){&lock, tree, sharded, keys + (size_t)t * per, per};
+        pthread_create(&ids[t], NULL, write_keys, &writers[t]);
+    }
+    for (int t = 0; t < threads; t++)
+        pthread_join(ids[t], NULL);
+    double seconds = (double)(bench_now_ns() - start) / 1e9;
+
+    pthread_mutex_destroy(&lock);
+    return (double)(per * (size_t)threads) / seconds / 1e6;
+}
+
+static void print_layout(ShardedTree *sharded)
+{
+    int lower[64];
+    size_t sizes[64];
+    size_t n = sharded_layout(sharded, lower, sizes, 64);
+    unsigned long splits, merges;
+    sharded_counts(sharded, &splits, &merges);
+    printf("%zu shards after %lu splits, %lu merges:", n, splits, merges);
+    for (size_t i = 0; i < n && i < 64; i++)
+        printf(" %zu", sizes[i]);
+    printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = bench_arg_size(argc, argv, 1000000);
+    int max_threads = argc > 2 ? atoi(argv[2]) : 8;
+    if (max_threads > 64)
+        max_threads = 64;
+    size_t shards = 16;
+    uint64_t rng = 43;
+
+    int *keys = (int *)malloc(n * sizeof(int));
+    for (size_t i = 0; i < n; i++)
+        keys[i] = (int)(bench_rand(&rng) % (4 * n));
+
+    printf("%zu random inserts, %zu shards, %d hardware threads\n", n, shards, cpu_count());
+    printf("%8s %14s %14s %8s\n", "threads", "single Mops/s", "sharded Mops/s", "ratio");
+    for (int threads = 1; threads <= max_threads; threads *= 2)
+    {
+        AVLTree *tree = create_tree(ENGINE_AVL);
+        ShardConfig config = {ENGINE_AVL, shards, 0, 0, (int)(4 * n - 1), 0, 1};
+        ShardedTree *sharded = sharded_create(&config);
+
+        double single = run(threads, keys, n, tree, NULL);
+        double split = run(threads, keys, n, NULL, sharded);
+        printf("%8d %14.2f %14.2f %7.2fx\n", threads, single, split, split / single);
+
+        destroy_tree(tree);
+        sharded_destroy(sharded);
+    }
+
+    // All keys land in the bottom sixteenth of the expected range, so at
+    // first one shard takes every write until the skew check re-cuts it
+    for (size_t i = 0; i < n; i++)
+        keys[i] = (int)(bench_rand(&rng) % (n / 4 + 1));
+    for (int auto_rebalance = 0; auto_rebalance <= 1; auto_rebalance++)
+    {
+        ShardConfig config = {ENGINE_AVL, shards, 0, 0, (int)(4 * n - 1), 0, auto_rebalance};
+        ShardedTree *sharded = sharded_create(&config);
+        int threads = max_threads < 4 ? max_threads : 4;
+        double mops = run(threads, keys, n, NULL, sharded);
+        printf("skewed, %d threads, auto rebalance %s: %.2f Mops/s, ", threads,
+               auto_rebalance ? "on " : "off", mops);
+        print_layout(sharded);
+
+        // Re-cutting the piled-up shard afterwards; each split holds two
+        // shard locks for as long as it takes
+        if (!auto_rebalance)
+        {
+            uint64_t start = bench_now_ns();
+            int changes = sharded_rebalance(sharded);
+            double ms = (double)(bench_now_ns() - start) / 1e6;
+            printf("  explicit rebalance: %d changes in %.2f ms (%.3f ms each), ", changes, ms,
+                   changes ? ms / changes : 0.0);
+            print_layout(sharded);
+        }
+        sharded_destroy(sharded);
+    }
+
+    free(keys);
+    return 0;
+}
@@ -0,0 +1,108 @@
+#include "avl_tree.h"
+#include "bench_common.h"
+
+// Rotations and time per operation for one engine and phase
+typedef struct
+{
+    double ns_per_op;
+    double rotations_per_op;
+} PhaseResult;
+
+static PhaseResult finish_phase(AVLTree *tree, uint64_t start, unsigned long rot_before, size_t ops)
+{
+    PhaseResult r;
+    r.ns_per_op = (double)(bench_now_ns() - start) / (double)ops;
+    r.rotations_per_op = (double)(tree->stats.rotations - rot_before) / (double)ops;
+    return r;
+}
+
+static void run_engine(BalanceEngine engine, const int *keys, size_t n, uint64_t seed, int print)
+{
+    AVLTree *tree = create_tree(engine);
+    uint64_t rng = seed;
+
+    // Phase 1: random inserts
+    unsigned long rot = tree->stats.rotations;
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < n; i++)
+        tree_insert(tree, keys[i]);
+    PhaseResult ins = finish_phase(tree, start, rot, n);
+
+    // Phase 2: churn, delete a random present key then insert a fresh one
+    size_t churn_ops = 2 * n;
+    int next_key = (int)(4 * n) + 1;
+    int *live = (int *)malloc(n * sizeof(int));
+    for (size_t i = 0; i < n; i++)
+        live[i] = keys[i];
+
+    rot = tree->stats.rotations;
+    start = bench_now_ns();
+    for (size_t i = 0; i < n; i++)
+    {
+        size_t victim = (size_t)(bench_rand(&rng) % n);
+        tree_delete(tree, live[victim]);
+        live[victim] = next_key++;
+        tree_insert(tree, live[victim]);
+    }
+    PhaseResult churn = finish_phase(tree, start, rot, churn_ops);
+
+    // Phase 3: delete everything in random order
+    bench_shuffle(live, n, &rng);
+    rot = tree->stats.rotations;
+    start = bench_now_ns();
+    for (size_t i = 0; i < n; i++)
+        tree_delete(tree, live[i]);
+    PhaseResult del = finish_phase(tree, start, rot, n);
+
+    // Phase 4: rebuild, then drain in ascending order (worst case for AVL)
+    for (size_t i = 0; i < n; i++)
+        tree_insert(tree, keys[i]);
+    rot = tree->stats.rotations;
+    start = bench_now_ns();
+    for (size_t i = 0; i < n; i++)
+        tree_delete(tree, (int)(i * 4 + 1));
+    PhaseResult drain = finish_phase(tree, start, rot, n);
+
+    if (print)
+    {
+        printf("%-5s | insert %7.1f ns %5.3f rot | churn %7.1f ns %5.3f rot | "
+               "delete %7.1f ns %5.3f rot | drain %7.1f ns %5.3f rot\n",
+               engine_name(engine),
+               ins.ns_per_op, ins.rotations_per_op,
+               churn.ns_per_op, churn.rotations_per_op,
+               del.ns_per_op, del.rotations_per_op,
+               drain.ns_per_op, drain.rotations_per_op);
+
+        TreeStats stats;
+        tree_stats(tree, &stats);
+        double updates = (double)(stats.inserts + stats.deletes);
+        printf("      | retrace %.2f nodes/op | height changes %.3f/op | LL %lu RR %lu LR %lu RL %lu\n",
+               stats.retrace_steps / updates, stats.height_changes / updates,
+               stats.rotations_by_type[ROTATION_LL], stats.rotations_by_type[ROTATION_RR],
+               stats.rotations_by_type[ROTATION_LR], stats.rotations_by_type[ROTATION_RL]);
+    }
+
+    free(live);
+    destroy_tree(tree);
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = bench_arg_size(argc, argv, 1000000);
+    uint64_t rng = 0x9E3779B97F4A7C15ull;
+
+    // Distinct random keys
+    int *keys = (int *)malloc(n * sizeof(int));
+    for (size_t i = 0; i < n; i++)
+        keys[i] = (int)(i * 4 + 1);
+    bench_shuffle(keys, n, &rng);
+
+    printf("AVL vs WAVL rebalancing, n = %zu (per operation)\n", n);
+    // Warm up the allocator so neither engine pays for first-touch page faults
+    run_engine(ENGINE_AVL, keys, n, 42, 0);
+    run_engine(ENGINE_AVL, keys, n, 42, 1);
+    run_engine(ENGINE_WAVL, keys, n, 42, 1);
+
+    free(keys);
+    return 0;
+}
\ No newline at end of file
@@ -1,7 +1,26 @@
 #ifndef AVL_TREE_H
 #define AVL_TREE_H
 
-#include "common.h"
+#include "core.h"
+#include "tree_aggregate.h"
+
+// Hint the cache to fetch a node that is about to be visited
+#if defined(__GNUC__) || defined(__clang__)
+#define PREFETCH_NODE(p) __builtin_prefetch(p)
+#else
+#define PREFETCH_NODE(p) ((void)(p))
+#endif
+
+// Lookups advanced in lockstep by search_batch
+#define SEARCH_BATCH_GROUP 16
+
+// Deepest path any AVL or WAVL tree that fits in memory can have
+#define TREE_MAX_DEPTH 128
+
+// Node flags
+#define NODE_TOMBSTONE 0x1u // lazily deleted, skipped by searches and iterators
+#define NODE_FRESH 0x2u     // persistent trees: copied by the update in progress
+#define NODE_REF_SHIFT 8    // persistent trees: reference count in the bits above
 
 // AVL Node structure
 typedef struct AVLNode
@@ -9,10 +28,27 @@ typedef struct AVLNode
     int key;
     int height;
     int balance_factor;
+    unsigned int flags;
     struct AVLNode *left;
     struct AVLNode *right;
+#ifdef TREE_AGGREGATE
+    TreeAggregate agg; // this subtree, tombstones excluded (tree_aggregate.h)
+#endif
 } AVLNode;
 
+#ifdef TREE_AGGREGATE
+// Recompute a node's aggregate from its children
+static inline void update_aggregate(AVLNode *node)
+{
+    TreeAggregate self = (node->flags & NODE_TOMBSTONE) ? aggregate_empty() : aggregate_of(node->key);
+    TreeAggregate left = node->left ? node->left->agg : aggregate_empty();
+    TreeAggregate right = node->right ? node->right->agg : aggregate_empty();
+    node->agg = aggregate_combine(aggregate_combine(left, self), right);
+}
+#else
+#define update_aggregate(node) ((void)(node))
+#endif
+
 // Rotation types for visualization
 typedef enum
 {
@@ -32,9 +68,84 @@ typedef enum
     OP_DELETE
 } OperationType;
 
-// Global variables for tracking rotations and operations
-extern RotationType g_last_rotation;
-extern AVLNode *g_rotation_node;
+// Rebalancing engines available behind the tree API
+typedef enum
+{
+    ENGINE_AVL,
+    ENGINE_WAVL
+} BalanceEngine;
+
+// Cumulative rebalancing counters kept per tree
+typedef struct TreeStats
+{
+    unsigned long inserts;
+    unsigned long deletes;
+    unsigned long searches;
+    unsigned long rotations;            // structural rotations (a double counts 2)
+    unsigned long rotations_by_type[5]; // rebalancing cases, indexed by RotationType
+    unsigned long retrace_steps;        // ancestors re-checked after insert/delete
+    unsigned long search_visits;        // nodes visited by tree_search
+    unsigned long height_changes;       // height (or rank) updates that changed a node
+    unsigned long compactions;          // tombstone rebuilds
+    size_t tombstones;                  // lazily deleted nodes at query time
+} TreeStats;
+
+// Pool of nodes: either a fixed arena in caller-owned memory (e.g. a
+// shared mapping) or a growable pool of malloc'd chunks owned by the tree.
+// Released nodes are chained through ->left for reuse.
+typedef struct NodeArena
+{
+    AVLNode *nodes; // current block
+    size_t capacity;
+    size_t used; // nodes of the current block handed out so far
+    AVLNode *free_list;
+    size_t chunk_nodes; // growable pools only: nodes per chunk (0 = fixed)
+    AVLNode *chunks;    // growable pools only: chunks, linked through their first node
+    size_t borrowers;   // growable pools only: other trees drawing from it (split/join)
+    const void *group;  // growable pools only: pools of one owner that trade nodes by
+                        // split/join; the owner destroys the whole group at once
+} NodeArena;
+
+// Memory held by a tree, kept up to date by tree_new_node/tree_free_node
+typedef struct TreeMemory
+{
+    size_t live_nodes; // allocated nodes, tombstones included
+    size_t peak_nodes;
+    size_t requested_bytes; // live_nodes * sizeof(AVLNode)
+    size_t reserved_bytes;  // held by the allocator for nodes, headers and unused pool space included
+    size_t peak_reserved_bytes;
+    size_t handle_bytes; // tree handle and pool bookkeeping
+} TreeMemory;
+
+// Tree handle: root plus the engine that keeps it balanced
+typedef struct AVLTree
+{
+    AVLNode *root;
+    BalanceEngine engine;
+    NodeArena *arena; // node source, NULL for malloc
+    size_t size;       // live keys
+    size_t tombstones; // lazily deleted nodes still linked in
+    int lazy_delete;
+    double max_tombstone_ratio;
+    unsigned long version; // bumped by every structural or tombstone change (invalidates fingers)
+    struct KeyIndex *index; // optional key -> node hash (key_index.h), NULL when off
+    struct KeyCache *cache; // optional LRU/TTL bounds (key_cache.h), NULL when off
+    TreeStats stats;
+    TreeMemory memory;
+} AVLTree;
+
+// In-order cursor over live nodes
+typedef struct TreeIterator
+{
+    AVLNode *stack[TREE_MAX_DEPTH];
+    int depth;
+} TreeIterator;
+
+// Global variables for tracking rotations and operations; the last rotation
+// is per thread, so trees updated from other threads (shards) leave the
+// visualizer's alone
+extern _Thread_local RotationType g_last_rotation;
+extern _Thread_local AVLNode *g_rotation_node;
 extern AVLNode *g_found_node;
 extern OperationType g_last_operation;
 
@@ -50,7 +161,61 @@ AVLNode *insert_node(AVLNode *root, int key);
 AVLNode *find_min(AVLNode *node);
 AVLNode *delete_node(AVLNode *root, int key);
 AVLNode *search_node(AVLNode *root, int key);
+void search_batch(AVLNode *root, const int *keys, size_t n, AVLNode **results);
 void free_tree(AVLNode *root);
 int count_nodes(AVLNode *root);
 
+// Tree handle API (dispatches to the selected engine)
+AVLTree *create_tree(BalanceEngine engine);
+void init_tree(AVLTree *tree, BalanceEngine engine);
+void destroy_tree(AVLTree *tree);
+int tree_insert(AVLTree *tree, int key);
+int tree_delete(AVLTree *tree, int key);
+AVLNode *tree_search(AVLTree *tree, int key);
+void tree_search_batch(AVLTree *tree, const int *keys, size_t n, AVLNode **results);
+const char *engine_name(BalanceEngine engine);
+void tree_stats(const AVLTree *tree, TreeStats *out);
+void reset_tree_stats(AVLTree *tree);
+void set_lazy_delete(AVLTree *tree, int enabled, double max_tombstone_ratio);
+double tombstone_ratio(const AVLTree *tree);
+void compact_tree(AVLTree *tree);
+
+// Node allocation (engines go through these so a tree can live in an arena)
+void arena_init(NodeArena *arena, void *memory, size_t bytes);
+void tree_attach_arena(AVLTree *tree, NodeArena *arena);
+int tree_use_pool(AVLTree *tree, size_t chunk_nodes);
+AVLNode *tree_new_node(AVLTree *tree, int key);
+void tree_free_node(AVLTree *tree, AVLNode *node);
+void tree_release(AVLTree *tree, AVLNode *root);
+int tree_replace_chunks(AVLTree *tree, AVLNode *chunk, size_t nodes, size_t used, size_t chunk_nodes);
+void tree_free_unpooled(AVLTree *tree, AVLNode *node);
+
+// Memory accounting
+void tree_memory(const AVLTree *tree, TreeMemory *out);
+double tree_bytes_per_key(const AVLTree *tree);
+void account_node_allocs(AVLTree *tree, const AVLNode *sample, size_t count);
+size_t tree_adopt_nodes(AVLTree *to, AVLTree *from, AVLNode *root);
+
+// In-order iteration (tombstones skipped)
+void tree_iter_first(TreeIterator *it, AVLTree *tree);
+void tree_iter_seek(TreeIterator *it, AVLTree *tree, int key);
+AVLNode *tree_iter_next(TreeIterator *it);
+
+// Shared by the engines: records a rebalancing case for the tree and the GUI
+void record_rotation(AVLTree *tree, RotationType type, AVLNode *node);
+void account_removal(AVLTree *tree, AVLNode *node);
+
+// One bottom-up retrace step after an insert below node (used by fingers)
+AVLNode *rebalance_after_insert(AVLTree *tree, AVLNode *node, int from_left);
+// Stamp a written key in the tree's cache and evict what its limits no
+// longer allow; returns inserted, or 1 if the key had expired
+int cache_write(AVLTree *tree, int key, int inserted);
+
+#ifdef TREE_AGGREGATE
+// Aggregate of the live keys in [lo, hi], in O(log n)
+TreeAggregate aggregate_range(const AVLTree *tree, int lo, int hi);
+// Refresh aggregates from key's node up to the root (after a tombstone flip)
+void refresh_aggregates(AVLTree *tree, int key);
+#endif
+
 #endif // AVL_TREE_H
\ No newline at end of file
@@ -2,10 +2,7 @@
 #define COMMON_H
 
 #include <windows.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <time.h>
+#include "core.h"
 
 // Window dimensions
 #define WINDOW_WIDTH 1200
@@ -0,0 +1,12 @@
+#ifndef CORE_H
+#define CORE_H
+
+// Platform-free base for the tree core and headless tools.
+// GUI-only constants and <windows.h> live in common.h.
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#endif // CORE_H
\ No newline at end of file
@@ -0,0 +1,28 @@
+#ifndef FINGER_H
+#define FINGER_H
+
+#include "avl_tree.h"
+
+#define FINGER_MAX_DEPTH TREE_MAX_DEPTH
+
+// Cursor remembering the last access path and the key range each node on
+// it covers. The next search climbs only to the lowest ancestor whose
+// range contains the new key. Sequential access costs amortized O(1) per
+// key; any other access is O(log n) in the worst case, since two adjacent
+// keys on either side of a high ancestor still climb all the way to it.
+// Any mutation not made through the finger invalidates it (tree->version).
+typedef struct TreeFinger
+{
+    AVLTree *tree;
+    unsigned long version;
+    int depth;
+    AVLNode *path[FINGER_MAX_DEPTH];
+    long long lo[FINGER_MAX_DEPTH]; // exclusive bounds of path[i]'s subtree
+    long long hi[FINGER_MAX_DEPTH];
+} TreeFinger;
+
+void finger_init(TreeFinger *finger, AVLTree *tree);
+AVLNode *finger_search(TreeFinger *finger, int key);
+int finger_insert(TreeFinger *finger, int key);
+
+#endif // FINGER_H
\ No newline at end of file
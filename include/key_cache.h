@@ -0,0 +1,102 @@
+#ifndef KEY_CACHE_H
+#define KEY_CACHE_H
+
+#include "avl_tree.h"
+
+#include <stdint.h>
+
+// Optional bounded-cache mode: LRU and TTL eviction for a tree used as an
+// ordered cache.
+//
+// Every live key has an entry on two intrusive lists threaded through one
+// entry array: a recency list (searches and writes move the key to the
+// back) and an expiry list (writes stamp the key with now + ttl). Writes
+// that leave the tree over its limit evict from the front of the lists,
+// expired keys first, so nothing ever scans the tree. Expired keys read as
+// absent right away; tree_insert removes a few of them per call and
+// tree_cache_sweep clears them in bulk.
+//
+// The limit is the smaller of max_keys and max_bytes divided by what a key
+// costs: its node, its cache entry and table slots and, if the tree has
+// one, its hash index slots. Calling tree_enable_cache again reconfigures a
+// live cache and evicts down to the new limit at once.
+//
+// tree_insert, tree_delete and fingers keep the cache exact; every search,
+// through a finger or not, checks expiry and refreshes recency, even on a
+// stale cache. Bulk updates (imports, split/join, range deletion) leave it
+// stale; the next write reconciles it in O(n), adding new keys as least
+// recent. So does any other change to tree->version the cache was not told
+// about; compaction and relocation keep the keys and keep the cache exact.
+//
+// While a cache is attached, deletes and evictions unlink nodes even in
+// lazy-delete mode (and enabling one compacts existing tombstones), so the
+// limits count every node the tree holds.
+
+#define CACHE_NIL UINT32_MAX
+#define CACHE_SWEEP_STEP 2 // expired keys tree_insert removes beyond what the limit needs
+
+typedef uint64_t (*CacheClock)(void); // milliseconds
+
+typedef struct CacheConfig
+{
+    size_t max_keys;  // 0 = no key limit
+    size_t max_bytes; // 0 = no memory limit
+    uint64_t ttl_ms;  // 0 = keys never expire
+    CacheClock clock; // NULL = wall clock
+} CacheConfig;
+
+typedef struct CacheEntry
+{
+    int key;
+    uint32_t lru_prev, lru_next; // recency order, front = least recent (lru_next chains free entries)
+    uint32_t exp_prev, exp_next; // expiry order, front = expires first
+    uint32_t seen;               // reconcile pass that last found the key
+    uint64_t expires;            // clock time, 0 = never
+} CacheEntry;
+
+typedef struct KeyCache
+{
+    CacheConfig config;
+    size_t limit; // keys allowed
+    CacheEntry *entries;
+    size_t entry_capacity;
+    size_t count;
+    uint32_t free_entry;
+    uint32_t *slots; // key -> entry, linear probing, CACHE_NIL = empty
+    size_t capacity; // power of two
+    unsigned shift;  // 64 - log2(capacity)
+    uint32_t lru_head, lru_tail;
+    uint32_t exp_head, exp_tail;
+    uint32_t pass;
+    unsigned long version; // tree version the cache matches
+    int broken;            // a key could not be tracked; reconcile before use
+    unsigned long evictions;
+    unsigned long expirations;
+} KeyCache;
+
+// Enable or reconfigure; returns 0 on allocation failure (the tree is then
+// left without a cache)
+int tree_enable_cache(AVLTree *tree, const CacheConfig *config);
+void tree_disable_cache(AVLTree *tree);
+
+// Remove up to budget expired keys; returns how many went
+size_t tree_cache_sweep(AVLTree *tree, size_t budget);
+
+// Hooks for tree_insert/tree_delete/finger_insert/the searches. cache_sync reconciles a
+// stale cache and returns whether the tree has a usable one; an update
+// that kept it exact ends with cache_catch_up(tree, cached).
+int cache_sync(AVLTree *tree);
+int cache_in_step(const AVLTree *tree);
+void cache_catch_up(AVLTree *tree, int cached);
+
+// Stamp key as just written; returns 1 if it was expired until now
+int cache_admit(AVLTree *tree, int key);
+// Mark key as just read; returns 0 if it has expired
+int cache_touch(AVLTree *tree, int key);
+// Drop key's entry; returns 0 if it had expired
+int cache_forget(AVLTree *tree, int key);
+// Pop the next key the limits or an expiry (while *expired_budget lasts)
+// want gone; the caller removes it from the tree
+int cache_next_victim(AVLTree *tree, int *key, size_t *expired_budget);
+
+#endif // KEY_CACHE_H
@@ -0,0 +1,55 @@
+#ifndef KEY_IMPORT_H
+#define KEY_IMPORT_H
+
+#include "avl_tree.h"
+
+// Bulk import of key files into a tree.
+//
+// The file is mapped read-only and parsed in place: decimal text (any
+// non-digit bytes separate keys, '-' signs allowed) is read eight bytes at a
+// time with a SWAR digit parser, raw binary is little-endian int32. Keys are
+// gathered into chunks of at most chunk_keys, sorted (skipped when already
+// in order) and de-duplicated. A chunk whose keys all lie above the tree's
+// current maximum is built in O(k) and joined on, so sorted input builds in
+// O(n) overall. Other chunks are merged with a finger walking through them in
+// order. Pages of the file behind the parser are dropped as it advances, so
+// resident memory stays around two chunk buffers plus the tree.
+//
+// POSIX only; not available in Windows builds.
+
+typedef enum
+{
+    IMPORT_AUTO, // text unless the first 4 KiB hold bytes text never has
+    IMPORT_TEXT,
+    IMPORT_BINARY
+} ImportFormat;
+
+typedef struct ImportOptions
+{
+    ImportFormat format;
+    size_t chunk_keys; // 0 = IMPORT_DEFAULT_CHUNK
+} ImportOptions;
+
+#define IMPORT_DEFAULT_CHUNK ((size_t)1 << 20)
+
+typedef struct ImportStats
+{
+    ImportFormat format; // as detected
+    size_t bytes;
+    size_t keys;       // keys parsed
+    size_t inserted;   // new keys added to the tree
+    size_t duplicates; // repeated within the file or already in the tree
+    size_t malformed;  // out-of-range numbers, trailing binary bytes
+    size_t chunks;
+    size_t appended_chunks; // built in O(k) and joined rather than merged
+    double seconds;
+    double mb_per_sec;
+    double keys_per_sec;
+} ImportStats;
+
+// Returns 1 on success, 0 if the file cannot be read (errno is set) or the
+// tree runs out of nodes. stats may be NULL.
+int tree_import_file(AVLTree *tree, const char *path, const ImportOptions *options, ImportStats *stats);
+const char *import_format_name(ImportFormat format);
+
+#endif // KEY_IMPORT_H
@@ -0,0 +1,51 @@
+#ifndef KEY_INDEX_H
+#define KEY_INDEX_H
+
+#include "avl_tree.h"
+
+// Optional hash side index: key -> node for exact-match lookups.
+//
+// An open-addressing table (linear probing, backward-shift deletion, load
+// at most 1/2) that tree_search, tree_search_batch and the duplicate and
+// absence checks in tree_insert/tree_delete consult instead of descending
+// the tree. Ordered operations still use the tree.
+//
+// The engines keep the index in step as nodes are created, freed or take
+// over another node's key. Operations that move nodes wholesale (split,
+// join, relocation, parallel builds, persistent updates) leave it stale;
+// it is rebuilt in O(n) on the next lookup. Its table counts towards the
+// tree's handle_bytes.
+
+typedef struct KeySlot
+{
+    int key;
+    AVLNode *node; // NULL = empty
+} KeySlot;
+
+typedef struct KeyIndex
+{
+    KeySlot *slots;
+    size_t capacity; // power of two
+    unsigned shift;  // 64 - log2(capacity)
+    size_t count;
+    unsigned long version; // tree version the index matches
+    int broken;            // an insert could not grow the table
+} KeyIndex;
+
+// Returns 0 on allocation failure (the tree is left without an index)
+int tree_enable_index(AVLTree *tree);
+void tree_disable_index(AVLTree *tree);
+
+// Engine hooks; no-ops for trees without an index
+void index_note(AVLTree *tree, AVLNode *node);
+void index_forget(AVLTree *tree, AVLNode *node);
+
+// Look key up; returns 0 if the tree has no usable index and must be searched
+int index_lookup(AVLTree *tree, int key, AVLNode **node);
+
+// Updates that keep the index exact bracket themselves with these:
+// in_step = index_in_step(tree); ...; index_catch_up(tree, in_step)
+int index_in_step(const AVLTree *tree);
+void index_catch_up(AVLTree *tree, int in_step);
+
+#endif // KEY_INDEX_H
@@ -0,0 +1,14 @@
+#ifndef PARALLEL_TREE_H
+#define PARALLEL_TREE_H
+
+#include "avl_tree.h"
+#include "task_pool.h"
+
+// Whole-tree operations split over disjoint subtrees.
+// Passing a NULL pool runs them serially on the calling thread.
+void parallel_free_tree(TaskPool *pool, AVLNode *root);
+size_t parallel_count_nodes(TaskPool *pool, AVLNode *root);
+int validate_tree(const AVLTree *tree, TaskPool *pool);
+int build_tree_from_sorted(AVLTree *tree, const int *keys, size_t n, TaskPool *pool);
+
+#endif // PARALLEL_TREE_H
\ No newline at end of file
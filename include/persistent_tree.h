@@ -0,0 +1,51 @@
+#ifndef PERSISTENT_TREE_H
+#define PERSISTENT_TREE_H
+
+#include "avl_tree.h"
+
+// Persistent (path-copying) AVL or WAVL tree with undo/redo history.
+//
+// Updates never modify a reachable node: insert and delete copy the
+// O(log n) nodes on the search path (plus any sibling a rotation touches)
+// and share every other subtree with the previous version, so each version
+// costs O(log n) nodes and older versions stay readable. Nodes are shared by
+// reference count, kept in the upper bits of AVLNode.flags; a node is freed
+// when the last version or parent referencing it goes away.
+//
+// Each update becomes the current version and is appended to a bounded
+// history that ptree_undo/ptree_redo move through. ptree_snapshot hands out
+// an independent version handle that survives history eviction until it is
+// released. Versions are immutable, so a retained version may be searched
+// from another thread while the owner keeps updating (reference counts are
+// only touched by the owning thread).
+
+typedef struct PersistentTree PersistentTree;
+
+// Immutable tree version
+typedef struct TreeVersion
+{
+    AVLNode *root;
+    size_t size;
+} TreeVersion;
+
+PersistentTree *ptree_create(BalanceEngine engine, size_t max_history);
+void ptree_destroy(PersistentTree *pt);
+AVLTree *ptree_handle(PersistentTree *pt);
+
+// Updates: 1 if the key was inserted/removed (a new version), 0 if not
+int ptree_insert(PersistentTree *pt, int key);
+int ptree_delete(PersistentTree *pt, int key);
+
+// History: 1 if the current version moved
+int ptree_undo(PersistentTree *pt);
+int ptree_redo(PersistentTree *pt);
+size_t ptree_undo_depth(const PersistentTree *pt);
+size_t ptree_redo_depth(const PersistentTree *pt);
+
+// Version handles (release every snapshot before ptree_destroy)
+TreeVersion ptree_snapshot(PersistentTree *pt);
+void ptree_release(PersistentTree *pt, TreeVersion version);
+void ptree_checkout(PersistentTree *pt, TreeVersion version);
+AVLNode *version_search(TreeVersion version, int key);
+
+#endif // PERSISTENT_TREE_H
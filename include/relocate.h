@@ -0,0 +1,63 @@
+#ifndef RELOCATE_H
+#define RELOCATE_H
+
+#include "avl_tree.h"
+
+// Locality-restoring node relocation.
+//
+// Nodes allocated one at a time over a long run of inserts and deletes end
+// up scattered across the heap, so every step of a search is a likely cache
+// and TLB miss. Relocation copies all nodes into one contiguous block in an
+// order that keeps each search's path close together, then swaps the copies
+// in:
+//
+//   LAYOUT_VEB  van Emde Boas: the top half of the levels first, then each
+//               subtree below it, recursively; cache-oblivious
+//   LAYOUT_BFS  level by level; the top levels share a few cache lines
+//
+// The work runs in bounded steps so it can fill idle time. The tree stays
+// usable between steps, but any change to it discards the copies made so far
+// and the next step starts over. Once everything is copied the copies
+// replace the old nodes in O(1) and old malloc'd nodes are freed over the
+// following steps.
+//
+// Afterwards the tree draws nodes from a pool whose first chunk is the block:
+// a malloc tree is converted, a pooled tree drops its old chunks. Split and
+// join still work, as the other tree then shares the pool. Trees in fixed
+// arenas, in pools shared that way or in a pool group are refused, and
+// trees owned by a PersistentTree must not be relocated. Node pointers held
+// across the swap (search results, iterators) go stale.
+
+typedef enum
+{
+    LAYOUT_VEB,
+    LAYOUT_BFS
+} NodeLayout;
+
+typedef enum
+{
+    RELOCATE_RUNNING, // more steps needed
+    RELOCATE_DONE,
+    RELOCATE_FAILED // out of memory; the tree keeps its old nodes
+} RelocateStatus;
+
+// Pool chunk size for malloc trees converted by a relocation
+#define RELOCATE_POOL_CHUNK 1024
+
+typedef struct Relocation Relocation;
+
+// Returns NULL if the tree cannot be relocated or on allocation failure
+Relocation *relocation_start(AVLTree *tree, NodeLayout layout);
+// Copy or free up to budget nodes
+RelocateStatus relocation_step(Relocation *relocation, size_t budget);
+// Times the copy was discarded because the tree changed
+unsigned long relocation_restarts(const Relocation *relocation);
+// Abandon an unfinished copy, or finish freeing old nodes. Must be called
+// before the tree is destroyed.
+void relocation_free(Relocation *relocation);
+
+// Relocate in one go; returns 1 on success
+int tree_relocate(AVLTree *tree, NodeLayout layout);
+const char *layout_name(NodeLayout layout);
+
+#endif // RELOCATE_H
@@ -0,0 +1,78 @@
+#ifndef RENDER_WORKER_H
+#define RENDER_WORKER_H
+
+#include "avl_tree.h"
+
+#include <stdint.h>
+
+// Off-thread tree layout and rasterization for the visualizer.
+//
+// After each mutation the UI thread submits the tree: the levels that can
+// appear on the canvas are copied into an immutable snapshot and handed to
+// a worker thread, which lays them out and draws into a private back
+// buffer. Finished frames are published latest-wins: a snapshot replaced
+// before the worker picks it up, or a frame replaced before the UI
+// acquires it, is dropped. Portable C11 + pthreads, no GUI dependency.
+
+// Node look for a snapshot entry
+#define RENDER_MARK_ROTATION 0x1u  // node involved in the last rebalance
+#define RENDER_MARK_SEARCH 0x2u    // node found by the last search
+#define RENDER_MARK_TOMBSTONE 0x4u // lazily deleted
+#define RENDER_MARK_LEFT_MORE 0x8u // left child exists below the snapshot
+#define RENDER_MARK_RIGHT_MORE 0x10u
+
+// Canvas geometry and palette; colors are 0xRRGGBB
+typedef struct RenderConfig
+{
+    int width;
+    int height;
+    int top;    // y of the root's centre
+    int margin; // horizontal space left free on both sides
+    int node_radius;
+    int level_height;
+    int min_gap;
+    uint32_t background;
+    uint32_t node;
+    uint32_t rotation;
+    uint32_t search;
+    uint32_t tombstone;
+    uint32_t edge;
+    uint32_t border;
+    uint32_t text;
+} RenderConfig;
+
+// A finished frame: width * height pixels, 0x00RRGGBB, rows top-down
+typedef struct RenderFrame
+{
+    uint32_t *pixels;
+    int width;
+    int height;
+    unsigned long generation; // submission this frame shows
+    size_t nodes;             // nodes drawn, 0 for an empty tree
+    uint64_t submit_ns;       // when the snapshot was taken
+    uint64_t done_ns;         // when rasterization finished
+} RenderFrame;
+
+typedef struct RenderStats
+{
+    unsigned long submitted;
+    unsigned long rendered;
+    unsigned long dropped_snapshots; // replaced before the worker started them
+    unsigned long stale_frames;      // finished but replaced before acquisition
+} RenderStats;
+
+typedef struct RenderWorker RenderWorker;
+
+// Called on the worker thread after each published frame
+typedef void (*FrameReadyFn)(void *ctx);
+
+RenderWorker *create_render_worker(const RenderConfig *config, FrameReadyFn on_ready, void *ctx);
+void destroy_render_worker(RenderWorker *worker);
+unsigned long render_submit(RenderWorker *worker, const AVLTree *tree, const AVLNode *rotation,
+                            const AVLNode *found);
+const RenderFrame *render_acquire(RenderWorker *worker);
+void render_wait_idle(RenderWorker *worker);
+void render_worker_stats(RenderWorker *worker, RenderStats *out);
+uint64_t render_now_ns(void);
+
+#endif // RENDER_WORKER_H
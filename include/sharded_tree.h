@@ -0,0 +1,65 @@
+#ifndef SHARDED_TREE_H
+#define SHARDED_TREE_H
+
+#include "avl_tree.h"
+
+// Key-range sharded container for concurrent writers.
+//
+// The key space is cut into contiguous ranges, each held by its own tree
+// with its own mutex and node pool, so writers to different ranges never
+// share a lock or an allocator. A small boundary table (lowest key of each
+// shard, in key order) routes point operations by binary search. Readers
+// of the table take no lock: the shard's mutex guards its real bounds, and
+// an operation that lands on a shard no longer owning its key retries.
+//
+// Range scans walk the shards in key order, one lock at a time, so each
+// shard's part is consistent but the whole is not a snapshot.
+//
+// A fair share is the total over the configured shard count. A shard
+// holding more than two fair shares is split at its root key into a spare
+// slot; two neighbours that together hold less than half a share are
+// merged. Keys move by relinking nodes with tree_split/tree_join, never by
+// copying: the shard pools form one group (NodeArena.group), so a node may
+// end up in a neighbour's tree while its chunk stays with the pool it came
+// from, and every chunk lives until sharded_destroy. A merge is one
+// O(log n) join. A split hands keys over from the top in batches of
+// SHARD_MOVE_BATCH, so it holds the two shard locks for O(batch + log n)
+// at a time. With auto_rebalance, writers check their shard's share every
+// SHARD_CHECK_INTERVAL writes and one of them runs the pass.
+
+#define SHARD_POOL_CHUNK 1024     // default nodes per pool chunk
+#define SHARD_CHECK_INTERVAL 1024 // writes to a shard between skew checks
+#define SHARD_MIN_SPLIT 1024      // shards smaller than this are never split
+#define SHARD_MOVE_BATCH 4096     // keys a split hands over per lock hold
+
+typedef struct ShardConfig
+{
+    BalanceEngine engine;
+    size_t shards;      // initial partitions of [key_lo, key_hi]
+    size_t max_shards;  // slots available to splits (0 = 4 * shards)
+    int key_lo, key_hi; // expected keys; the end shards also take anything outside
+    size_t pool_chunk;  // 0 = SHARD_POOL_CHUNK
+    int auto_rebalance;
+} ShardConfig;
+
+typedef struct ShardedTree ShardedTree;
+
+ShardedTree *sharded_create(const ShardConfig *config);
+void sharded_destroy(ShardedTree *st);
+
+// Same results as tree_insert / tree_delete / tree_search != NULL
+int sharded_insert(ShardedTree *st, int key);
+int sharded_delete(ShardedTree *st, int key);
+int sharded_contains(ShardedTree *st, int key);
+
+// Keys in [lo, hi] in ascending order, at most max; returns how many
+size_t sharded_range(ShardedTree *st, int lo, int hi, int *out, size_t max);
+
+size_t sharded_size(ShardedTree *st);
+// Active shards; fills up to max lowest keys and sizes in key order
+size_t sharded_layout(ShardedTree *st, int *lower, size_t *sizes, size_t max);
+// Split and merge until no shard is out of proportion; returns the changes
+int sharded_rebalance(ShardedTree *st);
+void sharded_counts(ShardedTree *st, unsigned long *splits, unsigned long *merges);
+
+#endif // SHARDED_TREE_H
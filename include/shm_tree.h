@@ -0,0 +1,60 @@
+#ifndef SHM_TREE_H
+#define SHM_TREE_H
+
+#include "avl_tree.h"
+
+// Tree living in a POSIX shared-memory segment (shm_open + mmap).
+//
+// One writer process creates the segment, sets the tree up (bulk loads,
+// index) and publishes it; readers cannot attach before that. From then on
+// it mutates the tree through the normal tree API, searches included since
+// they update counters, between shm_write_begin/shm_write_end; nodes come from a
+// NodeArena inside the segment. Links in the segment are the writer's raw
+// pointers, since the engines are shared with ordinary trees; they are not
+// stored as offsets. Readers attach read-only at any address and translate
+// each link by subtracting the writer's base address recorded in the
+// header, bounds-checking the result before following it, so searches and
+// walks run directly against the mapping without copying. Writes are
+// published with a seqlock: the sequence is odd while an update is in
+// progress and readers retry if it moved under them. A reader that finds
+// an update still open after SHM_READ_TIMEOUT_MS (the writer died or hung
+// mid-update) gives up and reports failure instead of spinning forever.
+//
+// POSIX only; not available in Windows builds.
+
+#define SHM_READ_TIMEOUT_MS 1000
+#define SHM_READ_FAILED ((size_t)-1) // size/collect result when a read timed out
+
+typedef struct ShmTree ShmTree;
+
+// One node seen by shm_tree_collect, in key order
+typedef struct ShmEntry
+{
+    int key;
+    int depth; // 0 at the root
+} ShmEntry;
+
+// Writer
+ShmTree *shm_tree_create(const char *name, size_t max_nodes, BalanceEngine engine);
+AVLTree *shm_tree_handle(ShmTree *shm);
+void shm_tree_publish(ShmTree *shm);
+void shm_write_begin(ShmTree *shm);
+void shm_write_end(ShmTree *shm);
+int shm_tree_insert(ShmTree *shm, int key);
+int shm_tree_delete(ShmTree *shm, int key);
+
+// Readers. Search returns 1/0, or -1 if the read timed out.
+ShmTree *shm_tree_attach(const char *name);
+int shm_tree_search(ShmTree *shm, int key);
+size_t shm_tree_collect(ShmTree *shm, int lo, int hi, int max_depth, ShmEntry *out, size_t cap);
+size_t shm_tree_size(ShmTree *shm);
+unsigned long shm_tree_generation(const ShmTree *shm);
+unsigned long shm_tree_retries(const ShmTree *shm);
+size_t shm_tree_capacity(const ShmTree *shm);
+BalanceEngine shm_tree_engine(const ShmTree *shm);
+
+// Both sides
+void shm_tree_detach(ShmTree *shm);
+int shm_tree_unlink(const char *name);
+
+#endif // SHM_TREE_H
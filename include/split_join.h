@@ -0,0 +1,31 @@
+#ifndef SPLIT_JOIN_H
+#define SPLIT_JOIN_H
+
+#include "avl_tree.h"
+
+// Split and join for both engines. Nodes are relinked, never copied: a
+// split or join does O(log n) rotations and rank/height updates, and a
+// range operation is two splits and a join plus O(k) for the k nodes it
+// hands over or frees. Tombstones move with their keys.
+//
+// Trees exchanging nodes must use the same engine and allocator: both
+// malloc, or the same fixed arena or pool (an empty malloc tree adopts the
+// other's), or pools of one group (NodeArena.group). A shared pool is freed
+// with the last tree drawing from it and can no longer be relocated.
+
+// Move the keys >= key into right, which must be empty. O(log n) relinking
+// plus a walk over the smaller side to split the size and memory counts.
+int tree_split(AVLTree *tree, int key, AVLTree *right);
+
+// Append right, whose keys must all be greater than left's, and leave it
+// empty. O(log n).
+int tree_join(AVLTree *left, AVLTree *right);
+
+// Detach the keys in [lo, hi] as a new tree sharing its allocator (NULL on
+// allocation failure)
+AVLTree *tree_extract_range(AVLTree *tree, int lo, int hi);
+
+// Free the keys in [lo, hi]; returns the number of live keys removed
+size_t tree_delete_range(AVLTree *tree, int lo, int hi);
+
+#endif // SPLIT_JOIN_H
@@ -0,0 +1,30 @@
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+#include <stdatomic.h>
+
+// Work-stealing pool for fork-join tree walks.
+// Each worker owns a deque: it pushes and pops at the bottom, idle workers
+// steal from the top. The thread that calls task_group_wait helps run tasks,
+// so nested spawns never block a worker. One external thread at a time may
+// drive a pool.
+typedef void (*TaskFn)(void *arg);
+
+typedef struct TaskPool TaskPool;
+
+// Completion counter for a set of spawned tasks
+typedef struct TaskGroup
+{
+    atomic_long pending;
+} TaskGroup;
+
+TaskPool *create_task_pool(int threads);
+void destroy_task_pool(TaskPool *pool);
+int task_pool_threads(const TaskPool *pool);
+int cpu_count(void);
+
+void task_group_init(TaskGroup *group);
+void task_spawn(TaskPool *pool, TaskGroup *group, TaskFn fn, void *arg);
+void task_group_wait(TaskPool *pool, TaskGroup *group);
+
+#endif // TASK_POOL_H
\ No newline at end of file
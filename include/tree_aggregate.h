@@ -0,0 +1,63 @@
+#ifndef TREE_AGGREGATE_H
+#define TREE_AGGREGATE_H
+
+// Compile-time subtree aggregates.
+//
+// Built with TREE_AGGREGATE defined (make AGGREGATE=1), every node carries
+// the aggregate of its subtree, tombstones excluded, refreshed wherever its
+// height or rank is (update_height, the rotations, the WAVL retrace) and
+// along the path of a tombstone flip. aggregate_range(tree, lo, hi) then
+// combines O(log n) of them. Without it nodes keep their size and every
+// hook compiles away.
+//
+// The set is pluggable: point TREE_AGGREGATE_HEADER at a header (make
+// AGGREGATE_HEADER=my_set.h) defining TreeAggregate and the four functions
+// below. aggregate_combine gets its arguments in key order, so it need not
+// be commutative, but must be associative with aggregate_empty() as its
+// identity. The default set is count, sum, min and max of the keys.
+
+#ifdef TREE_AGGREGATE
+#ifdef TREE_AGGREGATE_HEADER
+#include TREE_AGGREGATE_HEADER
+#else
+#include <limits.h>
+#include <stddef.h>
+
+typedef struct TreeAggregate
+{
+    size_t count;
+    long long sum;
+    int min; // INT_MAX when empty
+    int max; // INT_MIN when empty
+} TreeAggregate;
+
+static inline TreeAggregate aggregate_empty(void)
+{
+    TreeAggregate a = {0, 0, INT_MAX, INT_MIN};
+    return a;
+}
+
+static inline TreeAggregate aggregate_of(int key)
+{
+    TreeAggregate a = {1, key, key, key};
+    return a;
+}
+
+static inline TreeAggregate aggregate_combine(TreeAggregate left, TreeAggregate right)
+{
+    TreeAggregate a;
+    a.count = left.count + right.count;
+    a.sum = left.sum + right.sum;
+    a.min = left.min < right.min ? left.min : right.min;
+    a.max = left.max > right.max ? left.max : right.max;
+    return a;
+}
+
+static inline int aggregate_equal(TreeAggregate a, TreeAggregate b)
+{
+    return a.count == b.count && a.sum == b.sum && a.min == b.min && a.max == b.max;
+}
+#endif // TREE_AGGREGATE_HEADER
+#endif // TREE_AGGREGATE
+
+#endif // TREE_AGGREGATE_H
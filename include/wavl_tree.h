@@ -0,0 +1,15 @@
+#ifndef WAVL_TREE_H
+#define WAVL_TREE_H
+
+#include "avl_tree.h"
+
+// Weak AVL (rank-balanced) engine.
+// Ranks are stored in AVLNode.height as rank + 1 so that missing children
+// keep height 0 (rank -1). Without deletions the ranks equal AVL heights;
+// deletions do at most two rotations and O(1) amortized rank changes.
+AVLNode *wavl_insert_node(AVLTree *tree, AVLNode *root, int key);
+AVLNode *wavl_delete_node(AVLTree *tree, AVLNode *root, int key);
+AVLNode *wavl_insert_fix(AVLTree *tree, AVLNode *p, int from_left);
+AVLNode *wavl_delete_fix(AVLTree *tree, AVLNode *p, int from_left);
+
+#endif // WAVL_TREE_H
\ No newline at end of file
@@ -1,8 +1,15 @@
 #include "avl_tree.h"
+#include "key_cache.h"
+#include "key_index.h"
+#include "wavl_tree.h"
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
 
 // Global variables for visualization
-RotationType g_last_rotation = ROTATION_NONE;
-AVLNode *g_rotation_node = NULL;
+_Thread_local RotationType g_last_rotation = ROTATION_NONE;
+_Thread_local AVLNode *g_rotation_node = NULL;
 AVLNode *g_found_node = NULL;
 OperationType g_last_operation = OP_NONE;
 
@@ -16,8 +23,10 @@ AVLNode *create_node(int key)
     node->key = key;
     node->height = 1;
     node->balance_factor = 0;
+    node->flags = 0;
     node->left = NULL;
     node->right = NULL;
+    update_aggregate(node);
     return node;
 }
 
@@ -43,10 +52,11 @@ void update_height(AVLNode *node)
     int right_h = height(node->right);
     node->height = (left_h > right_h ? left_h : right_h) + 1;
     node->balance_factor = left_h - right_h;
+    update_aggregate(node);
 }
 
-// Right rotation (LL case)
-AVLNode *rotate_right(AVLNode *y)
+// Relink a right rotation and refresh heights, no bookkeeping
+static AVLNode *relink_right(AVLNode *y)
 {
     AVLNode *x = y->left;
     AVLNode *T2 = x->right;
@@ -59,14 +69,11 @@ AVLNode *rotate_right(AVLNode *y)
     update_height(y);
     update_height(x);
 
-    g_last_rotation = ROTATION_LL;
-    g_rotation_node = x;
-
     return x;
 }
 
-// Left rotation (RR case)
-AVLNode *rotate_left(AVLNode *x)
+// Relink a left rotation and refresh heights, no bookkeeping
+static AVLNode *relink_left(AVLNode *x)
 {
     AVLNode *y = x->right;
     AVLNode *T2 = y->left;
@@ -79,72 +86,143 @@ AVLNode *rotate_left(AVLNode *x)
     update_height(x);
     update_height(y);
 
+    return y;
+}
+
+// Right rotation (LL case)
+AVLNode *rotate_right(AVLNode *y)
+{
+    AVLNode *x = relink_right(y);
+    g_last_rotation = ROTATION_LL;
+    g_rotation_node = x;
+    return x;
+}
+
+// Left rotation (RR case)
+AVLNode *rotate_left(AVLNode *x)
+{
+    AVLNode *y = relink_left(x);
     g_last_rotation = ROTATION_RR;
     g_rotation_node = y;
+    return y;
+}
 
+// Record one rebalancing case (a double rotation is one LR/RL event)
+void record_rotation(AVLTree *tree, RotationType type, AVLNode *node)
+{
+    g_last_rotation = type;
+    g_rotation_node = node;
+    if (tree)
+        tree->stats.rotations_by_type[type]++;
+}
+
+// Count a structural rotation and the heights it changed
+static AVLNode *tree_rotate_right(AVLTree *tree, AVLNode *y)
+{
+    if (tree == NULL)
+        return relink_right(y);
+
+    AVLNode *x = y->left;
+    int old_y = y->height, old_x = x->height;
+    relink_right(y);
+
+    tree->stats.rotations++;
+    tree->stats.height_changes += (y->height != old_y) + (x->height != old_x);
+    return x;
+}
+
+static AVLNode *tree_rotate_left(AVLTree *tree, AVLNode *x)
+{
+    if (tree == NULL)
+        return relink_left(x);
+
+    AVLNode *y = x->right;
+    int old_x = x->height, old_y = y->height;
+    relink_left(x);
+
+    tree->stats.rotations++;
+    tree->stats.height_changes += (x->height != old_x) + (y->height != old_y);
     return y;
 }
 
-// Balance the node
-AVLNode *balance_node(AVLNode *node)
+// Balance the node, charging the work to tree (may be NULL)
+static AVLNode *balance_in(AVLTree *tree, AVLNode *node)
 {
     if (node == NULL)
         return NULL;
 
+    int old_height = node->height;
     update_height(node);
     int bf = balance_factor(node);
 
+    if (tree)
+    {
+        tree->stats.retrace_steps++;
+        tree->stats.height_changes += node->height != old_height;
+    }
+
     // Left-Left case
     if (bf > 1 && balance_factor(node->left) >= 0)
     {
-        return rotate_right(node);
+        AVLNode *result = tree_rotate_right(tree, node);
+        record_rotation(tree, ROTATION_LL, result);
+        return result;
     }
 
     // Left-Right case
     if (bf > 1 && balance_factor(node->left) < 0)
     {
-        g_last_rotation = ROTATION_LR;
-        node->left = rotate_left(node->left);
-        AVLNode *result = rotate_right(node);
-        g_rotation_node = result;
+        node->left = tree_rotate_left(tree, node->left);
+        AVLNode *result = tree_rotate_right(tree, node);
+        record_rotation(tree, ROTATION_LR, result);
         return result;
     }
 
     // Right-Right case
     if (bf < -1 && balance_factor(node->right) <= 0)
     {
-        return rotate_left(node);
+        AVLNode *result = tree_rotate_left(tree, node);
+        record_rotation(tree, ROTATION_RR, result);
+        return result;
     }
 
     // Right-Left case
     if (bf < -1 && balance_factor(node->right) > 0)
     {
-        g_last_rotation = ROTATION_RL;
-        node->right = rotate_right(node->right);
-        AVLNode *result = rotate_left(node);
-        g_rotation_node = result;
+        node->right = tree_rotate_right(tree, node->right);
+        AVLNode *result = tree_rotate_left(tree, node);
+        record_rotation(tree, ROTATION_RL, result);
         return result;
     }
 
     return node;
 }
 
-// Insert a node
-AVLNode *insert_node(AVLNode *root, int key)
+// Balance the node
+AVLNode *balance_node(AVLNode *node)
+{
+    return balance_in(NULL, node);
+}
+
+// Insert a node, tracking size and rotations in tree (may be NULL)
+static AVLNode *insert_in(AVLTree *tree, AVLNode *root, int key)
 {
     // Standard BST insertion
     if (root == NULL)
     {
-        return create_node(key);
+        AVLNode *node = tree_new_node(tree, key);
+        if (node && tree)
+            tree->size++;
+        return node;
     }
 
     if (key < root->key)
     {
-        root->left = insert_node(root->left, key);
+        root->left = insert_in(tree, root->left, key);
     }
     else if (key > root->key)
     {
-        root->right = insert_node(root->right, key);
+        root->right = insert_in(tree, root->right, key);
     }
     else
     {
@@ -153,7 +231,13 @@ AVLNode *insert_node(AVLNode *root, int key)
     }
 
     // Balance the node
-    return balance_node(root);
+    return balance_in(tree, root);
+}
+
+// Insert a node
+AVLNode *insert_node(AVLNode *root, int key)
+{
+    return insert_in(NULL, root, key);
 }
 
 // Find minimum value node
@@ -166,8 +250,8 @@ AVLNode *find_min(AVLNode *node)
     return node;
 }
 
-// Delete a node
-AVLNode *delete_node(AVLNode *root, int key)
+// Delete a node, tracking size and rotations in tree (may be NULL)
+static AVLNode *delete_in(AVLTree *tree, AVLNode *root, int key)
 {
     if (root == NULL)
         return NULL;
@@ -175,11 +259,11 @@ AVLNode *delete_node(AVLNode *root, int key)
     // Standard BST deletion
     if (key < root->key)
     {
-        root->left = delete_node(root->left, key);
+        root->left = delete_in(tree, root->left, key);
     }
     else if (key > root->key)
     {
-        root->right = delete_node(root->right, key);
+        root->right = delete_in(tree, root->right, key);
     }
     else
     {
@@ -187,6 +271,7 @@ AVLNode *delete_node(AVLNode *root, int key)
         if (root->left == NULL || root->right == NULL)
         {
             AVLNode *temp = root->left ? root->left : root->right;
+            account_removal(tree, root);
 
             if (temp == NULL)
             {
@@ -195,15 +280,24 @@ AVLNode *delete_node(AVLNode *root, int key)
             }
             else
             {
+                index_forget(tree, root);
                 *root = *temp;
+                index_note(tree, root);
             }
-            free(temp);
+            tree_free_node(tree, temp);
         }
         else
         {
+            // The successor's key (and state) moves up; the node that is
+            // physically removed takes this key's state for accounting
             AVLNode *temp = find_min(root->right);
+            unsigned int flags = root->flags;
+            index_forget(tree, root);
             root->key = temp->key;
-            root->right = delete_node(root->right, temp->key);
+            root->flags = temp->flags;
+            temp->flags = flags;
+            index_note(tree, root);
+            root->right = delete_in(tree, root->right, temp->key);
         }
     }
 
@@ -211,7 +305,13 @@ AVLNode *delete_node(AVLNode *root, int key)
         return NULL;
 
     // Balance the node
-    return balance_node(root);
+    return balance_in(tree, root);
+}
+
+// Delete a node
+AVLNode *delete_node(AVLNode *root, int key)
+{
+    return delete_in(NULL, root, key);
 }
 
 // Search for a node
@@ -232,6 +332,65 @@ AVLNode *search_node(AVLNode *root, int key)
     }
 }
 
+// Look up n independent keys, advancing SEARCH_BATCH_GROUP of them one
+// level at a time so their cache misses overlap. Returns visited nodes.
+static unsigned long batch_in(AVLNode *root, const int *keys, size_t n, AVLNode **results)
+{
+    AVLNode *cursor[SEARCH_BATCH_GROUP];
+    unsigned long visited = 0;
+
+    for (size_t base = 0; base < n; base += SEARCH_BATCH_GROUP)
+    {
+        size_t group = n - base < SEARCH_BATCH_GROUP ? n - base : SEARCH_BATCH_GROUP;
+        const int *k = keys + base;
+        AVLNode **out = results + base;
+        size_t active = 0;
+
+        for (size_t i = 0; i < group; i++)
+        {
+            cursor[i] = root;
+            out[i] = NULL;
+            if (root)
+                active++;
+        }
+
+        // One level per pass; each next child is prefetched before the
+        // other lookups in the group get their turn
+        while (active > 0)
+        {
+            for (size_t i = 0; i < group; i++)
+            {
+                AVLNode *node = cursor[i];
+                if (node == NULL)
+                    continue;
+
+                visited++;
+                if (node->key == k[i])
+                {
+                    out[i] = node;
+                    cursor[i] = NULL;
+                    active--;
+                    continue;
+                }
+
+                node = k[i] < node->key ? node->left : node->right;
+                if (node)
+                    PREFETCH_NODE(node);
+                else
+                    active--;
+                cursor[i] = node;
+            }
+        }
+    }
+    return visited;
+}
+
+// Batched lookup: results[i] is the node holding keys[i] or NULL
+void search_batch(AVLNode *root, const int *keys, size_t n, AVLNode **results)
+{
+    batch_in(root, keys, n, results);
+}
+
 // Free the entire tree
 void free_tree(AVLNode *root)
 {
@@ -249,4 +408,806 @@ int count_nodes(AVLNode *root)
     if (root == NULL)
         return 0;
     return 1 + count_nodes(root->left) + count_nodes(root->right);
-}
\ No newline at end of file
+}
+
+// Charge a physically removed node to the live or tombstone count
+void account_removal(AVLTree *tree, AVLNode *node)
+{
+    if (tree == NULL)
+        return;
+
+    if (node->flags & NODE_TOMBSTONE)
+        tree->tombstones--;
+    else
+        tree->size--;
+}
+
+// Initialise a caller-owned tree handle
+void init_tree(AVLTree *tree, BalanceEngine engine)
+{
+    tree->root = NULL;
+    tree->engine = engine;
+    tree->arena = NULL;
+    tree->size = 0;
+    tree->tombstones = 0;
+    tree->lazy_delete = 0;
+    tree->max_tombstone_ratio = 0.5;
+    tree->version = 0;
+    tree->index = NULL;
+    tree->cache = NULL;
+    reset_tree_stats(tree);
+    memset(&tree->memory, 0, sizeof(tree->memory));
+    tree->memory.handle_bytes = sizeof(AVLTree);
+}
+
+// Allocate an empty tree using the given engine
+AVLTree *create_tree(BalanceEngine engine)
+{
+    AVLTree *tree = (AVLTree *)malloc(sizeof(AVLTree));
+    if (tree == NULL)
+        return NULL;
+
+    init_tree(tree, engine);
+    return tree;
+}
+
+// Free a tree and all of its nodes
+void destroy_tree(AVLTree *tree)
+{
+    if (tree == NULL)
+        return;
+
+    tree_disable_index(tree);
+    tree_disable_cache(tree);
+    if (tree->arena && tree->arena->borrowers)
+    {
+        // The last tree drawing from a shared pool frees it
+        tree_release(tree, tree->root);
+        tree->arena->borrowers--;
+    }
+    else if (tree->arena && tree->arena->chunk_nodes)
+    {
+        // Pool chunks go back wholesale
+        AVLNode *chunk = tree->arena->chunks;
+        while (chunk != NULL)
+        {
+            AVLNode *next = chunk->left;
+            free(chunk);
+            chunk = next;
+        }
+        free(tree->arena);
+    }
+    else
+    {
+        tree_release(tree, tree->root);
+    }
+    free(tree);
+}
+
+// Bring a lazily deleted node back
+static int revive(AVLTree *tree, AVLNode *node)
+{
+    node->flags &= ~NODE_TOMBSTONE;
+#ifdef TREE_AGGREGATE
+    refresh_aggregates(tree, node->key);
+#endif
+    tree->tombstones--;
+    tree->size++;
+    tree->version++;
+    return 1;
+}
+
+// Engine insert, or revival of the key's tombstone
+static int insert_key(AVLTree *tree, int key)
+{
+    size_t before = tree->size;
+
+    if (tree->engine == ENGINE_WAVL)
+        tree->root = wavl_insert_node(tree, tree->root, key);
+    else
+        tree->root = insert_in(tree, tree->root, key);
+
+    if (tree->size != before)
+    {
+        tree->version++;
+        return 1;
+    }
+
+    // Re-inserting a lazily deleted key just revives its node
+    if (tree->tombstones > 0)
+    {
+        AVLNode *node = search_node(tree->root, key);
+        if (node && (node->flags & NODE_TOMBSTONE))
+            return revive(tree, node);
+    }
+    return 0;
+}
+
+// Rebuild once tombstones exceed the configured share of all nodes
+static void maybe_compact(AVLTree *tree)
+{
+    size_t total = tree->size + tree->tombstones;
+    if (total > 0 && (double)tree->tombstones > tree->max_tombstone_ratio * (double)total)
+        compact_tree(tree);
+}
+
+// Mark or unlink key; node is its node if already known
+static int delete_key(AVLTree *tree, int key, AVLNode *node)
+{
+    // Lazy mode only marks the node; structure is fixed by compaction. A
+    // cache bounds memory by live keys, so its trees unlink at once.
+    if (tree->lazy_delete && tree->cache == NULL)
+    {
+        if (node == NULL)
+            node = search_node(tree->root, key);
+        if (node == NULL || (node->flags & NODE_TOMBSTONE))
+            return 0;
+
+        node->flags |= NODE_TOMBSTONE;
+#ifdef TREE_AGGREGATE
+        refresh_aggregates(tree, key);
+#endif
+        tree->size--;
+        tree->tombstones++;
+        tree->version++;
+        maybe_compact(tree);
+        return 1;
+    }
+
+    size_t before_live = tree->size;
+    size_t before_total = tree->size + tree->tombstones;
+
+    if (tree->engine == ENGINE_WAVL)
+        tree->root = wavl_delete_node(tree, tree->root, key);
+    else
+        tree->root = delete_in(tree, tree->root, key);
+
+    if (tree->size + tree->tombstones != before_total)
+        tree->version++;
+    return tree->size != before_live;
+}
+
+// Stamp key in the cache, then evict what its limits no longer allow
+int cache_write(AVLTree *tree, int key, int inserted)
+{
+    inserted |= cache_admit(tree, key);
+
+    size_t expired = CACHE_SWEEP_STEP;
+    int victim;
+    while (cache_next_victim(tree, &victim, &expired))
+        delete_key(tree, victim, NULL);
+    return inserted;
+}
+
+// Insert key, returns 1 if the key was not live (or had expired) before
+int tree_insert(AVLTree *tree, int key)
+{
+    tree->stats.inserts++;
+
+    // Trees without an index or cache skip the hooks (and their calls)
+    if (tree->index == NULL && tree->cache == NULL)
+        return insert_key(tree, key);
+
+    // An index settles duplicates and revivals without a descent
+    int cached = cache_sync(tree);
+    AVLNode *node;
+    int in_step = index_lookup(tree, key, &node);
+    int inserted;
+    if (in_step && node != NULL)
+        inserted = (node->flags & NODE_TOMBSTONE) ? revive(tree, node) : 0;
+    else
+        inserted = insert_key(tree, key);
+
+    if (cached)
+        inserted = cache_write(tree, key, inserted);
+    index_catch_up(tree, in_step);
+    cache_catch_up(tree, cached);
+    return inserted;
+}
+
+// Delete key, returns 1 if a live (unexpired) key was removed
+int tree_delete(AVLTree *tree, int key)
+{
+    tree->stats.deletes++;
+
+    if (tree->index == NULL && tree->cache == NULL)
+        return delete_key(tree, key, NULL);
+
+    // An index settles absent keys without a descent
+    int cached = cache_sync(tree);
+    AVLNode *node;
+    int in_step = index_lookup(tree, key, &node);
+    if (in_step && node == NULL)
+        return 0;
+
+    int removed = delete_key(tree, key, in_step ? node : NULL);
+    if (cached && removed)
+        removed = cache_forget(tree, key);
+    index_catch_up(tree, in_step);
+    cache_catch_up(tree, cached);
+    return removed;
+}
+
+// Hide a tombstone or an expired key from a search hit
+static AVLNode *visible(AVLTree *tree, AVLNode *node, int key)
+{
+    if (node && (node->flags & NODE_TOMBSTONE))
+        return NULL;
+    // Expired keys stay linked until a write or sweep removes them; a
+    // stale cache still knows their expiry
+    if (node && tree->cache && !cache_touch(tree, key))
+        return NULL;
+    return node;
+}
+
+// Index lookup, kept out of tree_search so the plain descent needs no
+// addressable locals; falls back to the tree when the index is unusable
+static AVLNode *indexed_search(AVLTree *tree, int key, int *answered)
+{
+    AVLNode *node;
+    *answered = index_lookup(tree, key, &node);
+    return *answered ? visible(tree, node, key) : NULL;
+}
+
+// Search is engine independent; counts the nodes it visits
+AVLNode *tree_search(AVLTree *tree, int key)
+{
+    tree->stats.searches++;
+
+    if (tree->index != NULL)
+    {
+        int answered;
+        AVLNode *found = indexed_search(tree, key, &answered);
+        if (answered)
+            return found;
+    }
+
+    AVLNode *node = tree->root;
+    unsigned long visited = 0;
+    while (node != NULL && node->key != key)
+    {
+        visited++;
+        node = key < node->key ? node->left : node->right;
+    }
+    tree->stats.search_visits += visited + (node != NULL);
+    return visible(tree, node, key);
+}
+
+// Batched search with the same accounting as tree_search
+void tree_search_batch(AVLTree *tree, const int *keys, size_t n, AVLNode **results)
+{
+    tree->stats.searches += n;
+
+    // The index answers what it can; the rest descend in lockstep
+    size_t done = 0;
+    if (tree->index != NULL)
+    {
+        while (done < n && index_lookup(tree, keys[done], &results[done]))
+            done++;
+    }
+    if (done < n)
+        tree->stats.search_visits += batch_in(tree->root, keys + done, n - done, results + done);
+
+    if (tree->tombstones == 0 && tree->cache == NULL)
+        return;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (results[i] && (results[i]->flags & NODE_TOMBSTONE))
+            results[i] = NULL;
+        else if (results[i] && tree->cache && !cache_touch(tree, keys[i]))
+            results[i] = NULL;
+    }
+}
+
+// One retrace step for the tree's engine
+AVLNode *rebalance_after_insert(AVLTree *tree, AVLNode *node, int from_left)
+{
+    if (tree->engine == ENGINE_WAVL)
+        return wavl_insert_fix(tree, node, from_left);
+    return balance_in(tree, node);
+}
+
+// Copy the cumulative counters out of the tree
+void tree_stats(const AVLTree *tree, TreeStats *out)
+{
+    *out = tree->stats;
+    out->tombstones = tree->tombstones;
+}
+
+// Switch lazy deletion on or off; compaction runs once tombstones make up
+// more than max_tombstone_ratio of all nodes
+void set_lazy_delete(AVLTree *tree, int enabled, double max_tombstone_ratio)
+{
+    tree->lazy_delete = enabled;
+    if (max_tombstone_ratio > 0.0 && max_tombstone_ratio <= 1.0)
+        tree->max_tombstone_ratio = max_tombstone_ratio;
+}
+
+// Share of linked nodes that are tombstones
+double tombstone_ratio(const AVLTree *tree)
+{
+    size_t total = tree->size + tree->tombstones;
+    return total ? (double)tree->tombstones / (double)total : 0.0;
+}
+
+// Thread live nodes into an in-order list through ->right, freeing tombstones
+static AVLNode *flatten_live(AVLTree *tree, AVLNode *root)
+{
+    AVLNode *stack[TREE_MAX_DEPTH];
+    int depth = 0;
+    AVLNode head = {0};
+    AVLNode *tail = &head;
+    AVLNode *node = root;
+
+    while (node != NULL || depth > 0)
+    {
+        while (node != NULL)
+        {
+            stack[depth++] = node;
+            node = node->left;
+        }
+
+        node = stack[--depth];
+        AVLNode *next = node->right;
+        if (node->flags & NODE_TOMBSTONE)
+        {
+            tree_free_node(tree, node);
+        }
+        else
+        {
+            tail->right = node;
+            tail = node;
+        }
+        node = next;
+    }
+
+    tail->right = NULL;
+    return head.right;
+}
+
+// Build a balanced tree from the first n nodes of the list, advancing *list
+static AVLNode *build_from_list(AVLNode **list, size_t n)
+{
+    if (n == 0)
+        return NULL;
+
+    AVLNode *left = build_from_list(list, n / 2);
+    AVLNode *root = *list;
+    *list = root->right;
+
+    root->left = left;
+    root->right = build_from_list(list, n - n / 2 - 1);
+    update_height(root);
+    return root;
+}
+
+// Drop every tombstone and rebalance in one linear pass (nodes are reused)
+void compact_tree(AVLTree *tree)
+{
+    int in_step = index_in_step(tree);
+    int cached = cache_in_step(tree);
+    AVLNode *list = flatten_live(tree, tree->root);
+    tree->root = build_from_list(&list, tree->size);
+    tree->tombstones = 0;
+    tree->version++;
+    tree->stats.compactions++;
+    index_catch_up(tree, in_step);
+    cache_catch_up(tree, cached);
+}
+
+// Bytes malloc holds for a block of size bytes at ptr, its header included
+static size_t malloc_footprint(void *ptr, size_t size)
+{
+#ifdef __GLIBC__
+    (void)size;
+    return malloc_usable_size(ptr) + sizeof(size_t);
+#else
+    // Typical dlmalloc-style layout: one size_t header, 2 * size_t alignment
+    (void)ptr;
+    size_t align = 2 * sizeof(size_t);
+    size_t bytes = (size + sizeof(size_t) + align - 1) & ~(align - 1);
+    return bytes < 2 * align ? 2 * align : bytes;
+#endif
+}
+
+static void note_reserved(AVLTree *tree, size_t bytes)
+{
+    TreeMemory *m = &tree->memory;
+    m->reserved_bytes += bytes;
+    if (m->reserved_bytes > m->peak_reserved_bytes)
+        m->peak_reserved_bytes = m->reserved_bytes;
+}
+
+static void note_alloc(AVLTree *tree, size_t reserved)
+{
+    TreeMemory *m = &tree->memory;
+    m->live_nodes++;
+    m->requested_bytes += sizeof(AVLNode);
+    if (m->live_nodes > m->peak_nodes)
+        m->peak_nodes = m->live_nodes;
+    note_reserved(tree, reserved);
+}
+
+// Carve an arena out of bytes of caller-owned memory
+void arena_init(NodeArena *arena, void *memory, size_t bytes)
+{
+    arena->nodes = (AVLNode *)memory;
+    arena->capacity = bytes / sizeof(AVLNode);
+    arena->used = 0;
+    arena->free_list = NULL;
+    arena->chunk_nodes = 0;
+    arena->chunks = NULL;
+    arena->borrowers = 0;
+    arena->group = NULL;
+}
+
+// Draw the (empty) tree's nodes from a fixed arena; its whole capacity
+// counts as reserved
+void tree_attach_arena(AVLTree *tree, NodeArena *arena)
+{
+    tree->arena = arena;
+    note_reserved(tree, arena->capacity * sizeof(AVLNode));
+}
+
+// Give a malloc tree a growable pool; existing nodes stay malloc'd
+static int attach_pool(AVLTree *tree, size_t chunk_nodes)
+{
+    if (tree->arena != NULL || chunk_nodes == 0)
+        return 0;
+
+    NodeArena *arena = (NodeArena *)malloc(sizeof(NodeArena));
+    if (arena == NULL)
+        return 0;
+    arena_init(arena, NULL, 0);
+    arena->chunk_nodes = chunk_nodes;
+    tree->arena = arena;
+    tree->memory.handle_bytes += malloc_footprint(arena, sizeof(NodeArena));
+    return 1;
+}
+
+// Switch an empty malloc tree to a growable pool that mallocs chunk_nodes
+// nodes at a time. Returns 0 if the tree is not eligible or on failure.
+int tree_use_pool(AVLTree *tree, size_t chunk_nodes)
+{
+    return tree->root == NULL && attach_pool(tree, chunk_nodes);
+}
+
+// Add a chunk to a growable pool; its first node links the chunk list
+static int pool_grow(AVLTree *tree, NodeArena *arena)
+{
+    size_t bytes = (arena->chunk_nodes + 1) * sizeof(AVLNode);
+    AVLNode *chunk = (AVLNode *)malloc(bytes);
+    if (chunk == NULL)
+        return 0;
+
+    chunk->left = arena->chunks;
+    arena->chunks = chunk;
+    arena->nodes = chunk + 1;
+    arena->capacity = arena->chunk_nodes;
+    arena->used = 0;
+    note_reserved(tree, malloc_footprint(chunk, bytes));
+    return 1;
+}
+
+// Allocate a node from the tree's arena, or malloc when it has none.
+// tree may be NULL for the root-pointer API, which is not accounted.
+AVLNode *tree_new_node(AVLTree *tree, int key)
+{
+    if (tree == NULL)
+        return create_node(key);
+    if (tree->arena == NULL)
+    {
+        AVLNode *node = create_node(key);
+        if (node)
+        {
+            note_alloc(tree, malloc_footprint(node, sizeof(AVLNode)));
+            if (tree->index)
+                index_note(tree, node);
+        }
+        return node;
+    }
+
+    NodeArena *arena = tree->arena;
+    AVLNode *node = arena->free_list;
+    if (node != NULL)
+        arena->free_list = node->left;
+    else if (arena->used < arena->capacity || (arena->chunk_nodes && pool_grow(tree, arena)))
+        node = &arena->nodes[arena->used++];
+    else
+        return NULL;
+
+    node->key = key;
+    node->height = 1;
+    node->balance_factor = 0;
+    node->flags = 0;
+    node->left = NULL;
+    node->right = NULL;
+    update_aggregate(node);
+    note_alloc(tree, 0);
+    if (tree->index)
+        index_note(tree, node);
+    return node;
+}
+
+// Return a node to wherever tree_new_node got it
+void tree_free_node(AVLTree *tree, AVLNode *node)
+{
+    if (tree == NULL)
+    {
+        free(node);
+        return;
+    }
+
+    if (tree->index)
+        index_forget(tree, node);
+    tree->memory.live_nodes--;
+    tree->memory.requested_bytes -= sizeof(AVLNode);
+    if (tree->arena == NULL)
+    {
+        tree->memory.reserved_bytes -= malloc_footprint(node, sizeof(AVLNode));
+        free(node);
+        return;
+    }
+    node->left = tree->arena->free_list;
+    tree->arena->free_list = node;
+}
+
+// Make chunk (nodes + 1 malloc'd nodes, the first reserved for the chunk
+// link as in pool_grow) the tree's only pool chunk, its first used nodes
+// already in use. Earlier chunks are freed. A malloc tree becomes a pool
+// growing by chunk_nodes; its old nodes must then go through
+// tree_free_unpooled. Fixed arenas and pools shared with other trees or
+// in a group are refused. Returns 0 on failure.
+int tree_replace_chunks(AVLTree *tree, AVLNode *chunk, size_t nodes, size_t used, size_t chunk_nodes)
+{
+    NodeArena *arena = tree->arena;
+    if (arena == NULL)
+    {
+        if (!attach_pool(tree, chunk_nodes))
+            return 0;
+        arena = tree->arena;
+    }
+    else if (arena->chunk_nodes == 0 || arena->borrowers || arena->group)
+    {
+        return 0;
+    }
+    else
+    {
+        // A pool reserves nothing but its chunks
+        while (arena->chunks != NULL)
+        {
+            AVLNode *next = arena->chunks->left;
+            free(arena->chunks);
+            arena->chunks = next;
+        }
+        arena->free_list = NULL;
+        tree->memory.reserved_bytes = 0;
+    }
+
+    chunk->left = NULL;
+    arena->chunks = chunk;
+    arena->nodes = chunk + 1;
+    arena->capacity = nodes;
+    arena->used = used;
+    note_reserved(tree, malloc_footprint(chunk, (nodes + 1) * sizeof(AVLNode)));
+    return 1;
+}
+
+// Free a node malloc'd before tree_replace_chunks made the tree a pool
+void tree_free_unpooled(AVLTree *tree, AVLNode *node)
+{
+    tree->memory.reserved_bytes -= malloc_footprint(node, sizeof(AVLNode));
+    free(node);
+}
+
+// Move one node's accounting between trees sharing an allocator
+static void adopt_walk(AVLTree *to, AVLTree *from, AVLNode *node, size_t *live, size_t *dead)
+{
+    if (node == NULL)
+        return;
+
+    size_t reserved = from->arena ? 0 : malloc_footprint(node, sizeof(AVLNode));
+    from->memory.live_nodes--;
+    from->memory.requested_bytes -= sizeof(AVLNode);
+    from->memory.reserved_bytes -= reserved;
+    note_alloc(to, reserved);
+    if (node->flags & NODE_TOMBSTONE)
+        (*dead)++;
+    else
+        (*live)++;
+
+    adopt_walk(to, from, node->left, live, dead);
+    adopt_walk(to, from, node->right, live, dead);
+}
+
+// Hand the nodes under root, linked into another tree with the same
+// allocator, over to that tree's size and memory counts. Walks the nodes
+// unless root is all of from. Returns the live keys moved.
+size_t tree_adopt_nodes(AVLTree *to, AVLTree *from, AVLNode *root)
+{
+    size_t live = 0, dead = 0;
+    if (root != NULL && root == from->root)
+    {
+        TreeMemory *m = &from->memory;
+        size_t reserved = from->arena ? 0 : m->reserved_bytes;
+        live = from->size;
+        dead = from->tombstones;
+        to->memory.live_nodes += m->live_nodes;
+        to->memory.requested_bytes += m->requested_bytes;
+        if (to->memory.live_nodes > to->memory.peak_nodes)
+            to->memory.peak_nodes = to->memory.live_nodes;
+        note_reserved(to, reserved);
+        m->live_nodes = 0;
+        m->requested_bytes = 0;
+        m->reserved_bytes -= reserved;
+    }
+    else
+    {
+        adopt_walk(to, from, root, &live, &dead);
+    }
+
+    from->size -= live;
+    from->tombstones -= dead;
+    to->size += live;
+    to->tombstones += dead;
+    from->version++;
+    to->version++;
+    return live;
+}
+
+// Charge count nodes allocated outside tree_new_node (e.g. by parallel
+// builders), all from the same allocator as sample
+void account_node_allocs(AVLTree *tree, const AVLNode *sample, size_t count)
+{
+    size_t each = malloc_footprint((void *)sample, sizeof(AVLNode));
+    for (size_t i = 0; i < count; i++)
+        note_alloc(tree, each);
+}
+
+// Copy the memory counters out of the tree
+void tree_memory(const AVLTree *tree, TreeMemory *out)
+{
+    *out = tree->memory;
+}
+
+// Everything the tree holds divided by its live keys
+double tree_bytes_per_key(const AVLTree *tree)
+{
+    if (tree->size == 0)
+        return 0.0;
+    return (double)(tree->memory.reserved_bytes + tree->memory.handle_bytes) / (double)tree->size;
+}
+
+// Free every node under root
+void tree_release(AVLTree *tree, AVLNode *root)
+{
+    if (tree == NULL)
+    {
+        free_tree(root);
+        return;
+    }
+    if (root == NULL)
+        return;
+
+    tree_release(tree, root->left);
+    tree_release(tree, root->right);
+    tree_free_node(tree, root);
+}
+
+// Push the path toward the smallest node >= key
+static void iter_push(TreeIterator *it, AVLNode *node, int key, int bounded)
+{
+    while (node != NULL)
+    {
+        if (!bounded || key <= node->key)
+        {
+            it->stack[it->depth++] = node;
+            node = node->left;
+        }
+        else
+        {
+            node = node->right;
+        }
+    }
+}
+
+// Start at the smallest live key
+void tree_iter_first(TreeIterator *it, AVLTree *tree)
+{
+    it->depth = 0;
+    iter_push(it, tree->root, 0, 0);
+}
+
+// Start at the smallest live key >= key
+void tree_iter_seek(TreeIterator *it, AVLTree *tree, int key)
+{
+    it->depth = 0;
+    iter_push(it, tree->root, key, 1);
+}
+
+// Next live node in key order, NULL at the end
+AVLNode *tree_iter_next(TreeIterator *it)
+{
+    while (it->depth > 0)
+    {
+        AVLNode *node = it->stack[--it->depth];
+        iter_push(it, node->right, 0, 0);
+        if (!(node->flags & NODE_TOMBSTONE))
+            return node;
+    }
+    return NULL;
+}
+
+// Zero the cumulative counters
+void reset_tree_stats(AVLTree *tree)
+{
+    memset(&tree->stats, 0, sizeof(tree->stats));
+}
+
+// Display name of an engine
+const char *engine_name(BalanceEngine engine)
+{
+    return engine == ENGINE_WAVL ? "WAVL" : "AVL";
+}
+
+#ifdef TREE_AGGREGATE
+TreeAggregate aggregate_range(const AVLTree *tree, int lo, int hi)
+{
+    // Descend to the first node inside the range; both bounds then split
+    // off below it
+    AVLNode *node = tree->root;
+    while (node != NULL && (node->key < lo || node->key > hi))
+        node = node->key < lo ? node->right : node->left;
+    if (node == NULL)
+        return aggregate_empty();
+
+    // Left bound: each node >= lo brings itself and its right subtree,
+    // nearer to node than everything found after it
+    TreeAggregate left = aggregate_empty();
+    for (AVLNode *n = node->left; n != NULL;)
+    {
+        if (n->key < lo)
+        {
+            n = n->right;
+            continue;
+        }
+        TreeAggregate self = (n->flags & NODE_TOMBSTONE) ? aggregate_empty() : aggregate_of(n->key);
+        TreeAggregate rest = n->right ? n->right->agg : aggregate_empty();
+        left = aggregate_combine(aggregate_combine(self, rest), left);
+        n = n->left;
+    }
+
+    // Mirror for the right bound
+    TreeAggregate right = aggregate_empty();
+    for (AVLNode *n = node->right; n != NULL;)
+    {
+        if (n->key > hi)
+        {
+            n = n->left;
+            continue;
+        }
+        TreeAggregate self = (n->flags & NODE_TOMBSTONE) ? aggregate_empty() : aggregate_of(n->key);
+        TreeAggregate rest = n->left ? n->left->agg : aggregate_empty();
+        right = aggregate_combine(right, aggregate_combine(rest, self));
+        n = n->right;
+    }
+
+    TreeAggregate self = (node->flags & NODE_TOMBSTONE) ? aggregate_empty() : aggregate_of(node->key);
+    return aggregate_combine(aggregate_combine(left, self), right);
+}
+
+void refresh_aggregates(AVLTree *tree, int key)
+{
+    AVLNode *path[TREE_MAX_DEPTH];
+    int depth = 0;
+    for (AVLNode *node = tree->root; node != NULL && depth < TREE_MAX_DEPTH;)
+    {
+        path[depth++] = node;
+        if (node->key == key)
+            break;
+        node = key < node->key ? node->left : node->right;
+    }
+    while (depth > 0)
+        update_aggregate(path[--depth]);
+}
+#endif
@@ -0,0 +1,209 @@
+#include "finger.h"
+#include "key_cache.h"
+#include "key_index.h"
+
+#include <limits.h>
+
+// Restart the path at the root
+static void finger_reset(TreeFinger *finger)
+{
+    AVLTree *tree = finger->tree;
+    finger->version = tree->version;
+    finger->depth = 0;
+
+    if (tree->root == NULL)
+        return;
+
+    finger->path[0] = tree->root;
+    finger->lo[0] = (long long)INT_MIN - 1;
+    finger->hi[0] = (long long)INT_MAX + 1;
+    finger->depth = 1;
+}
+
+// Walk down from the finger's last node toward key. Leaves the finger on
+// the node holding key (returned) or on the would-be parent (returns NULL).
+static AVLNode *descend(TreeFinger *finger, int key, unsigned long *visited)
+{
+    int d = finger->depth - 1;
+    AVLNode *node = finger->path[d];
+    long long lo = finger->lo[d], hi = finger->hi[d];
+    AVLNode *found = NULL;
+    unsigned long steps = 0;
+
+    for (;;)
+    {
+        steps++;
+        int node_key = node->key;
+        if (key == node_key)
+        {
+            found = node;
+            break;
+        }
+
+        AVLNode *child;
+        if (key < node_key)
+        {
+            child = node->left;
+            hi = node_key;
+        }
+        else
+        {
+            child = node->right;
+            lo = node_key;
+        }
+        if (child == NULL)
+            break;
+
+        d++;
+        finger->path[d] = child;
+        finger->lo[d] = lo;
+        finger->hi[d] = hi;
+        node = child;
+    }
+
+    finger->depth = d + 1;
+    *visited += steps;
+    return found;
+}
+
+// Position the finger for key and return the node holding it (or NULL)
+static AVLNode *locate(TreeFinger *finger, int key, unsigned long *visited)
+{
+    AVLTree *tree = finger->tree;
+
+    if (finger->version != tree->version || finger->depth == 0)
+        finger_reset(finger);
+    if (finger->depth == 0)
+        return NULL;
+
+    // Climb to the lowest ancestor whose range covers key
+    while (finger->depth > 1 &&
+           (key <= finger->lo[finger->depth - 1] || key >= finger->hi[finger->depth - 1]))
+        finger->depth--;
+
+    return descend(finger, key, visited);
+}
+
+// Attach a finger to a tree
+void finger_init(TreeFinger *finger, AVLTree *tree)
+{
+    finger->tree = tree;
+    finger_reset(finger);
+}
+
+// Search starting from the finger; leaves the finger at the key's position
+AVLNode *finger_search(TreeFinger *finger, int key)
+{
+    unsigned long visited = 0;
+    AVLNode *found = locate(finger, key, &visited);
+    finger->tree->stats.searches++;
+    finger->tree->stats.search_visits += visited;
+
+    if (found && (found->flags & NODE_TOMBSTONE))
+        return NULL;
+    // Expired keys read as absent and live ones count as used, as in
+    // tree_search
+    if (found && finger->tree->cache && !cache_touch(finger->tree, key))
+        return NULL;
+    return found;
+}
+
+// Insert key next to the finger and retrace only as far as heights change
+static int insert_near(TreeFinger *finger, int key)
+{
+    AVLTree *tree = finger->tree;
+    tree->stats.inserts++;
+
+    if (tree->root == NULL)
+    {
+        tree->root = tree_new_node(tree, key);
+        if (tree->root == NULL)
+            return 0;
+        tree->size++;
+        tree->version++;
+        finger_reset(finger);
+        return 1;
+    }
+
+    unsigned long visited = 0;
+    AVLNode *existing = locate(finger, key, &visited);
+    if (existing != NULL)
+    {
+        // A lazily deleted key is revived in place
+        if (!(existing->flags & NODE_TOMBSTONE))
+            return 0;
+        existing->flags &= ~NODE_TOMBSTONE;
+#ifdef TREE_AGGREGATE
+        refresh_aggregates(tree, key);
+#endif
+        tree->tombstones--;
+        tree->size++;
+        tree->version++;
+        finger->version = tree->version; // the path is still valid
+        return 1;
+    }
+
+    AVLNode *leaf = tree_new_node(tree, key);
+    if (leaf == NULL)
+        return 0;
+
+    AVLNode *parent = finger->path[finger->depth - 1];
+    if (key < parent->key)
+        parent->left = leaf;
+    else
+        parent->right = leaf;
+
+    tree->size++;
+    tree->version++;
+
+    // Rebalance bottom-up; stop once a subtree keeps its height or rotates
+    int stop = 0;
+    for (int i = finger->depth - 1; i >= 0; i--)
+    {
+        AVLNode *node = finger->path[i];
+        int old_height = node->height;
+        AVLNode *sub = rebalance_after_insert(tree, node, key < node->key);
+
+        if (i == 0)
+            tree->root = sub;
+        else if (finger->path[i - 1]->left == node)
+            finger->path[i - 1]->left = sub;
+        else
+            finger->path[i - 1]->right = sub;
+
+        if (sub != node || sub->height == old_height)
+        {
+            finger->path[i] = sub;
+            stop = i;
+            break;
+        }
+    }
+
+    // Ancestors above the stop level keep their shape but not their
+    // aggregates
+    for (int i = stop - 1; i >= 0; i--)
+        update_aggregate(finger->path[i]);
+
+    // Rebuild the rest of the path below the stop level
+    if (stop == 0)
+        finger->path[0] = tree->root;
+    finger->depth = stop + 1;
+    finger->version = tree->version;
+    descend(finger, key, &visited);
+    return 1;
+}
+
+// Returns 1 if the key was added (or had expired)
+int finger_insert(TreeFinger *finger, int key)
+{
+    AVLTree *tree = finger->tree;
+    int cached = cache_sync(tree);
+    int in_step = index_in_step(tree);
+    int inserted = insert_near(finger, key);
+    // Evictions move the version, so the next access restarts the path
+    if (cached)
+        inserted = cache_write(tree, key, inserted);
+    index_catch_up(tree, in_step);
+    cache_catch_up(tree, cached);
+    return inserted;
+}
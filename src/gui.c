@@ -1,194 +1,57 @@
+#include "common.h"
 #include "avl_tree.h"
+#include "persistent_tree.h"
+#include "render_worker.h"
 
 // GUI globals
 extern HWND g_hInput, g_hInsert, g_hSearch, g_hDelete, g_hStatus;
-extern AVLNode *g_root;
+extern AVLTree *g_tree;
+extern PersistentTree *g_history;
 extern double g_last_execution_time;
-extern DWORD g_highlight_start;
 
-// Calculate horizontal position for nodes
-int calculate_x_position(AVLNode *root, AVLNode *target, int left, int right)
-{
-    if (root == NULL || target == NULL)
-        return (left + right) / 2;
-
-    if (root == target)
-    {
-        return (left + right) / 2;
-    }
-
-    int mid = (left + right) / 2;
-
-    if (target->key < root->key)
-    {
-        return calculate_x_position(root->left, target, left, mid - MIN_HORIZONTAL_GAP);
-    }
-    else
-    {
-        return calculate_x_position(root->right, target, mid + MIN_HORIZONTAL_GAP, right);
-    }
-}
-
-// Get node level (depth)
-int get_node_level(AVLNode *root, AVLNode *target, int level)
-{
-    if (root == NULL)
-        return -1;
-    if (root == target)
-        return level;
-
-    int left_level = get_node_level(root->left, target, level + 1);
-    if (left_level != -1)
-        return left_level;
-
-    return get_node_level(root->right, target, level + 1);
-}
-
-// Draw a single node with enhanced visuals
-void draw_node(HDC hdc, AVLNode *node, int x, int y, BOOL highlight, BOOL is_search)
-{
-    // Select colors based on state
-    HBRUSH hBrush;
-    if (is_search && highlight)
-    {
-        hBrush = CreateSolidBrush(COLOR_NODE_SEARCH);
-    }
-    else if (highlight)
-    {
-        hBrush = CreateSolidBrush(COLOR_NODE_HIGHLIGHT);
-    }
-    else
-    {
-        hBrush = CreateSolidBrush(COLOR_NODE);
-    }
-
-    HBRUSH hOldBrush = (HBRUSH)SelectObject(hdc, hBrush);
-
-    // Draw shadow for depth
-    HBRUSH hShadowBrush = CreateSolidBrush(RGB(0, 0, 0));
-    HPEN hShadowPen = CreatePen(PS_SOLID, 1, RGB(0, 0, 0));
-    HPEN hOldPen = (HPEN)SelectObject(hdc, hShadowPen);
-    SelectObject(hdc, hShadowBrush);
-
-    SetBkMode(hdc, TRANSPARENT);
-    BLENDFUNCTION blend = {AC_SRC_OVER, 0, 40, 0};
-    Ellipse(hdc, x - NODE_RADIUS + 3, y - NODE_RADIUS + 3,
-            x + NODE_RADIUS + 3, y + NODE_RADIUS + 3);
-
-    // Draw main circle with border
-    SelectObject(hdc, hBrush);
-    HPEN hPen = CreatePen(PS_SOLID, 2, RGB(30, 40, 50));
-    SelectObject(hdc, hPen);
-
-    Ellipse(hdc, x - NODE_RADIUS, y - NODE_RADIUS,
-            x + NODE_RADIUS, y + NODE_RADIUS);
-
-    // Draw key value
-    SetBkMode(hdc, TRANSPARENT);
-    SetTextColor(hdc, COLOR_TEXT);
-    HFONT hFont = CreateFont(18, 0, 0, 0, FW_BOLD, FALSE, FALSE, FALSE,
-                             DEFAULT_CHARSET, OUT_DEFAULT_PRECIS,
-                             CLIP_DEFAULT_PRECIS, ANTIALIASED_QUALITY,
-                             DEFAULT_PITCH | FF_DONTCARE, "Segoe UI");
-    HFONT hOldFont = (HFONT)SelectObject(hdc, hFont);
-
-    char text[32];
-    sprintf(text, "%d", node->key);
-
-    RECT textRect = {x - NODE_RADIUS, y - NODE_RADIUS + 3,
-                     x + NODE_RADIUS, y + 5};
-    DrawText(hdc, text, -1, &textRect, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
-
-    // Draw balance factor with better styling
-    sprintf(text, "BF:%d", node->balance_factor);
-    SetTextColor(hdc, RGB(240, 240, 255));
-    HFONT hSmallFont = CreateFont(13, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
-                                  DEFAULT_CHARSET, OUT_DEFAULT_PRECIS,
-                                  CLIP_DEFAULT_PRECIS, ANTIALIASED_QUALITY,
-                                  DEFAULT_PITCH | FF_DONTCARE, "Segoe UI");
-    SelectObject(hdc, hSmallFont);
-
-    RECT bfRect = {x - NODE_RADIUS, y + 3, x + NODE_RADIUS, y + NODE_RADIUS - 3};
-    DrawText(hdc, text, -1, &bfRect, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
+// COLORREF (0x00BBGGRR) to the render worker's 0xRRGGBB
+#define HEX_COLOR(c) (((uint32_t)GetRValue(c) << 16) | ((uint32_t)GetGValue(c) << 8) | GetBValue(c))
 
-    SelectObject(hdc, hOldFont);
-    DeleteObject(hFont);
-    DeleteObject(hSmallFont);
-    SelectObject(hdc, hOldBrush);
-    SelectObject(hdc, hOldPen);
-    DeleteObject(hBrush);
-    DeleteObject(hShadowBrush);
-    DeleteObject(hPen);
-    DeleteObject(hShadowPen);
-}
-
-// Draw edge between nodes with improved styling
-void draw_edge(HDC hdc, int x1, int y1, int x2, int y2)
+// Canvas and palette the render worker draws the tree area with
+RenderConfig tree_render_config(void)
 {
-    HPEN hPen = CreatePen(PS_SOLID, 3, COLOR_EDGE);
-    HPEN hOldPen = (HPEN)SelectObject(hdc, hPen);
-
-    MoveToEx(hdc, x1, y1, NULL);
-    LineTo(hdc, x2, y2);
-
-    SelectObject(hdc, hOldPen);
-    DeleteObject(hPen);
+    RenderConfig config = {0};
+    config.width = WINDOW_WIDTH;
+    config.height = WINDOW_HEIGHT - CONTROL_PANEL_HEIGHT - FOOTER_HEIGHT;
+    config.top = 60;
+    config.margin = 50;
+    config.node_radius = NODE_RADIUS;
+    config.level_height = LEVEL_HEIGHT;
+    config.min_gap = MIN_HORIZONTAL_GAP;
+    config.background = HEX_COLOR(COLOR_BACKGROUND);
+    config.node = HEX_COLOR(COLOR_NODE);
+    config.rotation = HEX_COLOR(COLOR_NODE_HIGHLIGHT);
+    config.search = HEX_COLOR(COLOR_NODE_SEARCH);
+    config.tombstone = HEX_COLOR(COLOR_EDGE);
+    config.edge = HEX_COLOR(COLOR_EDGE);
+    config.border = HEX_COLOR(RGB(30, 40, 50));
+    config.text = HEX_COLOR(COLOR_TEXT);
+    return config;
 }
 
-// Recursive tree drawing
-void draw_tree_recursive(HDC hdc, AVLNode *node, AVLNode *root,
-                         int left, int right, int level)
+// Blit the newest finished tree frame; layout and drawing happen on the
+// render worker
+void draw_tree_frame(HDC hdc, const RenderFrame *frame)
 {
-    if (node == NULL)
-        return;
-
-    int x = calculate_x_position(root, node, left, right);
-    int y = CONTROL_PANEL_HEIGHT + 60 + level * LEVEL_HEIGHT;
-
-    // Draw edges to children first
-    if (node->left)
-    {
-        int child_x = calculate_x_position(root, node->left, left, x - MIN_HORIZONTAL_GAP);
-        int child_y = y + LEVEL_HEIGHT;
-        draw_edge(hdc, x, y + NODE_RADIUS, child_x, child_y - NODE_RADIUS);
-    }
-
-    if (node->right)
-    {
-        int child_x = calculate_x_position(root, node->right, x + MIN_HORIZONTAL_GAP, right);
-        int child_y = y + LEVEL_HEIGHT;
-        draw_edge(hdc, x, y + NODE_RADIUS, child_x, child_y - NODE_RADIUS);
-    }
-
-    // Determine if node should be highlighted
-    BOOL highlight = FALSE;
-    BOOL is_search = FALSE;
-    DWORD current_time = GetTickCount();
-    if (current_time - g_highlight_start < HIGHLIGHT_DURATION)
+    if (frame != NULL)
     {
-        if (node == g_found_node)
-        {
-            highlight = TRUE;
-            is_search = TRUE;
-        }
-        else if (node == g_rotation_node)
-        {
-            highlight = TRUE;
-        }
+        BITMAPINFO bmi = {0};
+        bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+        bmi.bmiHeader.biWidth = frame->width;
+        bmi.bmiHeader.biHeight = -frame->height; // top-down rows
+        bmi.bmiHeader.biPlanes = 1;
+        bmi.bmiHeader.biBitCount = 32;
+        bmi.bmiHeader.biCompression = BI_RGB;
+        SetDIBitsToDevice(hdc, 0, CONTROL_PANEL_HEIGHT, frame->width, frame->height,
+                          0, 0, 0, frame->height, frame->pixels, &bmi, DIB_RGB_COLORS);
     }
 
-    // Draw the node
-    draw_node(hdc, node, x, y, highlight, is_search);
-
-    // Recursively draw children
-    draw_tree_recursive(hdc, node->left, root, left, x - MIN_HORIZONTAL_GAP, level + 1);
-    draw_tree_recursive(hdc, node->right, root, x + MIN_HORIZONTAL_GAP, right, level + 1);
-}
-
-// Main tree drawing function
-void draw_tree(HDC hdc, AVLNode *root)
-{
-    if (root == NULL)
+    if (frame == NULL || frame->nodes == 0)
     {
         SetBkMode(hdc, TRANSPARENT);
         SetTextColor(hdc, RGB(148, 163, 184));
@@ -205,10 +68,7 @@ void draw_tree(HDC hdc, AVLNode *root)
 
         SelectObject(hdc, hOldFont);
         DeleteObject(hFont);
-        return;
     }
-
-    draw_tree_recursive(hdc, root, root, 50, WINDOW_WIDTH - 50, 0);
 }
 
 // Draw control panel with modern styling
@@ -244,22 +104,24 @@ void draw_control_panel(HDC hdc)
 
     // Stats section with better formatting
     char statsText[512];
-    int node_count = count_nodes(g_root);
-    int tree_height = height(g_root);
+    int node_count = (int)g_tree->size;
+    int tree_height = height(g_tree->root);
+    const char *engine = engine_name(g_tree->engine);
 
     if (g_last_execution_time > 0)
     {
         const char *op_names[] = {"", "INSERT", "SEARCH", "DELETE"};
-        sprintf(statsText, "Operation: %s  |  Time: %.6f ms  |  Nodes: %d  |  Height: %d",
+        sprintf(statsText, "Operation: %s  |  Time: %.6f ms  |  Nodes: %d  |  Height: %d  |  Engine: %s",
                 op_names[g_last_operation],
                 g_last_execution_time * 1000,
                 node_count,
-                tree_height);
+                tree_height,
+                engine);
     }
     else
     {
-        sprintf(statsText, "Ready  |  Nodes: %d  |  Height: %d  |  Waiting for operation...",
-                node_count, tree_height);
+        sprintf(statsText, "Ready  |  Nodes: %d  |  Height: %d  |  Engine: %s  |  Waiting for operation...",
+                node_count, tree_height, engine);
     }
 
     if (g_last_rotation != ROTATION_NONE)
@@ -270,6 +132,14 @@ void draw_control_panel(HDC hdc)
         strcat(statsText, rotText);
     }
 
+    if (g_history)
+    {
+        char historyText[96];
+        sprintf(historyText, "  |  Undo: %u  Redo: %u",
+                (unsigned)ptree_undo_depth(g_history), (unsigned)ptree_redo_depth(g_history));
+        strcat(statsText, historyText);
+    }
+
     HFONT hStatsFont = CreateFont(15, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
                                   DEFAULT_CHARSET, OUT_DEFAULT_PRECIS,
                                   CLIP_DEFAULT_PRECIS, ANTIALIASED_QUALITY,
@@ -279,8 +149,36 @@ void draw_control_panel(HDC hdc)
 
     TextOut(hdc, 20, 52, statsText, strlen(statsText));
 
+    // Cumulative rebalancing counters for the tree
+    TreeStats stats;
+    TreeMemory mem;
+    tree_stats(g_tree, &stats);
+    tree_memory(g_tree, &mem);
+    unsigned long updates = stats.inserts + stats.deletes;
+
+    char counterText[320];
+    sprintf(counterText, "Rotations: %lu (LL %lu  RR %lu  LR %lu  RL %lu)  |  "
+                         "Avg retrace: %.2f  |  Avg search visits: %.2f  |  Height changes: %lu  |  "
+                         "Memory: %.1f KB (%.0f B/key)",
+            stats.rotations,
+            stats.rotations_by_type[ROTATION_LL], stats.rotations_by_type[ROTATION_RR],
+            stats.rotations_by_type[ROTATION_LR], stats.rotations_by_type[ROTATION_RL],
+            updates ? (double)stats.retrace_steps / updates : 0.0,
+            stats.searches ? (double)stats.search_visits / stats.searches : 0.0,
+            stats.height_changes,
+            (double)(mem.reserved_bytes + mem.handle_bytes) / 1024.0,
+            tree_bytes_per_key(g_tree));
+
+    HFONT hCounterFont = CreateFont(13, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
+                                    DEFAULT_CHARSET, OUT_DEFAULT_PRECIS,
+                                    CLIP_DEFAULT_PRECIS, ANTIALIASED_QUALITY,
+                                    DEFAULT_PITCH | FF_DONTCARE, "Segoe UI");
+    SelectObject(hdc, hCounterFont);
+    TextOut(hdc, 20, 70, counterText, strlen(counterText));
+
     SelectObject(hdc, hOldFont);
     DeleteObject(hStatsFont);
+    DeleteObject(hCounterFont);
 }
 
 // Draw footer with better visibility
@@ -0,0 +1,528 @@
+#include "key_cache.h"
+#include "key_index.h"
+
+#include <time.h>
+
+#define CACHE_MIN_CAPACITY 16
+
+static uint64_t wall_clock_ms(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+static uint64_t now_ms(const KeyCache *cache)
+{
+    return cache->config.clock ? cache->config.clock() : wall_clock_ms();
+}
+
+static int expired(const CacheEntry *entry, uint64_t now)
+{
+    return entry->expires != 0 && entry->expires <= now;
+}
+
+// Fibonacci hashing, as in key_index.c
+static size_t slot_of(const KeyCache *cache, int key)
+{
+    return (size_t)(((uint64_t)(uint32_t)key * 0x9E3779B97F4A7C15ull) >> cache->shift);
+}
+
+static unsigned log2_of(size_t capacity)
+{
+    unsigned bits = 0;
+    while (((size_t)1 << bits) < capacity)
+        bits++;
+    return bits;
+}
+
+// Entry holding key, or CACHE_NIL
+static uint32_t find(const KeyCache *cache, int key)
+{
+    size_t mask = cache->capacity - 1;
+    for (size_t i = slot_of(cache, key); cache->slots[i] != CACHE_NIL; i = (i + 1) & mask)
+    {
+        if (cache->entries[cache->slots[i]].key == key)
+            return cache->slots[i];
+    }
+    return CACHE_NIL;
+}
+
+static void place(KeyCache *cache, uint32_t e)
+{
+    size_t mask = cache->capacity - 1;
+    size_t i = slot_of(cache, cache->entries[e].key);
+    while (cache->slots[i] != CACHE_NIL)
+        i = (i + 1) & mask;
+    cache->slots[i] = e;
+}
+
+static int grow_table(AVLTree *tree, KeyCache *cache)
+{
+    size_t capacity = cache->capacity ? 2 * cache->capacity : CACHE_MIN_CAPACITY;
+    uint32_t *slots = (uint32_t *)malloc(capacity * sizeof(uint32_t));
+    if (slots == NULL)
+        return 0;
+    for (size_t i = 0; i < capacity; i++)
+        slots[i] = CACHE_NIL;
+
+    uint32_t *old = cache->slots;
+    size_t old_capacity = cache->capacity;
+    tree->memory.handle_bytes += (capacity - old_capacity) * sizeof(uint32_t);
+    cache->slots = slots;
+    cache->capacity = capacity;
+    cache->shift = 64 - log2_of(capacity);
+    for (size_t i = 0; i < old_capacity; i++)
+    {
+        if (old[i] != CACHE_NIL)
+            place(cache, old[i]);
+    }
+    free(old);
+    return 1;
+}
+
+// Backward-shift deletion of the slot naming entry e
+static void unplace(KeyCache *cache, uint32_t e)
+{
+    size_t mask = cache->capacity - 1;
+    size_t i = slot_of(cache, cache->entries[e].key);
+    while (cache->slots[i] != e)
+        i = (i + 1) & mask;
+
+    size_t hole = i;
+    for (size_t j = (i + 1) & mask; cache->slots[j] != CACHE_NIL; j = (j + 1) & mask)
+    {
+        size_t home = slot_of(cache, cache->entries[cache->slots[j]].key);
+        if (((j - home) & mask) >= ((j - hole) & mask))
+        {
+            cache->slots[hole] = cache->slots[j];
+            hole = j;
+        }
+    }
+    cache->slots[hole] = CACHE_NIL;
+}
+
+static void lru_unlink(KeyCache *cache, uint32_t e)
+{
+    CacheEntry *entry = &cache->entries[e];
+    if (entry->lru_prev != CACHE_NIL)
+        cache->entries[entry->lru_prev].lru_next = entry->lru_next;
+    else
+        cache->lru_head = entry->lru_next;
+    if (entry->lru_next != CACHE_NIL)
+        cache->entries[entry->lru_next].lru_prev = entry->lru_prev;
+    else
+        cache->lru_tail = entry->lru_prev;
+}
+
+static void lru_push_back(KeyCache *cache, uint32_t e)
+{
+    CacheEntry *entry = &cache->entries[e];
+    entry->lru_prev = cache->lru_tail;
+    entry->lru_next = CACHE_NIL;
+    if (cache->lru_tail != CACHE_NIL)
+        cache->entries[cache->lru_tail].lru_next = e;
+    else
+        cache->lru_head = e;
+    cache->lru_tail = e;
+}
+
+static void lru_push_front(KeyCache *cache, uint32_t e)
+{
+    CacheEntry *entry = &cache->entries[e];
+    entry->lru_prev = CACHE_NIL;
+    entry->lru_next = cache->lru_head;
+    if (cache->lru_head != CACHE_NIL)
+        cache->entries[cache->lru_head].lru_prev = e;
+    else
+        cache->lru_tail = e;
+    cache->lru_head = e;
+}
+
+static void exp_unlink(KeyCache *cache, uint32_t e)
+{
+    CacheEntry *entry = &cache->entries[e];
+    if (entry->exp_prev != CACHE_NIL)
+        cache->entries[entry->exp_prev].exp_next = entry->exp_next;
+    else
+        cache->exp_head = entry->exp_next;
+    if (entry->exp_next != CACHE_NIL)
+        cache->entries[entry->exp_next].exp_prev = entry->exp_prev;
+    else
+        cache->exp_tail = entry->exp_prev;
+}
+
+// A single TTL keeps the list sorted: later writes expire later
+static void exp_push_back(KeyCache *cache, uint32_t e, uint64_t now)
+{
+    CacheEntry *entry = &cache->entries[e];
+    entry->expires = cache->config.ttl_ms ? now + cache->config.ttl_ms : 0;
+    entry->exp_prev = cache->exp_tail;
+    entry->exp_next = CACHE_NIL;
+    if (cache->exp_tail != CACHE_NIL)
+        cache->entries[cache->exp_tail].exp_next = e;
+    else
+        cache->exp_head = e;
+    cache->exp_tail = e;
+}
+
+// New entry for key, linked nowhere yet; CACHE_NIL on allocation failure
+static uint32_t new_entry(AVLTree *tree, KeyCache *cache, int key)
+{
+    if (2 * (cache->count + 1) > cache->capacity && !grow_table(tree, cache))
+        return CACHE_NIL;
+
+    if (cache->free_entry == CACHE_NIL)
+    {
+        // Double, but reserve no more than the limit (plus the key about
+        // to be evicted) unless a reconcile needs the room
+        size_t capacity = cache->entry_capacity ? 2 * cache->entry_capacity : CACHE_MIN_CAPACITY;
+        size_t cap = cache->limit + 1 > cache->count + 1 ? cache->limit + 1 : cache->count + 1;
+        if (capacity > cap)
+            capacity = cap;
+        if (capacity <= cache->entry_capacity || capacity >= CACHE_NIL)
+            return CACHE_NIL;
+
+        CacheEntry *entries = (CacheEntry *)realloc(cache->entries, capacity * sizeof(CacheEntry));
+        if (entries == NULL)
+            return CACHE_NIL;
+        tree->memory.handle_bytes += (capacity - cache->entry_capacity) * sizeof(CacheEntry);
+        for (size_t i = capacity; i-- > cache->entry_capacity;)
+        {
+            entries[i].lru_next = cache->free_entry;
+            cache->free_entry = (uint32_t)i;
+        }
+        cache->entries = entries;
+        cache->entry_capacity = capacity;
+    }
+
+    uint32_t e = cache->free_entry;
+    cache->free_entry = cache->entries[e].lru_next;
+    cache->entries[e].key = key;
+    cache->entries[e].seen = cache->pass;
+    place(cache, e);
+    cache->count++;
+    return e;
+}
+
+static void drop_entry(KeyCache *cache, uint32_t e)
+{
+    lru_unlink(cache, e);
+    exp_unlink(cache, e);
+    unplace(cache, e);
+    cache->entries[e].lru_next = cache->free_entry;
+    cache->free_entry = e;
+    cache->count--;
+}
+
+// Entries for keys the tree gained behind the cache's back, as least
+// recent; entries for keys it lost are dropped
+static int reconcile(AVLTree *tree, KeyCache *cache)
+{
+    uint64_t now = now_ms(cache);
+    uint32_t pass = ++cache->pass;
+
+    TreeIterator it;
+    AVLNode *node;
+    tree_iter_first(&it, tree);
+    while ((node = tree_iter_next(&it)) != NULL)
+    {
+        uint32_t e = find(cache, node->key);
+        if (e == CACHE_NIL)
+        {
+            e = new_entry(tree, cache, node->key);
+            if (e == CACHE_NIL)
+                return 0;
+            lru_push_front(cache, e);
+            exp_push_back(cache, e, now);
+        }
+        cache->entries[e].seen = pass;
+    }
+
+    for (uint32_t e = cache->lru_head; e != CACHE_NIL;)
+    {
+        uint32_t next = cache->entries[e].lru_next;
+        if (cache->entries[e].seen != pass)
+            drop_entry(cache, e);
+        e = next;
+    }
+
+    cache->version = tree->version;
+    cache->broken = 0;
+    return 1;
+}
+
+// Move the entries into an array sized for the limit, keeping both orders;
+// each old entry's seen field holds its new index meanwhile
+static int shrink(AVLTree *tree, KeyCache *cache)
+{
+    size_t capacity = cache->limit + 1;
+    CacheEntry *entries = (CacheEntry *)malloc(capacity * sizeof(CacheEntry));
+    if (entries == NULL)
+        return 0;
+
+    CacheEntry *old = cache->entries;
+    uint32_t n = 0;
+    for (uint32_t e = cache->lru_head; e != CACHE_NIL; e = old[e].lru_next)
+    {
+        entries[n] = old[e];
+        entries[n].lru_prev = n ? n - 1 : CACHE_NIL;
+        entries[n].lru_next = n + 1 < cache->count ? n + 1 : CACHE_NIL;
+        old[e].seen = n++;
+    }
+    for (uint32_t e = 0; e < n; e++)
+    {
+        CacheEntry *entry = &entries[e];
+        entry->exp_prev = entry->exp_prev != CACHE_NIL ? old[entry->exp_prev].seen : CACHE_NIL;
+        entry->exp_next = entry->exp_next != CACHE_NIL ? old[entry->exp_next].seen : CACHE_NIL;
+        entry->seen = cache->pass;
+    }
+    cache->exp_head = cache->exp_head != CACHE_NIL ? old[cache->exp_head].seen : CACHE_NIL;
+    cache->exp_tail = cache->exp_tail != CACHE_NIL ? old[cache->exp_tail].seen : CACHE_NIL;
+    cache->lru_head = n ? 0 : CACHE_NIL;
+    cache->lru_tail = n ? n - 1 : CACHE_NIL;
+
+    cache->free_entry = CACHE_NIL;
+    for (size_t i = capacity; i-- > n;)
+    {
+        entries[i].lru_next = cache->free_entry;
+        cache->free_entry = (uint32_t)i;
+    }
+    tree->memory.handle_bytes -= (cache->entry_capacity - capacity) * sizeof(CacheEntry);
+    free(old);
+    cache->entries = entries;
+    cache->entry_capacity = capacity;
+
+    // Refill the table at its smallest size for the count
+    size_t slots = CACHE_MIN_CAPACITY;
+    while (slots < 2 * (cache->count + 1))
+        slots *= 2;
+    if (slots < cache->capacity)
+    {
+        uint32_t *table = (uint32_t *)malloc(slots * sizeof(uint32_t));
+        if (table == NULL)
+            return 1;
+        for (size_t i = 0; i < slots; i++)
+            table[i] = CACHE_NIL;
+        tree->memory.handle_bytes -= (cache->capacity - slots) * sizeof(uint32_t);
+        free(cache->slots);
+        cache->slots = table;
+        cache->capacity = slots;
+        cache->shift = 64 - log2_of(slots);
+        for (uint32_t e = 0; e < n; e++)
+            place(cache, e);
+    }
+    return 1;
+}
+
+// Keys a limit allows, capped below the entry index space
+static size_t key_limit(const AVLTree *tree, const CacheConfig *config)
+{
+    size_t limit = config->max_keys ? config->max_keys : SIZE_MAX;
+    if (config->max_bytes)
+    {
+        // The tables stay at most half full, so a key can own up to four slots
+        size_t per_key = sizeof(AVLNode) + sizeof(CacheEntry) + 4 * sizeof(uint32_t);
+        if (tree->index)
+            per_key += 4 * sizeof(KeySlot);
+        if (config->max_bytes / per_key < limit)
+            limit = config->max_bytes / per_key;
+    }
+    if (limit < 1)
+        limit = 1;
+    if (limit > CACHE_NIL - 2)
+        limit = CACHE_NIL - 2;
+    return limit;
+}
+
+// Shift every expiry by the change in TTL; a single TTL keeps the order
+static void retime(KeyCache *cache, uint64_t old_ttl, uint64_t now)
+{
+    uint64_t ttl = cache->config.ttl_ms;
+    for (uint32_t e = cache->exp_head; e != CACHE_NIL; e = cache->entries[e].exp_next)
+    {
+        CacheEntry *entry = &cache->entries[e];
+        if (ttl == 0)
+            entry->expires = 0;
+        else if (old_ttl == 0)
+            entry->expires = now + ttl;
+        else
+            entry->expires = entry->expires - old_ttl + ttl;
+    }
+}
+
+int tree_enable_cache(AVLTree *tree, const CacheConfig *config)
+{
+    KeyCache *cache = tree->cache;
+    if (cache == NULL)
+    {
+        cache = (KeyCache *)calloc(1, sizeof(KeyCache));
+        if (cache == NULL)
+            return 0;
+        cache->free_entry = CACHE_NIL;
+        cache->lru_head = cache->lru_tail = CACHE_NIL;
+        cache->exp_head = cache->exp_tail = CACHE_NIL;
+        cache->broken = 1; // stale until reconciled
+        tree->memory.handle_bytes += sizeof(KeyCache);
+        tree->cache = cache;
+        if (!grow_table(tree, cache))
+        {
+            tree_disable_cache(tree);
+            return 0;
+        }
+    }
+
+    uint64_t old_ttl = cache->config.ttl_ms;
+    cache->config = *config;
+    cache->limit = key_limit(tree, config);
+    if (old_ttl != config->ttl_ms)
+        retime(cache, old_ttl, now_ms(cache));
+
+    if (!cache_sync(tree))
+    {
+        tree_disable_cache(tree);
+        return 0;
+    }
+    if (tree->tombstones > 0)
+        compact_tree(tree);
+
+    // A lowered limit takes effect now, not at the next write
+    size_t budget = SIZE_MAX;
+    int key;
+    while (cache_next_victim(tree, &key, &budget))
+        tree_delete(tree, key);
+
+    // ...and gives back the bookkeeping a larger limit had reserved
+    if (cache->entry_capacity > 2 * (cache->limit + 1))
+        shrink(tree, cache);
+    return 1;
+}
+
+void tree_disable_cache(AVLTree *tree)
+{
+    KeyCache *cache = tree->cache;
+    if (cache == NULL)
+        return;
+
+    tree->memory.handle_bytes -= sizeof(KeyCache) + cache->entry_capacity * sizeof(CacheEntry) +
+                                 cache->capacity * sizeof(uint32_t);
+    free(cache->entries);
+    free(cache->slots);
+    free(cache);
+    tree->cache = NULL;
+}
+
+size_t tree_cache_sweep(AVLTree *tree, size_t budget)
+{
+    if (!cache_sync(tree))
+        return 0;
+
+    size_t removed = 0;
+    int key;
+    while (cache_next_victim(tree, &key, &budget))
+    {
+        tree_delete(tree, key);
+        removed++;
+    }
+    return removed;
+}
+
+int cache_sync(AVLTree *tree)
+{
+    if (tree->cache == NULL)
+        return 0;
+    return cache_in_step(tree) || reconcile(tree, tree->cache);
+}
+
+int cache_in_step(const AVLTree *tree)
+{
+    return tree->cache != NULL && tree->cache->version == tree->version && !tree->cache->broken;
+}
+
+void cache_catch_up(AVLTree *tree, int cached)
+{
+    if (cached && !tree->cache->broken)
+        tree->cache->version = tree->version;
+}
+
+int cache_admit(AVLTree *tree, int key)
+{
+    KeyCache *cache = tree->cache;
+    uint64_t now = now_ms(cache);
+    uint32_t e = find(cache, key);
+    int was_expired = 0;
+    if (e != CACHE_NIL)
+    {
+        was_expired = expired(&cache->entries[e], now);
+        lru_unlink(cache, e);
+        exp_unlink(cache, e);
+    }
+    else
+    {
+        e = new_entry(tree, cache, key);
+        if (e == CACHE_NIL)
+        {
+            // Untracked keys would escape eviction; reconcile on the next write
+            cache->broken = 1;
+            return 0;
+        }
+    }
+    lru_push_back(cache, e);
+    exp_push_back(cache, e, now);
+    return was_expired;
+}
+
+int cache_touch(AVLTree *tree, int key)
+{
+    KeyCache *cache = tree->cache;
+    uint32_t e = find(cache, key);
+    if (e == CACHE_NIL)
+        return 1;
+    if (cache->config.ttl_ms && expired(&cache->entries[e], now_ms(cache)))
+        return 0;
+
+    lru_unlink(cache, e);
+    lru_push_back(cache, e);
+    return 1;
+}
+
+int cache_forget(AVLTree *tree, int key)
+{
+    KeyCache *cache = tree->cache;
+    uint32_t e = find(cache, key);
+    if (e == CACHE_NIL)
+        return 1;
+
+    int live = !expired(&cache->entries[e], now_ms(cache));
+    drop_entry(cache, e);
+    return live;
+}
+
+int cache_next_victim(AVLTree *tree, int *key, size_t *expired_budget)
+{
+    KeyCache *cache = tree->cache;
+    uint32_t e = cache->exp_head;
+    int over = cache->count > cache->limit;
+    int due = e != CACHE_NIL && (over || *expired_budget > 0) && cache->config.ttl_ms &&
+              expired(&cache->entries[e], now_ms(cache));
+
+    if (due)
+    {
+        cache->expirations++;
+        if (*expired_budget > 0)
+            (*expired_budget)--;
+    }
+    else if (over)
+    {
+        e = cache->lru_head;
+        cache->evictions++;
+    }
+    else
+    {
+        return 0;
+    }
+
+    *key = cache->entries[e].key;
+    drop_entry(cache, e);
+    return 1;
+}
@@ -0,0 +1,423 @@
+#define _DEFAULT_SOURCE // madvise
+
+#include "key_import.h"
+#include "finger.h"
+#include "parallel_tree.h"
+#include "split_join.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// Eight digits per step needs unaligned little-endian loads
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define SWAR_DIGITS 1
+#else
+#define SWAR_DIGITS 0
+#endif
+
+#define SNIFF_BYTES 4096
+
+typedef struct
+{
+    AVLTree *tree;
+    ImportStats *stats;
+    int *keys; // chunk being filled
+    int *scratch;
+    size_t count;
+    size_t capacity;
+    int sorted; // chunk so far is in ascending order
+    int failed;
+    const uint8_t *base; // mapping, and how much of it has been released
+    size_t released;
+    size_t page;
+} Importer;
+
+static const uint64_t POW10[9] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000};
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+#if SWAR_DIGITS
+static unsigned lowest_byte(uint64_t mask)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctzll(mask) / 8;
+#else
+    unsigned n = 0;
+    while (!(mask & 0xFF))
+    {
+        mask >>= 8;
+        n++;
+    }
+    return n;
+#endif
+}
+
+// Number of leading ASCII digits in the 8 bytes of v (first byte lowest)
+static unsigned digit_run(uint64_t v)
+{
+    // Bytes outside '0'..'9' get their top bit set after either step;
+    // borrows and carries only ever move into later bytes
+    uint64_t x = v - 0x3030303030303030ull;
+    uint64_t bad = (x | (x + 0x7676767676767676ull)) & 0x8080808080808080ull;
+    return bad ? lowest_byte(bad) : 8;
+}
+
+// Value of the first len (1..8) digits of v
+static uint64_t digits_value(uint64_t v, unsigned len)
+{
+    // Shift the digits to the top so the missing ones read as leading zeros
+    uint64_t x = (v - 0x3030303030303030ull) << (8 * (8 - len));
+    x = x * 10 + (x >> 8);
+    x = (((x & 0x000000FF000000FFull) * (100 + (1000000ull << 32))) +
+         (((x >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32)))) >>
+        32;
+    return x;
+}
+#endif
+
+// LSD radix sort on the sign-flipped bits; passes where every key has the
+// same byte are skipped
+static void radix_sort(int *keys, int *scratch, size_t n)
+{
+    size_t counts[4][256] = {{0}};
+    for (size_t i = 0; i < n; i++)
+    {
+        uint32_t u = (uint32_t)keys[i] ^ 0x80000000u;
+        counts[0][u & 0xFF]++;
+        counts[1][(u >> 8) & 0xFF]++;
+        counts[2][(u >> 16) & 0xFF]++;
+        counts[3][u >> 24]++;
+    }
+
+    int *src = keys, *dst = scratch;
+    for (int pass = 0; pass < 4; pass++)
+    {
+        unsigned shift = 8u * (unsigned)pass;
+        uint32_t first = (((uint32_t)src[0] ^ 0x80000000u) >> shift) & 0xFF;
+        if (counts[pass][first] == n)
+            continue;
+
+        size_t offset = 0;
+        for (int b = 0; b < 256; b++)
+        {
+            size_t c = counts[pass][b];
+            counts[pass][b] = offset;
+            offset += c;
+        }
+        for (size_t i = 0; i < n; i++)
+        {
+            uint32_t b = (((uint32_t)src[i] ^ 0x80000000u) >> shift) & 0xFF;
+            dst[counts[pass][b]++] = src[i];
+        }
+        int *tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+    if (src != keys)
+        memcpy(keys, src, n * sizeof(int));
+}
+
+static AVLNode *rightmost(AVLNode *node)
+{
+    while (node && node->right)
+        node = node->right;
+    return node;
+}
+
+// Merge sorted keys that may interleave with the tree
+static void merge_keys(Importer *im, const int *keys, size_t n)
+{
+    TreeFinger finger;
+    finger_init(&finger, im->tree);
+    for (size_t i = 0; i < n; i++)
+    {
+        if (finger_insert(&finger, keys[i]))
+            im->stats->inserted++;
+        else if (finger_search(&finger, keys[i]) != NULL)
+            im->stats->duplicates++;
+        else
+        {
+            im->failed = 1;
+            return;
+        }
+    }
+}
+
+// Build sorted keys above the tree's maximum in O(n) and join them on
+static void append_keys(Importer *im, const int *keys, size_t n)
+{
+    AVLTree *tree = im->tree;
+    int ok;
+    if (tree->root == NULL)
+    {
+        ok = build_tree_from_sorted(tree, keys, n, NULL);
+    }
+    else
+    {
+        AVLTree *part = create_tree(tree->engine);
+        if (part == NULL)
+        {
+            im->failed = 1;
+            return;
+        }
+        part->arena = tree->arena; // borrowed fixed arena, if any
+        ok = build_tree_from_sorted(part, keys, n, NULL) && tree_join(tree, part);
+        destroy_tree(part);
+    }
+
+    if (!ok)
+    {
+        im->failed = 1;
+        return;
+    }
+    im->stats->inserted += n;
+}
+
+// Let the kernel drop file pages the parser has finished with
+static void release_pages(Importer *im, const uint8_t *upto)
+{
+    size_t end = (size_t)(upto - im->base) / im->page * im->page;
+    if (end > im->released)
+    {
+        madvise((void *)(im->base + im->released), end - im->released, MADV_DONTNEED);
+        im->released = end;
+    }
+}
+
+static void flush_chunk(Importer *im, const uint8_t *parsed)
+{
+    size_t n = im->count;
+    if (n == 0 || im->failed)
+        return;
+
+    int *keys = im->keys;
+    if (!im->sorted)
+        radix_sort(keys, im->scratch, n);
+
+    size_t m = 1;
+    for (size_t i = 1; i < n; i++)
+    {
+        keys[m] = keys[i];
+        m += keys[i] != keys[m - 1];
+    }
+    im->stats->duplicates += n - m;
+
+    // Keys up to the tree's maximum are merged, the rest appended. Pooled
+    // trees cannot take a separately built part, so they always merge.
+    AVLTree *tree = im->tree;
+    AVLNode *max = rightmost(tree->root);
+    size_t split = 0;
+    if (max != NULL)
+    {
+        if (tree->arena && tree->arena->chunk_nodes)
+            split = m;
+        else
+        {
+            size_t lo = 0, hi = m;
+            while (lo < hi)
+            {
+                size_t mid = lo + (hi - lo) / 2;
+                if (keys[mid] <= max->key)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            split = lo;
+        }
+    }
+
+    merge_keys(im, keys, split);
+    if (split < m && !im->failed)
+        append_keys(im, keys + split, m - split);
+    if (split == 0 && !im->failed)
+        im->stats->appended_chunks++;
+
+    im->stats->chunks++;
+    im->count = 0;
+    im->sorted = 1;
+    release_pages(im, parsed);
+}
+
+static inline void push_key(Importer *im, int key, const uint8_t *parsed)
+{
+    if (im->count == im->capacity)
+        flush_chunk(im, parsed);
+
+    if (im->count)
+        im->sorted &= im->keys[im->count - 1] <= key;
+    im->keys[im->count++] = key;
+    im->stats->keys++;
+}
+
+static void parse_text(Importer *im, const uint8_t *p, const uint8_t *end)
+{
+    while (p < end && !im->failed)
+    {
+        // Anything but a digit or a sign separates keys
+        while (p < end && (unsigned)(*p - '0') > 9 && *p != '-')
+            p++;
+        if (p == end)
+            break;
+
+        int negative = *p == '-';
+        p += negative;
+
+        uint64_t value = 0;
+        size_t digits = 0;
+#if SWAR_DIGITS
+        while (end - p >= 8)
+        {
+            uint64_t v;
+            memcpy(&v, p, sizeof(v));
+            unsigned len = digit_run(v);
+            if (len)
+                value = value * POW10[len] + digits_value(v, len);
+            p += len;
+            digits += len;
+            if (len < 8)
+                break;
+        }
+        if (end - p < 8)
+#endif
+        {
+            while (p < end && (unsigned)(*p - '0') <= 9)
+            {
+                value = value * 10 + (uint64_t)(*p - '0');
+                p++;
+                digits++;
+            }
+        }
+
+        if (digits == 0)
+            continue;
+        if (digits > 10 || value > (uint64_t)INT_MAX + (uint64_t)negative)
+        {
+            im->stats->malformed++;
+            continue;
+        }
+        push_key(im, negative ? (int)(-(int64_t)value) : (int)value, p);
+    }
+}
+
+static void parse_binary(Importer *im, const uint8_t *p, const uint8_t *end)
+{
+    size_t n = (size_t)(end - p) / 4;
+    im->stats->malformed += (size_t)(end - p) % 4 != 0;
+
+    for (size_t i = 0; i < n && !im->failed; i++, p += 4)
+    {
+        uint32_t u = (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+        push_key(im, (int)(int32_t)u, p);
+    }
+}
+
+// Text files never hold NUL, high or control bytes other than whitespace
+static ImportFormat sniff_format(const uint8_t *p, size_t bytes)
+{
+    size_t n = bytes < SNIFF_BYTES ? bytes : SNIFF_BYTES;
+    for (size_t i = 0; i < n; i++)
+    {
+        uint8_t c = p[i];
+        if (c >= 0x80 || (c < 0x20 && c != '\n' && c != '\r' && c != '\t'))
+            return IMPORT_BINARY;
+    }
+    return IMPORT_TEXT;
+}
+
+const char *import_format_name(ImportFormat format)
+{
+    switch (format)
+    {
+    case IMPORT_TEXT:
+        return "text";
+    case IMPORT_BINARY:
+        return "binary";
+    default:
+        return "auto";
+    }
+}
+
+int tree_import_file(AVLTree *tree, const char *path, const ImportOptions *options, ImportStats *stats)
+{
+    ImportStats local;
+    if (stats == NULL)
+        stats = &local;
+    memset(stats, 0, sizeof(*stats));
+    double start = now_seconds();
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return 0;
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return 0;
+    }
+
+    stats->bytes = (size_t)st.st_size;
+    stats->format = options ? options->format : IMPORT_AUTO;
+    if (stats->bytes == 0)
+    {
+        close(fd);
+        return 1;
+    }
+
+    const uint8_t *data = (const uint8_t *)mmap(NULL, stats->bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return 0;
+    madvise((void *)data, stats->bytes, MADV_SEQUENTIAL);
+
+    Importer im = {0};
+    im.tree = tree;
+    im.stats = stats;
+    im.capacity = options && options->chunk_keys ? options->chunk_keys : IMPORT_DEFAULT_CHUNK;
+    im.keys = (int *)malloc(im.capacity * sizeof(int));
+    im.scratch = (int *)malloc(im.capacity * sizeof(int));
+    im.sorted = 1;
+    im.base = data;
+    im.page = (size_t)sysconf(_SC_PAGESIZE);
+    if (im.keys == NULL || im.scratch == NULL)
+    {
+        free(im.keys);
+        free(im.scratch);
+        munmap((void *)data, stats->bytes);
+        errno = ENOMEM;
+        return 0;
+    }
+
+    if (stats->format == IMPORT_AUTO)
+        stats->format = sniff_format(data, stats->bytes);
+    if (stats->format == IMPORT_BINARY)
+        parse_binary(&im, data, data + stats->bytes);
+    else
+        parse_text(&im, data, data + stats->bytes);
+    flush_chunk(&im, data + stats->bytes);
+
+    free(im.keys);
+    free(im.scratch);
+    munmap((void *)data, stats->bytes);
+
+    stats->seconds = now_seconds() - start;
+    if (stats->seconds > 0)
+    {
+        stats->mb_per_sec = (double)stats->bytes / 1e6 / stats->seconds;
+        stats->keys_per_sec = (double)stats->keys / stats->seconds;
+    }
+    if (im.failed)
+        errno = ENOMEM;
+    return !im.failed;
+}
@@ -0,0 +1,218 @@
+#include "key_index.h"
+
+#include <stdint.h>
+
+#define INDEX_MIN_CAPACITY 16
+
+// Fibonacci hashing: the top bits of key * 2^64 / phi
+static size_t slot_of(const KeyIndex *index, int key)
+{
+    return (size_t)(((uint64_t)(uint32_t)key * 0x9E3779B97F4A7C15ull) >> index->shift);
+}
+
+static unsigned log2_of(size_t capacity)
+{
+    unsigned bits = 0;
+    while (((size_t)1 << bits) < capacity)
+        bits++;
+    return bits;
+}
+
+// Add an entry to a table known to have room and not to hold key. Entries
+// moved by a resize may name freed nodes while the index is stale, so only
+// slot keys are read here.
+static void place(KeyIndex *index, int key, AVLNode *node)
+{
+    size_t mask = index->capacity - 1;
+    size_t i = slot_of(index, key);
+    while (index->slots[i].node != NULL)
+        i = (i + 1) & mask;
+    index->slots[i].key = key;
+    index->slots[i].node = node;
+    index->count++;
+}
+
+// Replace the table with an empty one of capacity slots
+static int reset_table(AVLTree *tree, KeyIndex *index, size_t capacity)
+{
+    KeySlot *slots = (KeySlot *)calloc(capacity, sizeof(KeySlot));
+    if (slots == NULL)
+        return 0;
+
+    tree->memory.handle_bytes -= index->capacity * sizeof(KeySlot);
+    tree->memory.handle_bytes += capacity * sizeof(KeySlot);
+    free(index->slots);
+    index->slots = slots;
+    index->capacity = capacity;
+    index->shift = 64 - log2_of(capacity);
+    index->count = 0;
+    return 1;
+}
+
+static int grow(AVLTree *tree, KeyIndex *index)
+{
+    KeySlot *old = index->slots;
+    size_t old_capacity = index->capacity;
+    KeySlot *slots = (KeySlot *)calloc(2 * old_capacity, sizeof(KeySlot));
+    if (slots == NULL)
+        return 0;
+
+    tree->memory.handle_bytes += old_capacity * sizeof(KeySlot);
+    index->slots = slots;
+    index->capacity = 2 * old_capacity;
+    index->shift--;
+    index->count = 0;
+    for (size_t i = 0; i < old_capacity; i++)
+    {
+        if (old[i].node != NULL)
+            place(index, old[i].key, old[i].node);
+    }
+    free(old);
+    return 1;
+}
+
+// Refill the table from the tree, tombstones included
+static int rebuild(AVLTree *tree, KeyIndex *index)
+{
+    size_t nodes = tree->size + tree->tombstones;
+    size_t capacity = INDEX_MIN_CAPACITY;
+    while (capacity < 2 * nodes)
+        capacity *= 2;
+    if (!reset_table(tree, index, capacity))
+        return 0;
+
+    AVLNode *stack[TREE_MAX_DEPTH];
+    int depth = 0;
+    if (tree->root)
+        stack[depth++] = tree->root;
+    while (depth > 0)
+    {
+        AVLNode *node = stack[--depth];
+        place(index, node->key, node);
+        if (node->right)
+            stack[depth++] = node->right;
+        if (node->left)
+            stack[depth++] = node->left;
+    }
+
+    index->version = tree->version;
+    index->broken = 0;
+    return 1;
+}
+
+int tree_enable_index(AVLTree *tree)
+{
+    if (tree->index != NULL)
+        return 1;
+
+    KeyIndex *index = (KeyIndex *)calloc(1, sizeof(KeyIndex));
+    if (index == NULL)
+        return 0;
+    tree->memory.handle_bytes += sizeof(KeyIndex);
+    tree->index = index;
+    if (!rebuild(tree, index))
+    {
+        tree_disable_index(tree);
+        return 0;
+    }
+    return 1;
+}
+
+void tree_disable_index(AVLTree *tree)
+{
+    KeyIndex *index = tree->index;
+    if (index == NULL)
+        return;
+
+    tree->memory.handle_bytes -= sizeof(KeyIndex) + index->capacity * sizeof(KeySlot);
+    free(index->slots);
+    free(index);
+    tree->index = NULL;
+}
+
+void index_note(AVLTree *tree, AVLNode *node)
+{
+    if (tree == NULL || tree->index == NULL)
+        return;
+
+    KeyIndex *index = tree->index;
+    size_t mask = index->capacity - 1;
+    for (size_t i = slot_of(index, node->key); index->slots[i].node != NULL; i = (i + 1) & mask)
+    {
+        if (index->slots[i].key == node->key)
+        {
+            index->slots[i].node = node;
+            return;
+        }
+    }
+
+    if (2 * (index->count + 1) > index->capacity && !grow(tree, index))
+    {
+        index->broken = 1;
+        return;
+    }
+    place(index, node->key, node);
+}
+
+void index_forget(AVLTree *tree, AVLNode *node)
+{
+    if (tree == NULL || tree->index == NULL)
+        return;
+
+    KeyIndex *index = tree->index;
+    size_t mask = index->capacity - 1;
+    size_t i = slot_of(index, node->key);
+    while (index->slots[i].node != node)
+    {
+        if (index->slots[i].node == NULL)
+            return; // the key has moved to another node
+        i = (i + 1) & mask;
+    }
+
+    // Backward shift: pull later entries of the run into the hole unless
+    // that would move them before their home slot
+    size_t hole = i;
+    for (size_t j = (i + 1) & mask; index->slots[j].node != NULL; j = (j + 1) & mask)
+    {
+        size_t home = slot_of(index, index->slots[j].key);
+        if (((j - home) & mask) >= ((j - hole) & mask))
+        {
+            index->slots[hole] = index->slots[j];
+            hole = j;
+        }
+    }
+    index->slots[hole].node = NULL;
+    index->count--;
+}
+
+int index_lookup(AVLTree *tree, int key, AVLNode **node)
+{
+    KeyIndex *index = tree->index;
+    if (index == NULL)
+        return 0;
+    if ((index->version != tree->version || index->broken) && !rebuild(tree, index))
+        return 0;
+
+    size_t mask = index->capacity - 1;
+    for (size_t i = slot_of(index, key); index->slots[i].node != NULL; i = (i + 1) & mask)
+    {
+        if (index->slots[i].key == key)
+        {
+            *node = index->slots[i].node;
+            return 1;
+        }
+    }
+    *node = NULL;
+    return 1;
+}
+
+int index_in_step(const AVLTree *tree)
+{
+    return tree->index != NULL && tree->index->version == tree->version && !tree->index->broken;
+}
+
+void index_catch_up(AVLTree *tree, int in_step)
+{
+    if (in_step && !tree->index->broken)
+        tree->index->version = tree->version;
+}
@@ -1,21 +1,34 @@
+#include "common.h"
 #include "avl_tree.h"
+#include "persistent_tree.h"
+#include "render_worker.h"
 // author: @anvaymayekar
 // Forward declarations
-void draw_tree(HDC hdc, AVLNode *root);
+RenderConfig tree_render_config(void);
+void draw_tree_frame(HDC hdc, const RenderFrame *frame);
 void draw_control_panel(HDC hdc);
 void draw_footer(HDC hdc);
 
 // Global variables
-HWND g_hInput, g_hInsert, g_hSearch, g_hDelete, g_hStatus;
-AVLNode *g_root = NULL;
+HWND g_hInput, g_hInsert, g_hSearch, g_hDelete, g_hUndo, g_hRedo, g_hStatus;
+AVLTree *g_tree = NULL;
+PersistentTree *g_history = NULL; // undo/redo versions
+RenderWorker *g_renderer = NULL;
 double g_last_execution_time = 0.0;
-DWORD g_highlight_start = 0;
 
 // Control IDs
 #define ID_INPUT 101
 #define ID_INSERT 102
 #define ID_SEARCH 103
 #define ID_DELETE 104
+#define ID_UNDO 105
+#define ID_REDO 106
+
+// Undo steps the visualizer keeps
+#define HISTORY_DEPTH 256
+
+// Posted by the render worker when a new frame is ready
+#define WM_FRAME_READY (WM_APP + 1)
 
 // Measure execution time with high precision
 double measure_time(clock_t start, clock_t end)
@@ -23,6 +36,22 @@ double measure_time(clock_t start, clock_t end)
     return ((double)(end - start)) / CLOCKS_PER_SEC;
 }
 
+// Runs on the render worker thread
+void on_frame_ready(void *ctx)
+{
+    PostMessage((HWND)ctx, WM_FRAME_READY, 0, 0);
+}
+
+// Hand the current tree to the render worker, with or without highlights
+void submit_frame(BOOL highlight)
+{
+    if (g_renderer == NULL)
+        return;
+    render_submit(g_renderer, g_tree,
+                  highlight ? g_rotation_node : NULL,
+                  highlight ? g_found_node : NULL);
+}
+
 // Get input value from edit control
 BOOL get_input_value(HWND hWnd, int *value)
 {
@@ -56,7 +85,7 @@ void handle_insert(HWND hWnd)
         return;
 
     // Check for duplicate
-    if (search_node(g_root, value) != NULL)
+    if (tree_search(g_tree, value) != NULL)
     {
         MessageBox(hWnd, "This value already exists in the tree!\nAVL trees don't allow duplicates.",
                    "Duplicate Value", MB_OK | MB_ICONWARNING);
@@ -68,11 +97,11 @@ void handle_insert(HWND hWnd)
     g_last_operation = OP_INSERT;
 
     clock_t start = clock();
-    g_root = insert_node(g_root, value);
+    ptree_insert(g_history, value);
     clock_t end = clock();
 
     g_last_execution_time = measure_time(start, end);
-    g_highlight_start = GetTickCount();
+    submit_frame(TRUE);
 
     SetWindowText(g_hInput, "");
     SetFocus(g_hInput);
@@ -95,7 +124,7 @@ void handle_search(HWND hWnd)
     g_last_operation = OP_SEARCH;
 
     clock_t start = clock();
-    AVLNode *found = search_node(g_root, value);
+    AVLNode *found = tree_search(g_tree, value);
     clock_t end = clock();
 
     g_last_execution_time = measure_time(start, end);
@@ -103,7 +132,7 @@ void handle_search(HWND hWnd)
     if (found)
     {
         g_found_node = found;
-        g_highlight_start = GetTickCount();
+        submit_frame(TRUE);
 
         char msg[256];
         sprintf(msg, "Node %d found successfully!\n\n"
@@ -140,7 +169,7 @@ void handle_delete(HWND hWnd)
         return;
 
     // Check if node exists before deletion
-    if (search_node(g_root, value) == NULL)
+    if (tree_search(g_tree, value) == NULL)
     {
         MessageBox(hWnd, "Node not found in the tree.\nCannot delete a non-existent value.",
                    "Delete Failed", MB_OK | MB_ICONWARNING);
@@ -153,11 +182,11 @@ void handle_delete(HWND hWnd)
     g_last_operation = OP_DELETE;
 
     clock_t start = clock();
-    g_root = delete_node(g_root, value);
+    ptree_delete(g_history, value);
     clock_t end = clock();
 
     g_last_execution_time = measure_time(start, end);
-    g_highlight_start = GetTickCount();
+    submit_frame(TRUE);
 
     char msg[256];
     sprintf(msg, "Node %d deleted successfully!\n\n"
@@ -173,6 +202,24 @@ void handle_delete(HWND hWnd)
     SetTimer(hWnd, 1, HIGHLIGHT_DURATION, NULL);
 }
 
+// Step back or forward through the version history
+void handle_history(HWND hWnd, BOOL redo)
+{
+    // Versions are kept whole, so switching is just a root swap
+    if (!(redo ? ptree_redo(g_history) : ptree_undo(g_history)))
+    {
+        MessageBeep(MB_ICONWARNING);
+        return;
+    }
+
+    g_last_rotation = ROTATION_NONE;
+    g_rotation_node = NULL;
+    g_found_node = NULL;
+    submit_frame(FALSE);
+    SetFocus(g_hInput);
+    InvalidateRect(hWnd, NULL, TRUE);
+}
+
 // Custom button drawing for modern look
 void draw_custom_button(HDC hdc, RECT rect, const char *text, BOOL is_hovered)
 {
@@ -245,6 +292,18 @@ LRESULT CALLBACK WindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             460, 90, 110, 35,
             hWnd, (HMENU)ID_DELETE, NULL, NULL);
 
+        g_hUndo = CreateWindow(
+            "BUTTON", "Undo",
+            WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON | BS_OWNERDRAW,
+            600, 90, 90, 35,
+            hWnd, (HMENU)ID_UNDO, NULL, NULL);
+
+        g_hRedo = CreateWindow(
+            "BUTTON", "Redo",
+            WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON | BS_OWNERDRAW,
+            700, 90, 90, 35,
+            hWnd, (HMENU)ID_REDO, NULL, NULL);
+
         // Set font for input with black text
         HFONT hFont = CreateFont(18, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
                                  DEFAULT_CHARSET, OUT_DEFAULT_PRECIS,
@@ -274,6 +333,10 @@ LRESULT CALLBACK WindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                 btnText = "Search";
             else if (pDIS->CtlID == ID_DELETE)
                 btnText = "Delete";
+            else if (pDIS->CtlID == ID_UNDO)
+                btnText = "Undo";
+            else if (pDIS->CtlID == ID_REDO)
+                btnText = "Redo";
 
             draw_custom_button(pDIS->hDC, pDIS->rcItem, btnText, is_hovered);
         }
@@ -302,6 +365,12 @@ LRESULT CALLBACK WindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
         case ID_DELETE:
             handle_delete(hWnd);
             break;
+        case ID_UNDO:
+            handle_history(hWnd, FALSE);
+            break;
+        case ID_REDO:
+            handle_history(hWnd, TRUE);
+            break;
         case ID_INPUT:
             // Handle Enter key in input field
             if (HIWORD(wParam) == EN_CHANGE)
@@ -316,11 +385,19 @@ LRESULT CALLBACK WindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
     case WM_TIMER:
     {
         // Unhighlight after duration
+        submit_frame(FALSE);
         InvalidateRect(hWnd, NULL, TRUE);
         KillTimer(hWnd, 1);
         break;
     }
 
+    case WM_FRAME_READY:
+    {
+        // A newer tree frame finished; the panel and footer are cheap to redraw
+        InvalidateRect(hWnd, NULL, FALSE);
+        break;
+    }
+
     case WM_PAINT:
     {
         PAINTSTRUCT ps;
@@ -342,7 +419,7 @@ LRESULT CALLBACK WindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 
         // Draw components
         draw_control_panel(hdcMem);
-        draw_tree(hdcMem, g_root);
+        draw_tree_frame(hdcMem, g_renderer ? render_acquire(g_renderer) : NULL);
         draw_footer(hdcMem);
 
         // Copy to screen
@@ -372,12 +449,21 @@ LRESULT CALLBACK WindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
         {
             handle_delete(hWnd);
         }
+        else if (GetKeyState(VK_CONTROL) < 0 && (wParam == 'Z' || wParam == 'Y'))
+        {
+            handle_history(hWnd, wParam == 'Y');
+        }
         break;
     }
 
     case WM_DESTROY:
     {
-        free_tree(g_root);
+        destroy_render_worker(g_renderer);
+        g_renderer = NULL;
+        if (g_history)
+            ptree_destroy(g_history);
+        else
+            destroy_tree(g_tree);
         PostQuitMessage(0);
         break;
     }
@@ -406,6 +492,17 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
 
     RegisterClass(&wc);
 
+    // Pick the balancing engine ("--wavl" selects the rank-balanced engine).
+    // Either runs on persistent versions so every step can be undone.
+    BalanceEngine engine = strstr(lpCmdLine, "--wavl") ? ENGINE_WAVL : ENGINE_AVL;
+    g_history = ptree_create(engine, HISTORY_DEPTH);
+    g_tree = g_history ? ptree_handle(g_history) : NULL;
+    if (g_tree == NULL)
+    {
+        MessageBox(NULL, "Failed to allocate the tree!", "Error", MB_OK | MB_ICONERROR);
+        return 0;
+    }
+
     // Calculate window size with frame
     RECT windowRect = {0, 0, WINDOW_WIDTH, WINDOW_HEIGHT};
     DWORD style = WS_OVERLAPPEDWINDOW & ~WS_THICKFRAME & ~WS_MAXIMIZEBOX;
@@ -439,6 +536,16 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
         return 0;
     }
 
+    // Layout and rasterization run off the UI thread
+    RenderConfig config = tree_render_config();
+    g_renderer = create_render_worker(&config, on_frame_ready, hWnd);
+    if (g_renderer == NULL)
+    {
+        MessageBox(NULL, "Failed to start the render worker!", "Error", MB_OK | MB_ICONERROR);
+        return 0;
+    }
+    submit_frame(FALSE);
+
     ShowWindow(hWnd, nCmdShow);
     UpdateWindow(hWnd);
 
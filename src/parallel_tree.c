@@ -0,0 +1,308 @@
+#include "parallel_tree.h"
+
+#include <limits.h>
+
+// Depth below which subtrees are handled serially (about 16 tasks per thread)
+static int spawn_depth(TaskPool *pool)
+{
+    if (pool == NULL)
+        return 0;
+
+    int depth = 4;
+    for (int t = task_pool_threads(pool); t > 1; t >>= 1)
+        depth++;
+    return depth;
+}
+
+// ---- Teardown ----
+
+typedef struct
+{
+    TaskPool *pool;
+    AVLNode *node;
+    int depth;
+} FreeJob;
+
+static void free_subtree(TaskPool *pool, AVLNode *node, int depth);
+
+static void free_job(void *arg)
+{
+    FreeJob *job = (FreeJob *)arg;
+    free_subtree(job->pool, job->node, job->depth);
+}
+
+static void free_subtree(TaskPool *pool, AVLNode *node, int depth)
+{
+    if (node == NULL)
+        return;
+
+    if (depth <= 0)
+    {
+        free_tree(node);
+        return;
+    }
+
+    TaskGroup group;
+    task_group_init(&group);
+    FreeJob left = {pool, node->left, depth - 1};
+    task_spawn(pool, &group, free_job, &left);
+    free_subtree(pool, node->right, depth - 1);
+    task_group_wait(pool, &group);
+    free(node);
+}
+
+// Free every node under root
+void parallel_free_tree(TaskPool *pool, AVLNode *root)
+{
+    free_subtree(pool, root, spawn_depth(pool));
+}
+
+// ---- Counting ----
+
+typedef struct
+{
+    TaskPool *pool;
+    AVLNode *node;
+    int depth;
+    size_t result;
+} CountJob;
+
+static size_t count_serial(AVLNode *node)
+{
+    size_t count = 0;
+    while (node != NULL)
+    {
+        count += 1 + count_serial(node->left);
+        node = node->right;
+    }
+    return count;
+}
+
+static size_t count_subtree(TaskPool *pool, AVLNode *node, int depth);
+
+static void count_job(void *arg)
+{
+    CountJob *job = (CountJob *)arg;
+    job->result = count_subtree(job->pool, job->node, job->depth);
+}
+
+static size_t count_subtree(TaskPool *pool, AVLNode *node, int depth)
+{
+    if (node == NULL)
+        return 0;
+    if (depth <= 0)
+        return count_serial(node);
+
+    TaskGroup group;
+    task_group_init(&group);
+    CountJob left = {pool, node->left, depth - 1, 0};
+    task_spawn(pool, &group, count_job, &left);
+    size_t right = count_subtree(pool, node->right, depth - 1);
+    task_group_wait(pool, &group);
+    return 1 + left.result + right;
+}
+
+// Count every node under root
+size_t parallel_count_nodes(TaskPool *pool, AVLNode *root)
+{
+    return count_subtree(pool, root, spawn_depth(pool));
+}
+
+// ---- Invariant validation ----
+
+// Result of validating one subtree
+typedef struct
+{
+    int valid;
+    int height; // stored height (AVL) or rank + 1 (WAVL) of the subtree root
+    size_t count;
+#ifdef TREE_AGGREGATE
+    TreeAggregate agg; // recomputed from the keys
+#endif
+} CheckResult;
+
+typedef struct
+{
+    TaskPool *pool;
+    BalanceEngine engine;
+    AVLNode *node;
+    long long lo;
+    long long hi;
+    int depth;
+    CheckResult result;
+} CheckJob;
+
+static CheckResult check_subtree(TaskPool *pool, BalanceEngine engine, AVLNode *node,
+                                 long long lo, long long hi, int depth);
+
+static void check_job(void *arg)
+{
+    CheckJob *job = (CheckJob *)arg;
+    job->result = check_subtree(job->pool, job->engine, job->node, job->lo, job->hi, job->depth);
+}
+
+// Check one node against its already validated children
+static int check_node(BalanceEngine engine, AVLNode *node, CheckResult l, CheckResult r)
+{
+    if (node->balance_factor != l.height - r.height)
+        return 0;
+
+    if (engine == ENGINE_WAVL)
+    {
+        // Rank differences of 1 or 2, and every leaf has rank 0
+        int dl = node->height - l.height, dr = node->height - r.height;
+        if (dl < 1 || dl > 2 || dr < 1 || dr > 2)
+            return 0;
+        return node->left != NULL || node->right != NULL || node->height == 1;
+    }
+
+    int expected = (l.height > r.height ? l.height : r.height) + 1;
+    return node->height == expected && node->balance_factor >= -1 && node->balance_factor <= 1;
+}
+
+static CheckResult check_subtree(TaskPool *pool, BalanceEngine engine, AVLNode *node,
+                                 long long lo, long long hi, int depth)
+{
+    CheckResult res = {.valid = 1};
+#ifdef TREE_AGGREGATE
+    res.agg = aggregate_empty();
+#endif
+    if (node == NULL)
+        return res;
+
+    if (node->key <= lo || node->key >= hi)
+    {
+        res.valid = 0;
+        return res;
+    }
+
+    CheckResult l, r;
+    if (depth > 0)
+    {
+        TaskGroup group;
+        task_group_init(&group);
+        CheckJob left = {pool, engine, node->left, lo, node->key, depth - 1, {.valid = 1}};
+        task_spawn(pool, &group, check_job, &left);
+        r = check_subtree(pool, engine, node->right, node->key, hi, depth - 1);
+        task_group_wait(pool, &group);
+        l = left.result;
+    }
+    else
+    {
+        l = check_subtree(pool, engine, node->left, lo, node->key, 0);
+        r = check_subtree(pool, engine, node->right, node->key, hi, 0);
+    }
+
+    res.valid = l.valid && r.valid && check_node(engine, node, l, r);
+    res.height = node->height;
+    res.count = 1 + l.count + r.count;
+#ifdef TREE_AGGREGATE
+    TreeAggregate self = (node->flags & NODE_TOMBSTONE) ? aggregate_empty() : aggregate_of(node->key);
+    res.agg = aggregate_combine(aggregate_combine(l.agg, self), r.agg);
+    res.valid = res.valid && aggregate_equal(res.agg, node->agg);
+#endif
+    return res;
+}
+
+// Check ordering, height/rank and balance_factor consistency (and stored
+// aggregates when built in), and that the node count matches live keys plus
+// tombstones
+int validate_tree(const AVLTree *tree, TaskPool *pool)
+{
+    CheckResult res = check_subtree(pool, tree->engine, tree->root,
+                                    (long long)INT_MIN - 1, (long long)INT_MAX + 1,
+                                    spawn_depth(pool));
+    return res.valid && res.count == tree->size + tree->tombstones;
+}
+
+// ---- Bulk build ----
+
+typedef struct
+{
+    TaskPool *pool;
+    AVLTree *tree;
+    const int *keys;
+    size_t n;
+    int depth;
+    AVLNode *result;
+    int failed;
+} BuildJob;
+
+static AVLNode *build_subtree(TaskPool *pool, AVLTree *tree, const int *keys, size_t n, int depth,
+                              int *failed);
+
+static void build_job(void *arg)
+{
+    BuildJob *job = (BuildJob *)arg;
+    job->result = build_subtree(job->pool, job->tree, job->keys, job->n, job->depth, &job->failed);
+}
+
+static AVLNode *build_subtree(TaskPool *pool, AVLTree *tree, const int *keys, size_t n, int depth,
+                              int *failed)
+{
+    if (n == 0)
+        return NULL;
+
+    size_t mid = n / 2;
+    // malloc'd nodes are accounted in one go once the build succeeds
+    AVLNode *node = tree->arena ? tree_new_node(tree, keys[mid]) : create_node(keys[mid]);
+    if (node == NULL)
+    {
+        *failed = 1;
+        return NULL;
+    }
+
+    if (depth > 0)
+    {
+        TaskGroup group;
+        task_group_init(&group);
+        BuildJob left = {pool, tree, keys, mid, depth - 1, NULL, 0};
+        task_spawn(pool, &group, build_job, &left);
+        node->right = build_subtree(pool, tree, keys + mid + 1, n - mid - 1, depth - 1, failed);
+        task_group_wait(pool, &group);
+        node->left = left.result;
+        *failed |= left.failed;
+    }
+    else
+    {
+        node->left = build_subtree(pool, tree, keys, mid, 0, failed);
+        node->right = build_subtree(pool, tree, keys + mid + 1, n - mid - 1, 0, failed);
+    }
+
+    update_height(node);
+    return node;
+}
+
+// Build a perfectly balanced tree from strictly ascending keys in O(n).
+// The tree must be empty; returns 0 on unsorted input or allocation failure.
+int build_tree_from_sorted(AVLTree *tree, const int *keys, size_t n, TaskPool *pool)
+{
+    if (tree->root != NULL)
+        return 0;
+
+    for (size_t i = 1; i < n; i++)
+    {
+        if (keys[i - 1] >= keys[i])
+            return 0;
+    }
+
+    // Arena allocation is single-threaded, so arena trees build serially
+    int failed = 0;
+    int depth = tree->arena ? 0 : spawn_depth(pool);
+    AVLNode *root = build_subtree(pool, tree, keys, n, depth, &failed);
+    if (failed)
+    {
+        if (tree->arena)
+            tree_release(tree, root);
+        else
+            parallel_free_tree(pool, root);
+        return 0;
+    }
+
+    if (tree->arena == NULL && root != NULL)
+        account_node_allocs(tree, root, n);
+    tree->root = root;
+    tree->size = n;
+    tree->version++;
+    return 1;
+}
\ No newline at end of file
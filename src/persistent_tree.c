@@ -0,0 +1,458 @@
+#include "persistent_tree.h"
+#include "wavl_tree.h"
+
+
+#define REF_ONE (1u << NODE_REF_SHIFT)
+
+// Nodes an update can copy: the path plus a sibling and its child per level
+#define MAX_FRESH (3 * TREE_MAX_DEPTH)
+
+struct PersistentTree
+{
+    AVLTree *tree;        // current version; allocator, memory and stats for all versions
+    TreeVersion *history; // ring of versions, oldest first
+    size_t oldest;        // ring slot of the oldest version
+    size_t count;
+    size_t current; // position of the current version from the oldest
+    size_t capacity;
+    size_t max_history; // undo steps kept
+    AVLNode *fresh[MAX_FRESH];
+    size_t fresh_count; // nodes copied by the update in progress
+    int failed;         // an allocation failed; the update is rolled back
+    int removed;
+};
+
+static AVLNode *share(AVLNode *node)
+{
+    if (node)
+        node->flags += REF_ONE;
+    return node;
+}
+
+// Drop one reference, freeing the node and what only it referenced
+static void unshare(PersistentTree *pt, AVLNode *node)
+{
+    if (node == NULL)
+        return;
+
+    node->flags -= REF_ONE;
+    if ((node->flags >> NODE_REF_SHIFT) != 0)
+        return;
+
+    unshare(pt, node->left);
+    unshare(pt, node->right);
+    tree_free_node(pt->tree, node);
+}
+
+// Private copy of src (links left to the caller) for the update in progress
+static AVLNode *copy_node(PersistentTree *pt, const AVLNode *src, int key)
+{
+    AVLNode *node = pt->fresh_count < MAX_FRESH ? tree_new_node(pt->tree, key) : NULL;
+    if (node == NULL)
+    {
+        pt->failed = 1;
+        return NULL;
+    }
+
+    if (src)
+    {
+        node->height = src->height;
+        node->balance_factor = src->balance_factor;
+#ifdef TREE_AGGREGATE
+        node->agg = src->agg;
+#endif
+    }
+    node->flags = NODE_FRESH | REF_ONE;
+    pt->fresh[pt->fresh_count++] = node;
+    return node;
+}
+
+// Make a child link of a fresh node writable, copying it if it is shared
+static AVLNode *own(PersistentTree *pt, AVLNode *node)
+{
+    if (node->flags & NODE_FRESH)
+        return node;
+
+    AVLNode *copy = copy_node(pt, node, node->key);
+    if (copy == NULL)
+        return node;
+    copy->left = share(node->left);
+    copy->right = share(node->right);
+    unshare(pt, node);
+    return copy;
+}
+
+// Release a subtree reference an interrupted update was holding
+static void discard(PersistentTree *pt, AVLNode *node)
+{
+    if (node && !(node->flags & NODE_FRESH))
+        unshare(pt, node);
+}
+
+static AVLNode *rotate(PersistentTree *pt, AVLNode *node, int right)
+{
+    pt->tree->stats.rotations++;
+    return right ? rotate_right(node) : rotate_left(node);
+}
+
+// AVL rebalance of a fresh node; rotated children are copied first
+static AVLNode *rebalance(PersistentTree *pt, AVLNode *node)
+{
+    int old_height = node->height;
+    update_height(node);
+    pt->tree->stats.retrace_steps++;
+    pt->tree->stats.height_changes += node->height != old_height;
+
+    if (node->balance_factor > 1)
+    {
+        node->left = own(pt, node->left);
+        if (pt->failed)
+            return node;
+        if (balance_factor(node->left) < 0)
+        {
+            node->left->right = own(pt, node->left->right);
+            if (pt->failed)
+                return node;
+            node->left = rotate(pt, node->left, 0);
+            node = rotate(pt, node, 1);
+            record_rotation(pt->tree, ROTATION_LR, node);
+        }
+        else
+        {
+            node = rotate(pt, node, 1);
+            record_rotation(pt->tree, ROTATION_LL, node);
+        }
+    }
+    else if (node->balance_factor < -1)
+    {
+        node->right = own(pt, node->right);
+        if (pt->failed)
+            return node;
+        if (balance_factor(node->right) > 0)
+        {
+            node->right->left = own(pt, node->right->left);
+            if (pt->failed)
+                return node;
+            node->right = rotate(pt, node->right, 1);
+            node = rotate(pt, node, 0);
+            record_rotation(pt->tree, ROTATION_RL, node);
+        }
+        else
+        {
+            node = rotate(pt, node, 0);
+            record_rotation(pt->tree, ROTATION_RR, node);
+        }
+    }
+    return node;
+}
+
+static inline int rank_gap(const AVLNode *parent, const AVLNode *child)
+{
+    return parent->height - (child ? child->height : 0);
+}
+
+// WAVL retrace of a fresh node whose left or right child was updated. The
+// engine's fix runs in place once the nodes it is about to change (the
+// sibling and one grandchild at most) are private copies.
+static AVLNode *wavl_rebalance(PersistentTree *pt, AVLNode *node, int left, int inserted)
+{
+    AVLNode *child = left ? node->left : node->right;
+    AVLNode **sibling = left ? &node->right : &node->left;
+
+    if (inserted)
+    {
+        // A 0-child beside a 2-child; a double rotation relinks its inner child
+        if (rank_gap(node, child) == 0 && rank_gap(node, *sibling) != 1)
+        {
+            AVLNode **inner = left ? &child->right : &child->left;
+            if (rank_gap(child, *inner) != 2)
+                *inner = own(pt, *inner);
+        }
+        return pt->failed ? node : wavl_insert_fix(pt->tree, node, left);
+    }
+
+    // A 3-child beside a 1-child: the sibling is demoted or rotated
+    if ((node->left || node->right) && rank_gap(node, child) == 3 && rank_gap(node, *sibling) != 2)
+    {
+        *sibling = own(pt, *sibling);
+        if (pt->failed)
+            return node;
+
+        AVLNode *y = *sibling;
+        AVLNode **inner = left ? &y->left : &y->right;
+        AVLNode *outer = left ? y->right : y->left;
+        int demote = rank_gap(y, y->left) == 2 && rank_gap(y, y->right) == 2;
+        if (!demote && rank_gap(y, outer) != 1)
+            *inner = own(pt, *inner);
+    }
+    return pt->failed ? node : wavl_delete_fix(pt->tree, node, left);
+}
+
+static AVLNode *retrace(PersistentTree *pt, AVLNode *node, int left, int inserted)
+{
+    if (pt->tree->engine == ENGINE_WAVL)
+        return wavl_rebalance(pt, node, left, inserted);
+    return rebalance(pt, node);
+}
+
+// Copy node with one child replaced by updated (an owned reference)
+static AVLNode *replace_child(PersistentTree *pt, AVLNode *node, int left, AVLNode *updated, int inserted)
+{
+    AVLNode *copy = copy_node(pt, node, node->key);
+    if (copy == NULL)
+    {
+        discard(pt, updated);
+        return node;
+    }
+
+    copy->left = left ? updated : share(node->left);
+    copy->right = left ? share(node->right) : updated;
+    return retrace(pt, copy, left, inserted);
+}
+
+// Returns node itself when nothing changed below it
+static AVLNode *insert_path(PersistentTree *pt, AVLNode *node, int key)
+{
+    if (node == NULL)
+        return copy_node(pt, NULL, key);
+    if (key == node->key)
+        return node;
+
+    int left = key < node->key;
+    AVLNode *child = left ? node->left : node->right;
+    AVLNode *updated = insert_path(pt, child, key);
+    if (updated == child || pt->failed)
+        return node;
+    return replace_child(pt, node, left, updated, 1);
+}
+
+static AVLNode *delete_path(PersistentTree *pt, AVLNode *node, int key)
+{
+    if (node == NULL)
+        return NULL;
+
+    if (key != node->key)
+    {
+        int left = key < node->key;
+        AVLNode *child = left ? node->left : node->right;
+        AVLNode *updated = delete_path(pt, child, key);
+        if (updated == child || pt->failed)
+            return node;
+        return replace_child(pt, node, left, updated, 0);
+    }
+
+    pt->removed = 1;
+    if (node->left == NULL || node->right == NULL)
+        return share(node->left ? node->left : node->right);
+
+    // Two children: a copy takes the successor's key and loses the successor
+    int successor = find_min(node->right)->key;
+    AVLNode *right = delete_path(pt, node->right, successor);
+    if (pt->failed)
+        return node;
+
+    AVLNode *copy = copy_node(pt, node, successor);
+    if (copy == NULL)
+    {
+        discard(pt, right);
+        return node;
+    }
+    copy->left = share(node->left);
+    copy->right = right;
+    return retrace(pt, copy, 0, 0);
+}
+
+// Version at position i of the history, 0 being the oldest
+static TreeVersion *history_at(PersistentTree *pt, size_t i)
+{
+    return &pt->history[(pt->oldest + i) % pt->capacity];
+}
+
+static void sync_handle(PersistentTree *pt)
+{
+    pt->tree->root = history_at(pt, pt->current)->root;
+    pt->tree->size = history_at(pt, pt->current)->size;
+    pt->tree->version++;
+}
+
+static void drop_oldest(PersistentTree *pt)
+{
+    unshare(pt, history_at(pt, 0)->root);
+    pt->oldest = (pt->oldest + 1) % pt->capacity;
+    pt->count--;
+}
+
+// Double the ring, unwrapping it so the oldest version lands in slot 0
+static int grow_history(PersistentTree *pt)
+{
+    size_t capacity = pt->capacity * 2;
+    TreeVersion *grown = (TreeVersion *)malloc(capacity * sizeof(TreeVersion));
+    if (grown == NULL)
+        return 0;
+
+    for (size_t i = 0; i < pt->count; i++)
+        grown[i] = *history_at(pt, i);
+    free(pt->history);
+    pt->tree->memory.handle_bytes += (capacity - pt->capacity) * sizeof(TreeVersion);
+    pt->history = grown;
+    pt->capacity = capacity;
+    pt->oldest = 0;
+    return 1;
+}
+
+// Make root (an owned reference) the current version, dropping redo states
+static void commit(PersistentTree *pt, AVLNode *root, size_t size)
+{
+    while (pt->count > pt->current + 1)
+        unshare(pt, history_at(pt, --pt->count)->root);
+
+    // Out of room: forget the oldest state rather than fail the update
+    if (pt->count > pt->max_history || (pt->count == pt->capacity && !grow_history(pt)))
+        drop_oldest(pt);
+
+    TreeVersion *slot = history_at(pt, pt->count);
+    slot->root = root;
+    slot->size = size;
+    pt->current = pt->count++;
+    sync_handle(pt);
+}
+
+static void begin_update(PersistentTree *pt)
+{
+    pt->fresh_count = 0;
+    pt->failed = 0;
+    pt->removed = 0;
+}
+
+// Seal the copies, or undo them all if an allocation failed
+static int end_update(PersistentTree *pt, AVLNode *root, AVLNode *old_root, size_t size)
+{
+    if (pt->failed)
+    {
+        for (size_t i = 0; i < pt->fresh_count; i++)
+        {
+            discard(pt, pt->fresh[i]->left);
+            discard(pt, pt->fresh[i]->right);
+        }
+        for (size_t i = 0; i < pt->fresh_count; i++)
+            tree_free_node(pt->tree, pt->fresh[i]);
+        return 0;
+    }
+    if (root == old_root && !pt->removed)
+        return 0;
+
+    for (size_t i = 0; i < pt->fresh_count; i++)
+        pt->fresh[i]->flags &= ~NODE_FRESH;
+    commit(pt, root, size);
+    return 1;
+}
+
+PersistentTree *ptree_create(BalanceEngine engine, size_t max_history)
+{
+    PersistentTree *pt = (PersistentTree *)calloc(1, sizeof(PersistentTree));
+    if (pt == NULL)
+        return NULL;
+
+    pt->tree = create_tree(engine);
+    pt->capacity = 16;
+    pt->history = (TreeVersion *)calloc(pt->capacity, sizeof(TreeVersion));
+    if (pt->tree == NULL || pt->history == NULL)
+    {
+        free(pt->tree);
+        free(pt->history);
+        free(pt);
+        return NULL;
+    }
+
+    pt->count = 1; // the empty tree
+    pt->max_history = max_history;
+    pt->tree->memory.handle_bytes += sizeof(PersistentTree) + pt->capacity * sizeof(TreeVersion);
+    return pt;
+}
+
+void ptree_destroy(PersistentTree *pt)
+{
+    if (pt == NULL)
+        return;
+
+    for (size_t i = 0; i < pt->count; i++)
+        unshare(pt, history_at(pt, i)->root);
+    pt->tree->root = NULL;
+    destroy_tree(pt->tree);
+    free(pt->history);
+    free(pt);
+}
+
+// Read-only view of the current version (search, render, stats, memory)
+AVLTree *ptree_handle(PersistentTree *pt)
+{
+    return pt->tree;
+}
+
+int ptree_insert(PersistentTree *pt, int key)
+{
+    AVLNode *root = pt->tree->root;
+    begin_update(pt);
+    pt->tree->stats.inserts++;
+    return end_update(pt, insert_path(pt, root, key), root, pt->tree->size + 1);
+}
+
+int ptree_delete(PersistentTree *pt, int key)
+{
+    AVLNode *root = pt->tree->root;
+    begin_update(pt);
+    pt->tree->stats.deletes++;
+    return end_update(pt, delete_path(pt, root, key), root, pt->tree->size - 1);
+}
+
+int ptree_undo(PersistentTree *pt)
+{
+    if (pt->current == 0)
+        return 0;
+    pt->current--;
+    sync_handle(pt);
+    return 1;
+}
+
+int ptree_redo(PersistentTree *pt)
+{
+    if (pt->current + 1 >= pt->count)
+        return 0;
+    pt->current++;
+    sync_handle(pt);
+    return 1;
+}
+
+size_t ptree_undo_depth(const PersistentTree *pt)
+{
+    return pt->current;
+}
+
+size_t ptree_redo_depth(const PersistentTree *pt)
+{
+    return pt->count - pt->current - 1;
+}
+
+// Retained handle to the current version, valid until ptree_release
+TreeVersion ptree_snapshot(PersistentTree *pt)
+{
+    TreeVersion version = *history_at(pt, pt->current);
+    share(version.root);
+    return version;
+}
+
+void ptree_release(PersistentTree *pt, TreeVersion version)
+{
+    unshare(pt, version.root);
+}
+
+// Make a retained version current again (as a new, undoable step)
+void ptree_checkout(PersistentTree *pt, TreeVersion version)
+{
+    commit(pt, share(version.root), version.size);
+}
+
+AVLNode *version_search(TreeVersion version, int key)
+{
+    return search_node(version.root, key);
+}
@@ -0,0 +1,290 @@
+#include "relocate.h"
+#include "key_cache.h"
+
+#include <stdint.h>
+
+// Pending work. Layout tasks copy the subtree under an old node, at most
+// height levels of it, and link the copy of its root through link. Expand
+// tasks (top > 0) run once the top levels under *link are copied and queue
+// the subtrees hanging below them. While old nodes are freed the stack
+// holds just the nodes still to free.
+typedef struct
+{
+    AVLNode *node;
+    AVLNode **link;
+    int height;
+    int top;
+} Task;
+
+struct Relocation
+{
+    AVLTree *tree;
+    NodeLayout layout;
+    unsigned long version; // tree version the copies are taken from
+    AVLNode *block;        // chunk link node, then capacity nodes
+    size_t capacity;
+    size_t copied;
+    size_t scanned; // BFS: copies whose children are copied too
+    AVLNode *new_root;
+    Task *tasks;
+    size_t depth;
+    size_t task_capacity;
+    int releasing; // copies swapped in, old malloc'd nodes being freed
+    int failed;
+    unsigned long restarts;
+};
+
+static int push_task(Relocation *r, AVLNode *node, AVLNode **link, int height, int top)
+{
+    if (r->depth == r->task_capacity)
+    {
+        size_t capacity = r->task_capacity * 2;
+        Task *tasks = (Task *)realloc(r->tasks, capacity * sizeof(Task));
+        if (tasks == NULL)
+            return 0;
+        r->tasks = tasks;
+        r->task_capacity = capacity;
+    }
+    r->tasks[r->depth++] = (Task){node, link, height, top};
+    return 1;
+}
+
+// Copy an old node into the next slot; its child links still point at old
+// nodes until the children are copied in turn
+static void emit(Relocation *r, AVLNode *node, AVLNode **link)
+{
+    AVLNode *copy = &r->block[1 + r->copied++];
+    *copy = *node;
+    *link = copy;
+}
+
+// (Re)start copying the tree as it is now
+static int begin_copy(Relocation *r)
+{
+    AVLTree *tree = r->tree;
+    size_t count = tree->size + tree->tombstones;
+    if (r->block == NULL || count > r->capacity)
+    {
+        free(r->block);
+        r->block = (AVLNode *)malloc((count + 1) * sizeof(AVLNode));
+        r->capacity = count;
+        if (r->block == NULL)
+            return 0;
+    }
+
+    r->version = tree->version;
+    r->copied = 0;
+    r->scanned = 0;
+    r->new_root = NULL;
+    r->depth = 0;
+    if (tree->root == NULL)
+        return 1;
+    if (r->layout == LAYOUT_BFS)
+    {
+        emit(r, tree->root, &r->new_root);
+        return 1;
+    }
+    return push_task(r, tree->root, &r->new_root, tree->root->height, 0);
+}
+
+// Queue the subtrees hanging below the top levels copied under copy,
+// rightmost first so the leftmost is laid out next
+static int push_bottoms(Relocation *r, AVLNode *copy, int levels, int height)
+{
+    if (levels > 1)
+        return (copy->right == NULL || push_bottoms(r, copy->right, levels - 1, height)) &&
+               (copy->left == NULL || push_bottoms(r, copy->left, levels - 1, height));
+
+    return (copy->right == NULL || push_task(r, copy->right, &copy->right, height, 0)) &&
+           (copy->left == NULL || push_task(r, copy->left, &copy->left, height, 0));
+}
+
+static int copy_veb(Relocation *r, size_t budget)
+{
+    size_t done = 0;
+    while (done < budget && r->depth > 0)
+    {
+        Task t = r->tasks[--r->depth];
+        if (t.top > 0)
+        {
+            if (!push_bottoms(r, *t.link, t.top, t.height))
+                return 0;
+        }
+        else if (t.height > 1)
+        {
+            // Top floor(h/2) levels first, then the subtrees below them
+            int top = t.height / 2;
+            if (!push_task(r, NULL, t.link, t.height - top, top) || !push_task(r, t.node, t.link, top, 0))
+                return 0;
+        }
+        else
+        {
+            // Its children, if any, belong to the enclosing piece's bottoms
+            emit(r, t.node, t.link);
+            done++;
+        }
+    }
+    return 1;
+}
+
+// Cheney-style: the copies double as the queue of nodes to expand
+static void copy_bfs(Relocation *r, size_t budget)
+{
+    size_t done = 0;
+    while (done < budget && r->scanned < r->copied)
+    {
+        AVLNode *copy = &r->block[1 + r->scanned++];
+        if (copy->left)
+        {
+            emit(r, copy->left, &copy->left);
+            done++;
+        }
+        if (copy->right)
+        {
+            emit(r, copy->right, &copy->right);
+            done++;
+        }
+    }
+}
+
+// Free old nodes in pre-order; the stack never holds more than a path
+static void release_old(Relocation *r, size_t budget)
+{
+    for (size_t i = 0; i < budget && r->depth > 0; i++)
+    {
+        AVLNode *node = r->tasks[--r->depth].node;
+        if (node->right)
+            r->tasks[r->depth++].node = node->right;
+        if (node->left)
+            r->tasks[r->depth++].node = node->left;
+        tree_free_unpooled(r->tree, node);
+    }
+}
+
+// Link the copies in place of the old nodes
+static RelocateStatus swap_in(Relocation *r)
+{
+    AVLTree *tree = r->tree;
+    if (r->new_root == NULL)
+        return RELOCATE_DONE;
+    if (r->copied != tree->size + tree->tombstones)
+    {
+        // Some node's height understated its subtree; keep the old nodes
+        r->failed = 1;
+        return RELOCATE_FAILED;
+    }
+
+    AVLNode *old_root = tree->root;
+    int was_malloc = tree->arena == NULL;
+    int cached = cache_in_step(tree); // same keys, so the cache stays exact
+    if (!tree_replace_chunks(tree, r->block, r->capacity, r->copied, RELOCATE_POOL_CHUNK))
+    {
+        r->failed = 1;
+        return RELOCATE_FAILED;
+    }
+    r->block = NULL;
+    tree->root = r->new_root;
+    tree->version++;
+    cache_catch_up(tree, cached);
+
+    if (!was_malloc)
+        return RELOCATE_DONE;
+    r->releasing = 1;
+    r->depth = 0;
+    r->tasks[r->depth++].node = old_root;
+    return RELOCATE_RUNNING;
+}
+
+Relocation *relocation_start(AVLTree *tree, NodeLayout layout)
+{
+    if (tree->arena && (tree->arena->chunk_nodes == 0 || tree->arena->borrowers || tree->arena->group))
+        return NULL;
+
+    Relocation *r = (Relocation *)calloc(1, sizeof(Relocation));
+    if (r == NULL)
+        return NULL;
+    r->tree = tree;
+    r->layout = layout;
+    r->task_capacity = 2 * TREE_MAX_DEPTH;
+    r->tasks = (Task *)malloc(r->task_capacity * sizeof(Task));
+    if (r->tasks == NULL || !begin_copy(r))
+    {
+        relocation_free(r);
+        return NULL;
+    }
+    return r;
+}
+
+RelocateStatus relocation_step(Relocation *r, size_t budget)
+{
+    if (r->failed)
+        return RELOCATE_FAILED;
+    if (r->releasing)
+    {
+        release_old(r, budget);
+        return r->depth > 0 ? RELOCATE_RUNNING : RELOCATE_DONE;
+    }
+
+    if (r->tree->version != r->version)
+    {
+        r->restarts++;
+        if (!begin_copy(r))
+        {
+            r->failed = 1;
+            return RELOCATE_FAILED;
+        }
+    }
+
+    if (r->layout == LAYOUT_BFS)
+    {
+        copy_bfs(r, budget);
+        if (r->scanned < r->copied)
+            return RELOCATE_RUNNING;
+    }
+    else
+    {
+        if (!copy_veb(r, budget))
+        {
+            r->failed = 1;
+            return RELOCATE_FAILED;
+        }
+        if (r->depth > 0)
+            return RELOCATE_RUNNING;
+    }
+    return swap_in(r);
+}
+
+unsigned long relocation_restarts(const Relocation *r)
+{
+    return r->restarts;
+}
+
+void relocation_free(Relocation *r)
+{
+    if (r == NULL)
+        return;
+    if (r->releasing)
+        release_old(r, SIZE_MAX);
+    free(r->block);
+    free(r->tasks);
+    free(r);
+}
+
+int tree_relocate(AVLTree *tree, NodeLayout layout)
+{
+    Relocation *r = relocation_start(tree, layout);
+    if (r == NULL)
+        return 0;
+
+    RelocateStatus status;
+    do
+        status = relocation_step(r, SIZE_MAX);
+    while (status == RELOCATE_RUNNING);
+    relocation_free(r);
+    return status == RELOCATE_DONE;
+}
+
+const char *layout_name(NodeLayout layout)
+{
+    return layout == LAYOUT_BFS ? "bfs" : "veb";
+}
@@ -0,0 +1,556 @@
+#include "render_worker.h"
+
+#include <math.h>
+#include <pthread.h>
+
+// Deepest level a snapshot will ever copy
+#define RENDER_MAX_LEVELS 20
+
+// Snapshot entry; children are indices into the snapshot, -1 for none
+typedef struct
+{
+    int key;
+    int balance_factor;
+    int left;
+    int right;
+    unsigned int marks;
+} SnapNode;
+
+// Where the layout put a snapshot node, and the span its subtree may use
+typedef struct
+{
+    int x;
+    int y;
+    int lo;
+    int hi;
+} Placement;
+
+typedef struct
+{
+    SnapNode *nodes;
+    size_t count;
+    unsigned long generation;
+    uint64_t submit_ns;
+} Snapshot;
+
+struct RenderWorker
+{
+    RenderConfig config;
+    int levels;      // levels that can reach the canvas
+    size_t capacity; // nodes in a full snapshot of those levels
+    Placement *place; // layout scratch, worker only
+
+    // Snapshots: scratch is filled by the submitting thread, pending is
+    // shared, working belongs to the worker
+    Snapshot scratch;
+    Snapshot pending;
+    Snapshot working;
+    int pending_fresh;
+
+    // Frames: back is drawn by the worker, ready is shared, front belongs
+    // to the acquiring thread
+    RenderFrame back;
+    RenderFrame ready;
+    RenderFrame front;
+    int ready_fresh;
+
+    int busy;
+    int stop;
+    RenderStats stats;
+    FrameReadyFn on_ready;
+    void *ctx;
+    pthread_mutex_t lock;
+    pthread_cond_t wake; // new snapshot or stop
+    pthread_cond_t idle; // worker finished everything submitted
+    pthread_t thread;
+};
+
+uint64_t render_now_ns(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// ---- Snapshot ----
+
+static int copy_subtree(Snapshot *snap, const AVLNode *node, const AVLNode *rotation, const AVLNode *found,
+                        int levels)
+{
+    if (node == NULL || levels == 0)
+        return -1;
+
+    int index = (int)snap->count++;
+    SnapNode *out = &snap->nodes[index];
+    out->key = node->key;
+    out->balance_factor = node->balance_factor;
+    out->marks = 0;
+    if (node == found)
+        out->marks |= RENDER_MARK_SEARCH;
+    else if (node == rotation)
+        out->marks |= RENDER_MARK_ROTATION;
+    if (node->flags & NODE_TOMBSTONE)
+        out->marks |= RENDER_MARK_TOMBSTONE;
+    if (levels == 1 && node->left)
+        out->marks |= RENDER_MARK_LEFT_MORE;
+    if (levels == 1 && node->right)
+        out->marks |= RENDER_MARK_RIGHT_MORE;
+
+    int left = copy_subtree(snap, node->left, rotation, found, levels - 1);
+    int right = copy_subtree(snap, node->right, rotation, found, levels - 1);
+    snap->nodes[index].left = left;
+    snap->nodes[index].right = right;
+    return index;
+}
+
+// ---- Rasterizer ----
+
+typedef struct
+{
+    uint32_t *px;
+    int width;
+    int height;
+} Canvas;
+
+// 3x5 glyphs, one row per byte, bit 2 is the leftmost column
+static const char GLYPHS[] = "0123456789-BF:";
+static const unsigned char FONT[][5] = {
+    {7, 5, 5, 5, 7}, {2, 6, 2, 2, 7}, {7, 1, 7, 4, 7}, {7, 1, 7, 1, 7}, {5, 5, 7, 1, 1},
+    {7, 4, 7, 1, 7}, {7, 4, 7, 5, 7}, {7, 1, 1, 1, 1}, {7, 5, 7, 5, 7}, {7, 5, 7, 1, 7},
+    {0, 0, 7, 0, 0}, {6, 5, 6, 5, 6}, {7, 4, 6, 4, 4}, {0, 2, 0, 2, 0},
+};
+
+static void blend(uint32_t *dst, uint32_t color, float alpha)
+{
+    if (alpha >= 1.0f)
+    {
+        *dst = color;
+        return;
+    }
+    uint32_t d = *dst;
+    uint32_t out = 0;
+    for (int shift = 0; shift < 24; shift += 8)
+    {
+        float a = (float)((d >> shift) & 0xFF);
+        float b = (float)((color >> shift) & 0xFF);
+        out |= (uint32_t)(a + (b - a) * alpha + 0.5f) << shift;
+    }
+    *dst = out;
+}
+
+static float coverage(float edge_distance)
+{
+    return edge_distance >= 1.0f ? 1.0f : edge_distance <= 0.0f ? 0.0f : edge_distance;
+}
+
+// Antialiased disc
+static void fill_circle(Canvas *c, float cx, float cy, float r, uint32_t color, float alpha)
+{
+    int y0 = (int)floorf(cy - r - 1), y1 = (int)ceilf(cy + r + 1);
+    int x0 = (int)floorf(cx - r - 1), x1 = (int)ceilf(cx + r + 1);
+    if (y0 < 0)
+        y0 = 0;
+    if (x0 < 0)
+        x0 = 0;
+    if (y1 > c->height - 1)
+        y1 = c->height - 1;
+    if (x1 > c->width - 1)
+        x1 = c->width - 1;
+
+    for (int y = y0; y <= y1; y++)
+    {
+        float dy = (float)y + 0.5f - cy;
+        for (int x = x0; x <= x1; x++)
+        {
+            float dx = (float)x + 0.5f - cx;
+            float cov = coverage(r + 0.5f - sqrtf(dx * dx + dy * dy));
+            if (cov > 0.0f)
+                blend(&c->px[(size_t)y * c->width + x], color, cov * alpha);
+        }
+    }
+}
+
+// Antialiased segment of the given width, walked along its major axis
+static void draw_line(Canvas *c, float x1, float y1, float x2, float y2, float width, uint32_t color)
+{
+    float dx = x2 - x1, dy = y2 - y1;
+    float len2 = dx * dx + dy * dy;
+    if (len2 < 0.25f)
+        return;
+
+    int steep = fabsf(dy) > fabsf(dx);
+    float major0 = steep ? fminf(y1, y2) : fminf(x1, x2);
+    float major1 = steep ? fmaxf(y1, y2) : fmaxf(x1, x2);
+    float slope = steep ? dx / dy : dy / dx;
+    float reach = width / 2.0f + 1.0f;
+    float spread = reach * sqrtf(1.0f + slope * slope);
+    int limit = steep ? c->height : c->width;
+    int cross = steep ? c->width : c->height;
+
+    int m0 = (int)floorf(major0 - reach), m1 = (int)ceilf(major1 + reach);
+    if (m0 < 0)
+        m0 = 0;
+    if (m1 > limit - 1)
+        m1 = limit - 1;
+
+    for (int m = m0; m <= m1; m++)
+    {
+        float mc = (float)m + 0.5f;
+        float clamped = fminf(fmaxf(mc, major0), major1);
+        float centre = steep ? x1 + (clamped - y1) * slope : y1 + (clamped - x1) * slope;
+        int n0 = (int)floorf(centre - spread), n1 = (int)ceilf(centre + spread);
+        if (n0 < 0)
+            n0 = 0;
+        if (n1 > cross - 1)
+            n1 = cross - 1;
+
+        for (int n = n0; n <= n1; n++)
+        {
+            float px = steep ? (float)n + 0.5f : mc;
+            float py = steep ? mc : (float)n + 0.5f;
+            float t = ((px - x1) * dx + (py - y1) * dy) / len2;
+            t = t < 0.0f ? 0.0f : t > 1.0f ? 1.0f : t;
+            float ex = x1 + t * dx - px, ey = y1 + t * dy - py;
+            float cov = coverage(width / 2.0f + 0.5f - sqrtf(ex * ex + ey * ey));
+            if (cov > 0.0f)
+            {
+                int x = steep ? n : m, y = steep ? m : n;
+                blend(&c->px[(size_t)y * c->width + x], color, cov);
+            }
+        }
+    }
+}
+
+// Text centred on (cx, cy) in the built-in font
+static void draw_text(Canvas *c, int cx, int cy, const char *text, int scale, uint32_t color)
+{
+    int len = (int)strlen(text);
+    int x = cx - (len * 4 * scale - scale) / 2;
+    int y = cy - 5 * scale / 2;
+
+    for (int i = 0; i < len; i++, x += 4 * scale)
+    {
+        const char *glyph = strchr(GLYPHS, text[i]);
+        if (glyph == NULL || text[i] == '\0')
+            continue;
+        const unsigned char *rows = FONT[glyph - GLYPHS];
+        for (int row = 0; row < 5 * scale; row++)
+        {
+            int py = y + row;
+            if (py < 0 || py >= c->height)
+                continue;
+            for (int col = 0; col < 3 * scale; col++)
+            {
+                int px = x + col;
+                if (px >= 0 && px < c->width && (rows[row / scale] >> (2 - col / scale) & 1))
+                    c->px[(size_t)py * c->width + px] = color;
+            }
+        }
+    }
+}
+
+// Largest scale at which text fits in width pixels
+static int text_scale(const char *text, int width, int max_scale)
+{
+    int len = (int)strlen(text);
+    for (int scale = max_scale; scale > 1; scale--)
+    {
+        if (len * 4 * scale - scale <= width)
+            return scale;
+    }
+    return 1;
+}
+
+// ---- Layout and drawing ----
+
+// Same interval-halving layout the visualizer has always used
+static void layout(RenderWorker *w, const Snapshot *snap, int index, int left, int right, int level)
+{
+    const RenderConfig *cfg = &w->config;
+    const SnapNode *node = &snap->nodes[index];
+    Placement *p = &w->place[index];
+    p->x = (left + right) / 2;
+    p->y = cfg->top + level * cfg->level_height;
+    p->lo = left;
+    p->hi = right;
+
+    if (node->left >= 0)
+        layout(w, snap, node->left, left, p->x - cfg->min_gap, level + 1);
+    if (node->right >= 0)
+        layout(w, snap, node->right, p->x + cfg->min_gap, right, level + 1);
+}
+
+// Edge from a node's bottom to the top of a child centred at child_x
+static void draw_edge(RenderWorker *w, Canvas *c, const Placement *p, int child_x)
+{
+    const RenderConfig *cfg = &w->config;
+    draw_line(c, (float)p->x, (float)(p->y + cfg->node_radius), (float)child_x,
+              (float)(p->y + cfg->level_height - cfg->node_radius), 3.0f, cfg->edge);
+}
+
+static void draw_node(RenderWorker *w, Canvas *c, const SnapNode *node, const Placement *p)
+{
+    const RenderConfig *cfg = &w->config;
+    float x = (float)p->x, y = (float)p->y;
+    float r = (float)cfg->node_radius;
+    if (y - r - 3.0f >= (float)c->height)
+        return;
+
+    uint32_t fill = cfg->node;
+    if (node->marks & RENDER_MARK_SEARCH)
+        fill = cfg->search;
+    else if (node->marks & RENDER_MARK_ROTATION)
+        fill = cfg->rotation;
+    else if (node->marks & RENDER_MARK_TOMBSTONE)
+        fill = cfg->tombstone;
+
+    fill_circle(c, x + 3.0f, y + 3.0f, r, 0x000000, 40.0f / 255.0f);
+    fill_circle(c, x, y, r, cfg->border, 1.0f);
+    fill_circle(c, x, y, r - 2.0f, fill, 1.0f);
+
+    char text[32];
+    int inner = 2 * cfg->node_radius - 12;
+    sprintf(text, "%d", node->key);
+    draw_text(c, p->x, p->y - 8, text, text_scale(text, inner, 3), cfg->text);
+    sprintf(text, "BF:%d", node->balance_factor);
+    draw_text(c, p->x, p->y + 12, text, text_scale(text, inner, 2), cfg->text);
+}
+
+static void render_snapshot(RenderWorker *w, const Snapshot *snap, RenderFrame *frame)
+{
+    const RenderConfig *cfg = &w->config;
+    Canvas c = {frame->pixels, frame->width, frame->height};
+    size_t total = (size_t)c.width * (size_t)c.height;
+    for (size_t i = 0; i < total; i++)
+        c.px[i] = cfg->background;
+
+    if (snap->count > 0)
+    {
+        layout(w, snap, 0, cfg->margin, cfg->width - cfg->margin, 0);
+
+        // Edges first so nodes sit on top of them; children cut off by the
+        // snapshot still get the edge that leads off the canvas
+        for (size_t i = 0; i < snap->count; i++)
+        {
+            const SnapNode *node = &snap->nodes[i];
+            const Placement *p = &w->place[i];
+            if (node->left >= 0)
+                draw_edge(w, &c, p, w->place[node->left].x);
+            else if (node->marks & RENDER_MARK_LEFT_MORE)
+                draw_edge(w, &c, p, (p->lo + p->x - cfg->min_gap) / 2);
+            if (node->right >= 0)
+                draw_edge(w, &c, p, w->place[node->right].x);
+            else if (node->marks & RENDER_MARK_RIGHT_MORE)
+                draw_edge(w, &c, p, (p->x + cfg->min_gap + p->hi) / 2);
+        }
+        for (size_t i = 0; i < snap->count; i++)
+            draw_node(w, &c, &snap->nodes[i], &w->place[i]);
+    }
+
+    frame->generation = snap->generation;
+    frame->nodes = snap->count;
+    frame->submit_ns = snap->submit_ns;
+    frame->done_ns = render_now_ns();
+}
+
+// ---- Worker thread ----
+
+static void swap_snapshots(Snapshot *a, Snapshot *b)
+{
+    Snapshot t = *a;
+    *a = *b;
+    *b = t;
+}
+
+static void swap_frames(RenderFrame *a, RenderFrame *b)
+{
+    RenderFrame t = *a;
+    *a = *b;
+    *b = t;
+}
+
+static void *worker_main(void *arg)
+{
+    RenderWorker *w = (RenderWorker *)arg;
+
+    pthread_mutex_lock(&w->lock);
+    for (;;)
+    {
+        while (!w->stop && !w->pending_fresh)
+        {
+            w->busy = 0;
+            pthread_cond_broadcast(&w->idle);
+            pthread_cond_wait(&w->wake, &w->lock);
+        }
+        if (w->stop)
+            break;
+
+        swap_snapshots(&w->pending, &w->working);
+        w->pending_fresh = 0;
+        w->busy = 1;
+        pthread_mutex_unlock(&w->lock);
+
+        render_snapshot(w, &w->working, &w->back);
+
+        pthread_mutex_lock(&w->lock);
+        swap_frames(&w->back, &w->ready);
+        if (w->ready_fresh)
+            w->stats.stale_frames++;
+        w->ready_fresh = 1;
+        w->stats.rendered++;
+
+        if (w->on_ready)
+        {
+            pthread_mutex_unlock(&w->lock);
+            w->on_ready(w->ctx);
+            pthread_mutex_lock(&w->lock);
+        }
+    }
+    w->busy = 0;
+    pthread_cond_broadcast(&w->idle);
+    pthread_mutex_unlock(&w->lock);
+    return NULL;
+}
+
+static int alloc_frame(RenderFrame *frame, const RenderConfig *config)
+{
+    memset(frame, 0, sizeof(*frame));
+    frame->width = config->width;
+    frame->height = config->height;
+    frame->pixels = (uint32_t *)malloc((size_t)config->width * (size_t)config->height * sizeof(uint32_t));
+    return frame->pixels != NULL;
+}
+
+static int alloc_snapshot(Snapshot *snap, size_t capacity)
+{
+    memset(snap, 0, sizeof(*snap));
+    snap->nodes = (SnapNode *)malloc(capacity * sizeof(SnapNode));
+    return snap->nodes != NULL;
+}
+
+static void free_buffers(RenderWorker *w)
+{
+    free(w->place);
+    free(w->scratch.nodes);
+    free(w->pending.nodes);
+    free(w->working.nodes);
+    free(w->back.pixels);
+    free(w->ready.pixels);
+    free(w->front.pixels);
+}
+
+// Start a worker drawing on a width x height canvas. on_ready (may be NULL)
+// runs on the worker thread after each frame is published.
+RenderWorker *create_render_worker(const RenderConfig *config, FrameReadyFn on_ready, void *ctx)
+{
+    if (config->width <= 0 || config->height <= 0 || config->level_height <= 0)
+        return NULL;
+
+    RenderWorker *w = (RenderWorker *)calloc(1, sizeof(RenderWorker));
+    if (w == NULL)
+        return NULL;
+
+    w->config = *config;
+    w->on_ready = on_ready;
+    w->ctx = ctx;
+    w->levels = (config->height - config->top + config->node_radius) / config->level_height + 1;
+    if (w->levels < 1)
+        w->levels = 1;
+    if (w->levels > RENDER_MAX_LEVELS)
+        w->levels = RENDER_MAX_LEVELS;
+    w->capacity = ((size_t)1 << w->levels) - 1;
+
+    w->place = (Placement *)malloc(w->capacity * sizeof(Placement));
+    int ok = w->place && alloc_snapshot(&w->scratch, w->capacity) &&
+             alloc_snapshot(&w->pending, w->capacity) && alloc_snapshot(&w->working, w->capacity) &&
+             alloc_frame(&w->back, config) && alloc_frame(&w->ready, config) && alloc_frame(&w->front, config);
+    if (!ok)
+    {
+        free_buffers(w);
+        free(w);
+        return NULL;
+    }
+
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->wake, NULL);
+    pthread_cond_init(&w->idle, NULL);
+    if (pthread_create(&w->thread, NULL, worker_main, w) != 0)
+    {
+        pthread_mutex_destroy(&w->lock);
+        pthread_cond_destroy(&w->wake);
+        pthread_cond_destroy(&w->idle);
+        free_buffers(w);
+        free(w);
+        return NULL;
+    }
+    return w;
+}
+
+void destroy_render_worker(RenderWorker *w)
+{
+    if (w == NULL)
+        return;
+
+    pthread_mutex_lock(&w->lock);
+    w->stop = 1;
+    pthread_cond_signal(&w->wake);
+    pthread_mutex_unlock(&w->lock);
+    pthread_join(w->thread, NULL);
+
+    pthread_mutex_destroy(&w->lock);
+    pthread_cond_destroy(&w->wake);
+    pthread_cond_destroy(&w->idle);
+    free_buffers(w);
+    free(w);
+}
+
+// Snapshot the visible levels of tree and queue them for drawing.
+// rotation and found (may be NULL) are highlighted. Call from one thread;
+// returns the generation the resulting frame will carry.
+unsigned long render_submit(RenderWorker *w, const AVLTree *tree, const AVLNode *rotation, const AVLNode *found)
+{
+    w->scratch.count = 0;
+    copy_subtree(&w->scratch, tree->root, rotation, found, w->levels);
+    w->scratch.submit_ns = render_now_ns();
+
+    pthread_mutex_lock(&w->lock);
+    unsigned long generation = ++w->stats.submitted;
+    w->scratch.generation = generation;
+    swap_snapshots(&w->scratch, &w->pending);
+    if (w->pending_fresh)
+        w->stats.dropped_snapshots++;
+    w->pending_fresh = 1;
+    pthread_cond_signal(&w->wake);
+    pthread_mutex_unlock(&w->lock);
+    return generation;
+}
+
+// Newest finished frame, or NULL before the first one. The frame stays
+// valid until the next call from the same thread.
+const RenderFrame *render_acquire(RenderWorker *w)
+{
+    pthread_mutex_lock(&w->lock);
+    if (w->ready_fresh)
+    {
+        swap_frames(&w->ready, &w->front);
+        w->ready_fresh = 0;
+    }
+    pthread_mutex_unlock(&w->lock);
+    return w->front.generation ? &w->front : NULL;
+}
+
+// Block until every submitted snapshot has been drawn or dropped
+void render_wait_idle(RenderWorker *w)
+{
+    pthread_mutex_lock(&w->lock);
+    while (w->pending_fresh || w->busy)
+        pthread_cond_wait(&w->idle, &w->lock);
+    pthread_mutex_unlock(&w->lock);
+}
+
+void render_worker_stats(RenderWorker *w, RenderStats *out)
+{
+    pthread_mutex_lock(&w->lock);
+    *out = w->stats;
+    pthread_mutex_unlock(&w->lock);
+}
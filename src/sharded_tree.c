@@ -0,0 +1,469 @@
+#include "sharded_tree.h"
+#include "split_join.h"
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    AVLTree *tree;
+    int lo, hi;           // keys owned; lo > hi for a spare slot
+    size_t writes;        // since the last skew check
+    atomic_size_t size;   // tree->size, readable without the lock
+} Shard;
+
+struct ShardedTree
+{
+    Shard *shards; // max_shards slots, kept until destroy
+    size_t max_shards;
+    size_t target; // configured shard count, the unit of a fair share
+    BalanceEngine engine;
+    size_t pool_chunk;
+    int auto_rebalance;
+
+    // Boundary table: the i-th shard in key order is shards[slot[i]] and
+    // starts at lower[i]. Written only under rebalance_lock.
+    atomic_int *lower;
+    atomic_size_t *slot;
+    atomic_size_t active;
+
+    pthread_mutex_t rebalance_lock;
+    AVLTree *handoff; // empty pooled tree carrying a split's batches
+    unsigned long splits;
+    unsigned long merges;
+};
+
+// Each shard allocates from its own pool; the pools form one group, so
+// split and join can relink nodes between shards without copying them
+static AVLTree *new_shard_tree(ShardedTree *st)
+{
+    AVLTree *tree = create_tree(st->engine);
+    if (tree && !tree_use_pool(tree, st->pool_chunk))
+    {
+        destroy_tree(tree);
+        return NULL;
+    }
+    if (tree)
+        tree->arena->group = st;
+    return tree;
+}
+
+// Lock and return the shard owning key, retrying while the table moves
+static Shard *lock_shard(ShardedTree *st, int key)
+{
+    for (;;)
+    {
+        size_t lo = 0, hi = atomic_load(&st->active);
+        while (hi - lo > 1)
+        {
+            size_t mid = lo + (hi - lo) / 2;
+            if (atomic_load(&st->lower[mid]) <= key)
+                lo = mid;
+            else
+                hi = mid;
+        }
+
+        Shard *shard = &st->shards[atomic_load(&st->slot[lo])];
+        pthread_mutex_lock(&shard->lock);
+        if (shard->lo <= key && key <= shard->hi)
+            return shard;
+        pthread_mutex_unlock(&shard->lock);
+    }
+}
+
+static void publish_size(Shard *shard)
+{
+    atomic_store(&shard->size, shard->tree->size);
+}
+
+static size_t table_find_spare(ShardedTree *st)
+{
+    for (size_t s = 0; s < st->max_shards; s++)
+    {
+        if (st->shards[s].lo > st->shards[s].hi)
+            return s;
+    }
+    return st->max_shards;
+}
+
+// Lowest of the n largest keys >= floor in root, or floor if fewer
+// qualify: a reverse in-order walk over O(n + log size) nodes
+static int batch_cut(const AVLNode *root, int floor, size_t n)
+{
+    const AVLNode *stack[TREE_MAX_DEPTH];
+    int depth = 0;
+    const AVLNode *node = root;
+    int cut = floor;
+    while (n > 0 && (node != NULL || depth > 0))
+    {
+        while (node != NULL)
+        {
+            stack[depth++] = node;
+            node = node->right;
+        }
+        node = stack[--depth];
+        if (node->key < floor)
+            break;
+        cut = node->key;
+        n--;
+        node = node->left;
+    }
+    return n == 0 ? cut : floor;
+}
+
+// Split the i-th shard at its root key into a spare slot. Keys go over
+// from the top in batches of SHARD_MOVE_BATCH, each a split of the left
+// shard and a join onto the right one, and both locks are dropped between
+// batches so writers to either shard keep going.
+static int split_shard(ShardedTree *st, size_t i)
+{
+    size_t spare = table_find_spare(st);
+    if (spare == st->max_shards)
+        return 0;
+
+    Shard *left = &st->shards[atomic_load(&st->slot[i])];
+    Shard *right = &st->shards[spare];
+    pthread_mutex_lock(&left->lock);
+    AVLNode *root = left->tree->root;
+    int mid = root ? root->key : left->lo;
+    pthread_mutex_unlock(&left->lock);
+    if (mid <= left->lo)
+        return 0;
+
+    int opened = 0, cut;
+    do
+    {
+        pthread_mutex_lock(&left->lock);
+        pthread_mutex_lock(&right->lock);
+
+        // The batch collects in the spare handoff tree, takes the right
+        // shard's keys (all above it) and then becomes the right shard's
+        // tree; pools stay with their trees
+        cut = batch_cut(left->tree->root, mid, SHARD_MOVE_BATCH);
+        AVLTree *batch = st->handoff;
+        if (!tree_split(left->tree, cut, batch) || !tree_join(batch, right->tree))
+        {
+            tree_join(left->tree, batch);
+            pthread_mutex_unlock(&right->lock);
+            pthread_mutex_unlock(&left->lock);
+            break;
+        }
+        st->handoff = right->tree;
+        right->tree = batch;
+
+        right->lo = cut;
+        if (!opened)
+            right->hi = left->hi;
+        left->hi = cut - 1;
+        publish_size(left);
+        publish_size(right);
+
+        // A racing reader may route to the wrong shard while the table
+        // moves, but then fails the bounds check and retries
+        if (opened)
+        {
+            atomic_store(&st->lower[i + 1], cut);
+        }
+        else
+        {
+            // Open a table entry after i
+            size_t n = atomic_load(&st->active);
+            for (size_t j = n; j > i + 1; j--)
+            {
+                atomic_store(&st->lower[j], atomic_load(&st->lower[j - 1]));
+                atomic_store(&st->slot[j], atomic_load(&st->slot[j - 1]));
+            }
+            atomic_store(&st->lower[i + 1], cut);
+            atomic_store(&st->slot[i + 1], spare);
+            atomic_store(&st->active, n + 1);
+            st->splits++;
+            opened = 1;
+        }
+
+        pthread_mutex_unlock(&right->lock);
+        pthread_mutex_unlock(&left->lock);
+    } while (cut != mid);
+    return opened;
+}
+
+// Merge the (i+1)-th shard into the i-th and free its slot
+static int merge_shards(ShardedTree *st, size_t i)
+{
+    size_t n = atomic_load(&st->active);
+    Shard *left = &st->shards[atomic_load(&st->slot[i])];
+    Shard *right = &st->shards[atomic_load(&st->slot[i + 1])];
+    pthread_mutex_lock(&left->lock);
+    pthread_mutex_lock(&right->lock);
+
+    // The emptied tree keeps its pool: nodes the left shard now holds may
+    // live in its chunks
+    int ok = tree_join(left->tree, right->tree);
+    if (ok)
+    {
+        left->hi = right->hi;
+        right->lo = 1;
+        right->hi = 0;
+        publish_size(left);
+        publish_size(right);
+
+        for (size_t j = i + 1; j + 1 < n; j++)
+        {
+            atomic_store(&st->lower[j], atomic_load(&st->lower[j + 1]));
+            atomic_store(&st->slot[j], atomic_load(&st->slot[j + 1]));
+        }
+        atomic_store(&st->active, n - 1);
+        st->merges++;
+    }
+
+    pthread_mutex_unlock(&right->lock);
+    pthread_mutex_unlock(&left->lock);
+    return ok;
+}
+
+// One split or merge if some shard is out of proportion
+static int rebalance_once(ShardedTree *st)
+{
+    size_t n = atomic_load(&st->active);
+    size_t total = 0, largest = 0, pair = 0;
+    size_t largest_size = 0, pair_size = SIZE_MAX;
+    for (size_t i = 0; i < n; i++)
+    {
+        size_t size = atomic_load(&st->shards[atomic_load(&st->slot[i])].size);
+        total += size;
+        if (size > largest_size)
+        {
+            largest_size = size;
+            largest = i;
+        }
+        if (i + 1 < n)
+        {
+            size_t both = size + atomic_load(&st->shards[atomic_load(&st->slot[i + 1])].size);
+            if (both < pair_size)
+            {
+                pair_size = both;
+                pair = i;
+            }
+        }
+    }
+
+    // Shares are measured against the configured shard count rather than
+    // the current one, so a lone full shard still counts as oversized
+    size_t fair = total / st->target;
+    if (n > 1 && pair_size < fair / 2)
+        return merge_shards(st, pair);
+    if (largest_size > 2 * fair && largest_size >= SHARD_MIN_SPLIT && n < st->max_shards)
+        return split_shard(st, largest);
+    return 0;
+}
+
+int sharded_rebalance(ShardedTree *st)
+{
+    int changes = 0;
+    pthread_mutex_lock(&st->rebalance_lock);
+    for (size_t round = 0; round < 2 * st->max_shards && rebalance_once(st); round++)
+        changes++;
+    pthread_mutex_unlock(&st->rebalance_lock);
+    return changes;
+}
+
+// Run one pass unless another writer already is
+static void maybe_rebalance(ShardedTree *st)
+{
+    if (pthread_mutex_trylock(&st->rebalance_lock) != 0)
+        return;
+    rebalance_once(st);
+    pthread_mutex_unlock(&st->rebalance_lock);
+}
+
+// Bookkeeping after a write, with shard still locked; returns whether a
+// skew check is due
+static int after_write(ShardedTree *st, Shard *shard)
+{
+    publish_size(shard);
+    if (!st->auto_rebalance || ++shard->writes < SHARD_CHECK_INTERVAL)
+        return 0;
+    shard->writes = 0;
+    return 1;
+}
+
+ShardedTree *sharded_create(const ShardConfig *config)
+{
+    size_t shards = config->shards ? config->shards : 1;
+    size_t max_shards = config->max_shards ? config->max_shards : 4 * shards;
+    if (max_shards < shards)
+        max_shards = shards;
+
+    ShardedTree *st = (ShardedTree *)calloc(1, sizeof(ShardedTree));
+    if (st == NULL)
+        return NULL;
+    st->max_shards = max_shards;
+    st->target = shards;
+    st->engine = config->engine;
+    st->pool_chunk = config->pool_chunk ? config->pool_chunk : SHARD_POOL_CHUNK;
+    st->auto_rebalance = config->auto_rebalance;
+    st->shards = (Shard *)calloc(max_shards, sizeof(Shard));
+    st->lower = (atomic_int *)calloc(max_shards, sizeof(atomic_int));
+    st->slot = (atomic_size_t *)calloc(max_shards, sizeof(atomic_size_t));
+    if (st->shards == NULL || st->lower == NULL || st->slot == NULL)
+    {
+        free(st->shards);
+        free(st->lower);
+        free(st->slot);
+        free(st);
+        return NULL;
+    }
+    pthread_mutex_init(&st->rebalance_lock, NULL);
+
+    // Even cuts of the expected range; spare slots start empty
+    long long lo = config->key_lo, hi = config->key_hi;
+    if (hi < lo)
+        hi = lo;
+    long long step = (hi - lo + 1) / (long long)shards;
+    if (step < 1)
+        step = 1;
+
+    st->handoff = new_shard_tree(st);
+    int failed = st->handoff == NULL;
+    for (size_t s = 0; s < max_shards; s++)
+    {
+        Shard *shard = &st->shards[s];
+        pthread_mutex_init(&shard->lock, NULL);
+        atomic_init(&shard->size, 0);
+        shard->tree = new_shard_tree(st);
+        failed |= shard->tree == NULL;
+        shard->lo = 1;
+        shard->hi = 0;
+    }
+
+    size_t active = 0;
+    for (size_t s = 0; s < shards; s++)
+    {
+        long long start = s == 0 ? INT_MIN : lo + (long long)s * step;
+        if (start > INT_MAX || (s > 0 && start <= (long long)st->shards[s - 1].lo))
+            break;
+        st->shards[s].lo = (int)start;
+        if (s > 0)
+            st->shards[s - 1].hi = (int)start - 1;
+        atomic_init(&st->lower[s], (int)start);
+        atomic_init(&st->slot[s], s);
+        active++;
+    }
+    st->shards[active - 1].hi = INT_MAX;
+    atomic_init(&st->active, active);
+
+    if (failed)
+    {
+        sharded_destroy(st);
+        return NULL;
+    }
+    return st;
+}
+
+void sharded_destroy(ShardedTree *st)
+{
+    if (st == NULL)
+        return;
+
+    for (size_t s = 0; s < st->max_shards; s++)
+    {
+        destroy_tree(st->shards[s].tree);
+        pthread_mutex_destroy(&st->shards[s].lock);
+    }
+    destroy_tree(st->handoff);
+    pthread_mutex_destroy(&st->rebalance_lock);
+    free(st->shards);
+    free(st->lower);
+    free(st->slot);
+    free(st);
+}
+
+int sharded_insert(ShardedTree *st, int key)
+{
+    Shard *shard = lock_shard(st, key);
+    int inserted = tree_insert(shard->tree, key);
+    int check = inserted && after_write(st, shard);
+    pthread_mutex_unlock(&shard->lock);
+
+    if (check)
+        maybe_rebalance(st);
+    return inserted;
+}
+
+int sharded_delete(ShardedTree *st, int key)
+{
+    Shard *shard = lock_shard(st, key);
+    int removed = tree_delete(shard->tree, key);
+    int check = removed && after_write(st, shard);
+    pthread_mutex_unlock(&shard->lock);
+
+    if (check)
+        maybe_rebalance(st);
+    return removed;
+}
+
+int sharded_contains(ShardedTree *st, int key)
+{
+    Shard *shard = lock_shard(st, key);
+    int found = tree_search(shard->tree, key) != NULL;
+    pthread_mutex_unlock(&shard->lock);
+    return found;
+}
+
+size_t sharded_range(ShardedTree *st, int lo, int hi, int *out, size_t max)
+{
+    size_t n = 0;
+    int key = lo;
+    while (lo <= hi && n < max)
+    {
+        // Shards are disjoint and visited in key order, so their runs
+        // concatenate into one sorted result
+        Shard *shard = lock_shard(st, key);
+        int end = shard->hi < hi ? shard->hi : hi;
+        TreeIterator it;
+        AVLNode *node;
+        tree_iter_seek(&it, shard->tree, key);
+        while (n < max && (node = tree_iter_next(&it)) != NULL && node->key <= end)
+            out[n++] = node->key;
+        int last = shard->hi;
+        pthread_mutex_unlock(&shard->lock);
+
+        if (last >= hi)
+            break;
+        key = last + 1;
+    }
+    return n;
+}
+
+size_t sharded_size(ShardedTree *st)
+{
+    size_t total = 0;
+    for (size_t s = 0; s < st->max_shards; s++)
+        total += atomic_load(&st->shards[s].size);
+    return total;
+}
+
+size_t sharded_layout(ShardedTree *st, int *lower, size_t *sizes, size_t max)
+{
+    pthread_mutex_lock(&st->rebalance_lock);
+    size_t n = atomic_load(&st->active);
+    for (size_t i = 0; i < n && i < max; i++)
+    {
+        if (lower)
+            lower[i] = atomic_load(&st->lower[i]);
+        if (sizes)
+            sizes[i] = atomic_load(&st->shards[atomic_load(&st->slot[i])].size);
+    }
+    pthread_mutex_unlock(&st->rebalance_lock);
+    return n;
+}
+
+void sharded_counts(ShardedTree *st, unsigned long *splits, unsigned long *merges)
+{
+    pthread_mutex_lock(&st->rebalance_lock);
+    *splits = st->splits;
+    *merges = st->merges;
+    pthread_mutex_unlock(&st->rebalance_lock);
+}
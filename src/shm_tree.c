@@ -0,0 +1,380 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "shm_tree.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SHM_MAGIC 0x4C564153u // "SAVL"
+#define SHM_NODE_ALIGN 64
+
+// Start of the segment; the node arena follows at nodes_offset
+typedef struct
+{
+    uint32_t magic;
+    uint32_t node_size;     // sizeof(AVLNode) in the writer's build
+    size_t bytes;           // segment length
+    size_t nodes_offset;
+    uintptr_t base;         // writer's address of the segment; links are offsets from it
+    atomic_ulong sequence;  // seqlock, odd while the writer is mid-update
+    AVLTree tree;
+    NodeArena arena;
+} ShmHeader;
+
+struct ShmTree
+{
+    ShmHeader *header;
+    size_t bytes;
+    size_t nodes_offset;
+    size_t capacity;
+    uintptr_t base;
+    int writable;
+    unsigned long retries; // reads repeated because a write overlapped them
+};
+
+static size_t nodes_offset(void)
+{
+    return (sizeof(ShmHeader) + SHM_NODE_ALIGN - 1) & ~(size_t)(SHM_NODE_ALIGN - 1);
+}
+
+// Create (replacing any old segment of the same name) and map read-write.
+// Readers cannot attach until shm_tree_publish.
+ShmTree *shm_tree_create(const char *name, size_t max_nodes, BalanceEngine engine)
+{
+    size_t offset = nodes_offset();
+    if (max_nodes == 0 || max_nodes > (SIZE_MAX - offset) / sizeof(AVLNode))
+        return NULL;
+    size_t bytes = offset + max_nodes * sizeof(AVLNode);
+
+    ShmTree *shm = (ShmTree *)calloc(1, sizeof(ShmTree));
+    if (shm == NULL)
+        return NULL;
+
+    // Readers of an old segment keep their mapping; new readers see this one
+    shm_unlink(name);
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0)
+    {
+        free(shm);
+        return NULL;
+    }
+    void *map = MAP_FAILED;
+    if (ftruncate(fd, (off_t)bytes) == 0)
+        map = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        shm_unlink(name);
+        free(shm);
+        return NULL;
+    }
+
+    ShmHeader *header = (ShmHeader *)map;
+    header->node_size = sizeof(AVLNode);
+    header->bytes = bytes;
+    header->nodes_offset = offset;
+    header->base = (uintptr_t)map;
+    atomic_init(&header->sequence, 0);
+    init_tree(&header->tree, engine);
+    arena_init(&header->arena, (char *)map + offset, bytes - offset);
+    tree_attach_arena(&header->tree, &header->arena);
+
+    shm->header = header;
+    shm->bytes = bytes;
+    shm->nodes_offset = offset;
+    shm->capacity = max_nodes;
+    shm->base = header->base;
+    shm->writable = 1;
+    return shm;
+}
+
+// The shared tree itself; writer only. Mutate it between
+// shm_write_begin and shm_write_end.
+AVLTree *shm_tree_handle(ShmTree *shm)
+{
+    return shm->writable ? &shm->header->tree : NULL;
+}
+
+// Let readers attach; the tree built so far is what they first see
+void shm_tree_publish(ShmTree *shm)
+{
+    atomic_thread_fence(memory_order_release);
+    shm->header->magic = SHM_MAGIC;
+}
+
+void shm_write_begin(ShmTree *shm)
+{
+    atomic_ulong *seq = &shm->header->sequence;
+    atomic_store_explicit(seq, atomic_load_explicit(seq, memory_order_relaxed) + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+void shm_write_end(ShmTree *shm)
+{
+    atomic_ulong *seq = &shm->header->sequence;
+    atomic_store_explicit(seq, atomic_load_explicit(seq, memory_order_relaxed) + 1, memory_order_release);
+}
+
+int shm_tree_insert(ShmTree *shm, int key)
+{
+    shm_write_begin(shm);
+    int added = tree_insert(&shm->header->tree, key);
+    shm_write_end(shm);
+    return added;
+}
+
+int shm_tree_delete(ShmTree *shm, int key)
+{
+    shm_write_begin(shm);
+    int removed = tree_delete(&shm->header->tree, key);
+    shm_write_end(shm);
+    return removed;
+}
+
+// Map an existing segment read-only
+ShmTree *shm_tree_attach(const char *name)
+{
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+        return NULL;
+
+    struct stat st;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= nodes_offset())
+        map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return NULL;
+
+    const ShmHeader *header = (const ShmHeader *)map;
+    ShmTree *shm = (ShmTree *)calloc(1, sizeof(ShmTree));
+    if (shm == NULL || header->magic != SHM_MAGIC || header->node_size != sizeof(AVLNode) ||
+        header->bytes != (size_t)st.st_size || header->nodes_offset != nodes_offset())
+    {
+        free(shm);
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+    atomic_thread_fence(memory_order_acquire);
+
+    shm->header = (ShmHeader *)map;
+    shm->bytes = header->bytes;
+    shm->nodes_offset = header->nodes_offset;
+    shm->capacity = (header->bytes - header->nodes_offset) / sizeof(AVLNode);
+    shm->base = header->base;
+    return shm;
+}
+
+void shm_tree_detach(ShmTree *shm)
+{
+    if (shm == NULL)
+        return;
+    munmap(shm->header, shm->bytes);
+    free(shm);
+}
+
+int shm_tree_unlink(const char *name)
+{
+    return shm_unlink(name) == 0;
+}
+
+// ---- Reader side ----
+
+static long elapsed_ms(const struct timespec *since)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long)(now.tv_sec - since->tv_sec) * 1000 + (now.tv_nsec - since->tv_nsec) / 1000000;
+}
+
+// Wait out an update in progress and store the even sequence. Returns 0 if
+// the sequence stays odd for SHM_READ_TIMEOUT_MS.
+static int read_begin(const ShmHeader *header, unsigned long *seq)
+{
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (unsigned spins = 1;; spins++)
+    {
+        *seq = atomic_load_explicit(&header->sequence, memory_order_acquire);
+        if (!(*seq & 1))
+            return 1;
+        // The clock is read only every so often
+        if (spins % 64 == 0 && elapsed_ms(&start) >= SHM_READ_TIMEOUT_MS)
+            return 0;
+        sched_yield();
+    }
+}
+
+// Returns 1 (and counts a retry) if a write overlapped the read
+static int read_retry(ShmTree *shm, unsigned long seq)
+{
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&shm->header->sequence, memory_order_relaxed) == seq)
+        return 0;
+    shm->retries++;
+    return 1;
+}
+
+// Translate a writer-space link into this mapping. Returns 0 for a link
+// that cannot be a node, which only happens mid-update.
+static int resolve(const ShmTree *shm, const AVLNode *link, const AVLNode **out)
+{
+    if (link == NULL)
+    {
+        *out = NULL;
+        return 1;
+    }
+    uintptr_t offset = (uintptr_t)link - shm->base;
+    if (offset < shm->nodes_offset || offset > shm->bytes - sizeof(AVLNode) ||
+        (offset - shm->nodes_offset) % sizeof(AVLNode) != 0)
+        return 0;
+    *out = (const AVLNode *)((const char *)shm->header + offset);
+    return 1;
+}
+
+// Node fields are read without atomics while the writer may be changing
+// them; anything read during an overlapping write is discarded by the retry.
+
+// 1 if key is live in the shared tree, -1 if the read timed out
+int shm_tree_search(ShmTree *shm, int key)
+{
+    for (;;)
+    {
+        unsigned long seq;
+        if (!read_begin(shm->header, &seq))
+            return -1;
+        const AVLNode *node;
+        int found = 0;
+        int ok = resolve(shm, shm->header->tree.root, &node);
+        for (int steps = 0; ok && node != NULL && steps < TREE_MAX_DEPTH; steps++)
+        {
+            int node_key = node->key;
+            if (key == node_key)
+            {
+                found = !(node->flags & NODE_TOMBSTONE);
+                break;
+            }
+            ok = resolve(shm, key < node_key ? node->left : node->right, &node);
+        }
+        if (!read_retry(shm, seq))
+            return ok && found;
+    }
+}
+
+// Copy live keys in [lo, hi] with their depth, in key order, skipping
+// nodes deeper than max_depth (negative for no limit). Stops after cap
+// entries; returns the number written, or SHM_READ_FAILED.
+size_t shm_tree_collect(ShmTree *shm, int lo, int hi, int max_depth, ShmEntry *out, size_t cap)
+{
+    if (max_depth < 0)
+        max_depth = INT_MAX;
+
+    for (;;)
+    {
+        unsigned long seq;
+        if (!read_begin(shm->header, &seq))
+            return SHM_READ_FAILED;
+        const AVLNode *stack[TREE_MAX_DEPTH];
+        int depths[TREE_MAX_DEPTH];
+        int top = 0;
+        int depth = 0;
+        size_t n = 0;
+        size_t steps = 0;
+        const AVLNode *node;
+        int ok = resolve(shm, shm->header->tree.root, &node);
+
+        while (ok && n < cap && (node != NULL || top > 0))
+        {
+            // A torn structure can contain cycles; a consistent one visits
+            // each node at most once
+            if (++steps > 2 * shm->capacity + 2)
+            {
+                ok = 0;
+                break;
+            }
+            if (node != NULL)
+            {
+                if (depth > max_depth)
+                {
+                    node = NULL;
+                }
+                else if (node->key < lo)
+                {
+                    ok = resolve(shm, node->right, &node);
+                    depth++;
+                }
+                else if (top == TREE_MAX_DEPTH)
+                {
+                    ok = 0;
+                }
+                else
+                {
+                    stack[top] = node;
+                    depths[top++] = depth;
+                    ok = resolve(shm, node->left, &node);
+                    depth++;
+                }
+                continue;
+            }
+
+            node = stack[--top];
+            depth = depths[top];
+            int key = node->key;
+            if (key > hi)
+                break;
+            if (!(node->flags & NODE_TOMBSTONE))
+            {
+                out[n].key = key;
+                out[n].depth = depth;
+                n++;
+            }
+            ok = resolve(shm, node->right, &node);
+            depth++;
+        }
+
+        // A bad link that no write overlapped means a malformed segment
+        if (!read_retry(shm, seq))
+            return ok ? n : 0;
+    }
+}
+
+// Live keys at a consistent point, or SHM_READ_FAILED
+size_t shm_tree_size(ShmTree *shm)
+{
+    for (;;)
+    {
+        unsigned long seq;
+        if (!read_begin(shm->header, &seq))
+            return SHM_READ_FAILED;
+        size_t size = shm->header->tree.size;
+        if (!read_retry(shm, seq))
+            return size;
+    }
+}
+
+// Completed writes so far; changes whenever the tree may have changed
+unsigned long shm_tree_generation(const ShmTree *shm)
+{
+    return atomic_load_explicit(&shm->header->sequence, memory_order_acquire) / 2;
+}
+
+unsigned long shm_tree_retries(const ShmTree *shm)
+{
+    return shm->retries;
+}
+
+size_t shm_tree_capacity(const ShmTree *shm)
+{
+    return shm->capacity;
+}
+
+BalanceEngine shm_tree_engine(const ShmTree *shm)
+{
+    return shm->header->tree.engine;
+}
@@ -0,0 +1,255 @@
+#include "split_join.h"
+
+#include <limits.h>
+
+// Join with mid between them when left is the taller side: descend left's
+// right spine to a subtree no more than one level above right, hang mid
+// there and repair each ancestor as if mid had been inserted below it
+static AVLNode *join_right(AVLTree *tree, AVLNode *left, AVLNode *mid, AVLNode *right)
+{
+    if (height(left) <= height(right) + 1)
+    {
+        mid->left = left;
+        mid->right = right;
+        update_height(mid);
+        return mid;
+    }
+
+    left->right = join_right(tree, left->right, mid, right);
+    return rebalance_after_insert(tree, left, 0);
+}
+
+static AVLNode *join_left(AVLTree *tree, AVLNode *left, AVLNode *mid, AVLNode *right)
+{
+    if (height(right) <= height(left) + 1)
+    {
+        mid->left = left;
+        mid->right = right;
+        update_height(mid);
+        return mid;
+    }
+
+    right->left = join_left(tree, left, mid, right->left);
+    return rebalance_after_insert(tree, right, 1);
+}
+
+// Balanced tree of left, mid, right (all keys in that order). Costs
+// O(|height(left) - height(right)|).
+static AVLNode *join_nodes(AVLTree *tree, AVLNode *left, AVLNode *mid, AVLNode *right)
+{
+    if (height(left) > height(right) + 1)
+        return join_right(tree, left, mid, right);
+    if (height(right) > height(left) + 1)
+        return join_left(tree, left, mid, right);
+
+    mid->left = left;
+    mid->right = right;
+    update_height(mid);
+    return mid;
+}
+
+// Split root into keys < key (returned) and keys >= key (*upper). Each
+// level joins the subtree it keeps onto the pieces from below; the join
+// costs telescope to O(log n).
+static AVLNode *split_node(AVLTree *tree, AVLNode *root, int key, AVLNode **upper)
+{
+    if (root == NULL)
+    {
+        *upper = NULL;
+        return NULL;
+    }
+
+    if (key <= root->key)
+    {
+        AVLNode *mid_upper;
+        AVLNode *lower = split_node(tree, root->left, key, &mid_upper);
+        *upper = join_nodes(tree, mid_upper, root, root->right);
+        return lower;
+    }
+
+    AVLNode *mid_lower = split_node(tree, root->right, key, upper);
+    return join_nodes(tree, root->left, root, mid_lower);
+}
+
+// Join without a middle key: the maximum of left is split off to serve
+static AVLNode *join_trees(AVLTree *tree, AVLNode *left, AVLNode *right)
+{
+    if (left == NULL)
+        return right;
+    if (right == NULL)
+        return left;
+
+    AVLNode *max = left;
+    while (max->right != NULL)
+        max = max->right;
+
+    AVLNode *mid;
+    left = split_node(tree, left, max->key, &mid);
+    return join_nodes(tree, left, mid, right);
+}
+
+// Unlink the keys in [lo, hi] and return them as one subtree
+static AVLNode *cut_range(AVLTree *tree, int lo, int hi)
+{
+    AVLNode *upper, *rest = NULL;
+    AVLNode *lower = split_node(tree, tree->root, lo, &upper);
+
+    AVLNode *mid = upper;
+    if (hi < INT_MAX)
+        mid = split_node(tree, upper, hi + 1, &rest);
+
+    tree->root = join_trees(tree, lower, rest);
+    tree->version++;
+    return mid;
+}
+
+// Let dst take nodes from src (see the header for the allocator rules)
+static int share_allocator(AVLTree *dst, const AVLTree *src)
+{
+    if (dst->engine != src->engine)
+        return 0;
+    if (dst->arena == src->arena)
+        return 1;
+    if (dst->arena && src->arena && dst->arena->group && dst->arena->group == src->arena->group)
+        return 1;
+    if (dst->root == NULL && dst->arena == NULL)
+    {
+        // Borrowed, not attached: its capacity stays charged to src
+        dst->arena = src->arena;
+        if (src->arena->chunk_nodes)
+            src->arena->borrowers++;
+        return 1;
+    }
+    return 0;
+}
+
+// Pre-order step of a walk with an explicit stack; NULL when done
+static AVLNode *walk_next(AVLNode **stack, int *depth)
+{
+    if (*depth == 0)
+        return NULL;
+
+    AVLNode *node = stack[--*depth];
+    if (node->right)
+        stack[(*depth)++] = node->right;
+    if (node->left)
+        stack[(*depth)++] = node->left;
+    return node;
+}
+
+// Whether a has no more nodes than b, in O(min(|a|, |b|)) steps
+static int not_larger(AVLNode *a, AVLNode *b)
+{
+    AVLNode *stack_a[TREE_MAX_DEPTH + 1], *stack_b[TREE_MAX_DEPTH + 1];
+    int depth_a = 0, depth_b = 0;
+    if (a)
+        stack_a[depth_a++] = a;
+    if (b)
+        stack_b[depth_b++] = b;
+
+    while (walk_next(stack_a, &depth_a))
+    {
+        if (walk_next(stack_b, &depth_b) == NULL)
+            return 0;
+    }
+    return 1;
+}
+
+int tree_split(AVLTree *tree, int key, AVLTree *right)
+{
+    if (right->root != NULL || !share_allocator(right, tree))
+        return 0;
+
+    AVLNode *upper;
+    AVLNode *lower = split_node(tree, tree->root, key, &upper);
+
+    // Only the smaller side is walked to move its accounting: either the
+    // upper part moves, or everything moves at once and the lower part
+    // comes back
+    if (not_larger(upper, lower))
+    {
+        tree->root = lower;
+        right->root = upper;
+        tree_adopt_nodes(right, tree, upper);
+    }
+    else
+    {
+        tree->root = upper;
+        tree_adopt_nodes(right, tree, upper);
+        right->root = upper;
+        tree->root = lower;
+        tree_adopt_nodes(tree, right, lower);
+    }
+    return 1;
+}
+
+int tree_join(AVLTree *left, AVLTree *right)
+{
+    if (right->root == NULL)
+        return 1;
+    if (!share_allocator(left, right))
+        return 0;
+
+    if (left->root != NULL)
+    {
+        AVLNode *max = left->root;
+        while (max->right != NULL)
+            max = max->right;
+        if (max->key >= find_min(right->root)->key)
+            return 0;
+    }
+
+    AVLNode *root = right->root;
+    tree_adopt_nodes(left, right, root);
+    right->root = NULL;
+    left->root = join_trees(left, left->root, root);
+    return 1;
+}
+
+AVLTree *tree_extract_range(AVLTree *tree, int lo, int hi)
+{
+    AVLTree *out = create_tree(tree->engine);
+    if (out == NULL)
+        return NULL;
+    if (!share_allocator(out, tree))
+    {
+        destroy_tree(out);
+        return NULL;
+    }
+    out->lazy_delete = tree->lazy_delete;
+    out->max_tombstone_ratio = tree->max_tombstone_ratio;
+
+    if (lo <= hi)
+    {
+        out->root = cut_range(tree, lo, hi);
+        tree_adopt_nodes(out, tree, out->root);
+    }
+    return out;
+}
+
+// Free a detached subtree, counting live keys and tombstones
+static void release_counted(AVLTree *tree, AVLNode *node, size_t *live, size_t *dead)
+{
+    if (node == NULL)
+        return;
+
+    release_counted(tree, node->left, live, dead);
+    release_counted(tree, node->right, live, dead);
+    if (node->flags & NODE_TOMBSTONE)
+        (*dead)++;
+    else
+        (*live)++;
+    tree_free_node(tree, node);
+}
+
+size_t tree_delete_range(AVLTree *tree, int lo, int hi)
+{
+    if (lo > hi)
+        return 0;
+
+    size_t live = 0, dead = 0;
+    release_counted(tree, cut_range(tree, lo, hi), &live, &dead);
+    tree->size -= live;
+    tree->tombstones -= dead;
+    return live;
+}
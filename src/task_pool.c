@@ -0,0 +1,294 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#include <unistd.h>
+#else
+#include <windows.h>
+#endif
+
+#include "task_pool.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+
+// Tasks per worker deque; spawns beyond this run inline
+#define DEQUE_CAPACITY 1024
+
+typedef struct
+{
+    TaskFn fn;
+    void *arg;
+    TaskGroup *group;
+} Task;
+
+// Ring buffer deque: owner uses the bottom, thieves take from the top
+typedef struct
+{
+    pthread_mutex_t lock;
+    Task tasks[DEQUE_CAPACITY];
+    size_t top;
+    size_t bottom;
+} TaskDeque;
+
+struct TaskPool
+{
+    int threads;
+    TaskDeque *deques; // deque 0 belongs to the driving (external) thread
+    pthread_t *workers;
+    pthread_mutex_t idle_lock;
+    pthread_cond_t idle_cond;
+    atomic_long queued;
+    atomic_int sleeping;
+    atomic_int shutdown;
+};
+
+// Which pool/deque the current thread works on
+static _Thread_local TaskPool *t_pool = NULL;
+static _Thread_local int t_index = 0;
+
+// Number of online CPUs (at least 1)
+int cpu_count(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+static int deque_push(TaskDeque *dq, Task task)
+{
+    int pushed = 0;
+    pthread_mutex_lock(&dq->lock);
+    if (dq->bottom - dq->top < DEQUE_CAPACITY)
+    {
+        dq->tasks[dq->bottom % DEQUE_CAPACITY] = task;
+        dq->bottom++;
+        pushed = 1;
+    }
+    pthread_mutex_unlock(&dq->lock);
+    return pushed;
+}
+
+static int deque_pop(TaskDeque *dq, Task *out)
+{
+    int popped = 0;
+    pthread_mutex_lock(&dq->lock);
+    if (dq->bottom > dq->top)
+    {
+        dq->bottom--;
+        *out = dq->tasks[dq->bottom % DEQUE_CAPACITY];
+        popped = 1;
+    }
+    pthread_mutex_unlock(&dq->lock);
+    return popped;
+}
+
+static int deque_steal(TaskDeque *dq, Task *out)
+{
+    int stolen = 0;
+    pthread_mutex_lock(&dq->lock);
+    if (dq->bottom > dq->top)
+    {
+        *out = dq->tasks[dq->top % DEQUE_CAPACITY];
+        dq->top++;
+        stolen = 1;
+    }
+    pthread_mutex_unlock(&dq->lock);
+    return stolen;
+}
+
+static void run_task(Task *task)
+{
+    task->fn(task->arg);
+    atomic_fetch_sub(&task->group->pending, 1);
+}
+
+// Pop local work first, then try every other deque once
+static int find_task(TaskPool *pool, int self, Task *out)
+{
+    if (atomic_load(&pool->queued) == 0)
+        return 0;
+
+    if (deque_pop(&pool->deques[self], out))
+    {
+        atomic_fetch_sub(&pool->queued, 1);
+        return 1;
+    }
+
+    for (int i = 1; i < pool->threads; i++)
+    {
+        int victim = (self + i) % pool->threads;
+        if (deque_steal(&pool->deques[victim], out))
+        {
+            atomic_fetch_sub(&pool->queued, 1);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+typedef struct
+{
+    TaskPool *pool;
+    int index;
+} WorkerArg;
+
+static void *worker_main(void *arg)
+{
+    WorkerArg *wa = (WorkerArg *)arg;
+    TaskPool *pool = wa->pool;
+    t_pool = pool;
+    t_index = wa->index;
+    free(wa);
+
+    while (!atomic_load(&pool->shutdown))
+    {
+        Task task;
+        if (find_task(pool, t_index, &task))
+        {
+            run_task(&task);
+            continue;
+        }
+
+        // Sleep until something is queued or the pool shuts down
+        pthread_mutex_lock(&pool->idle_lock);
+        atomic_fetch_add(&pool->sleeping, 1);
+        while (atomic_load(&pool->queued) == 0 && !atomic_load(&pool->shutdown))
+            pthread_cond_wait(&pool->idle_cond, &pool->idle_lock);
+        atomic_fetch_sub(&pool->sleeping, 1);
+        pthread_mutex_unlock(&pool->idle_lock);
+    }
+    return NULL;
+}
+
+// Create a pool; threads <= 0 uses one thread per CPU (caller included)
+TaskPool *create_task_pool(int threads)
+{
+    if (threads <= 0)
+        threads = cpu_count();
+
+    TaskPool *pool = (TaskPool *)calloc(1, sizeof(TaskPool));
+    if (pool == NULL)
+        return NULL;
+
+    pool->threads = threads;
+    pool->deques = (TaskDeque *)calloc((size_t)threads, sizeof(TaskDeque));
+    pool->workers = (pthread_t *)calloc((size_t)threads, sizeof(pthread_t));
+    if (pool->deques == NULL || pool->workers == NULL)
+    {
+        free(pool->deques);
+        free(pool->workers);
+        free(pool);
+        return NULL;
+    }
+
+    for (int i = 0; i < threads; i++)
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+    pthread_mutex_init(&pool->idle_lock, NULL);
+    pthread_cond_init(&pool->idle_cond, NULL);
+    atomic_init(&pool->queued, 0);
+    atomic_init(&pool->sleeping, 0);
+    atomic_init(&pool->shutdown, 0);
+
+    // Deque 0 is driven by the caller, so start threads - 1 workers
+    for (int i = 1; i < threads; i++)
+    {
+        WorkerArg *wa = (WorkerArg *)malloc(sizeof(WorkerArg));
+        if (wa != NULL)
+        {
+            wa->pool = pool;
+            wa->index = i;
+        }
+        if (wa == NULL || pthread_create(&pool->workers[i], NULL, worker_main, wa) != 0)
+        {
+            free(wa);
+            pool->threads = i;
+            break;
+        }
+    }
+    return pool;
+}
+
+// Stop the workers and release the pool
+void destroy_task_pool(TaskPool *pool)
+{
+    if (pool == NULL)
+        return;
+
+    pthread_mutex_lock(&pool->idle_lock);
+    atomic_store(&pool->shutdown, 1);
+    pthread_cond_broadcast(&pool->idle_cond);
+    pthread_mutex_unlock(&pool->idle_lock);
+
+    for (int i = 1; i < pool->threads; i++)
+        pthread_join(pool->workers[i], NULL);
+
+    for (int i = 0; i < pool->threads; i++)
+        pthread_mutex_destroy(&pool->deques[i].lock);
+    pthread_mutex_destroy(&pool->idle_lock);
+    pthread_cond_destroy(&pool->idle_cond);
+    free(pool->deques);
+    free(pool->workers);
+    free(pool);
+}
+
+int task_pool_threads(const TaskPool *pool)
+{
+    return pool ? pool->threads : 1;
+}
+
+void task_group_init(TaskGroup *group)
+{
+    atomic_init(&group->pending, 0);
+}
+
+// Queue fn(arg) on the current thread's deque (runs inline if it is full)
+void task_spawn(TaskPool *pool, TaskGroup *group, TaskFn fn, void *arg)
+{
+    if (t_pool != pool)
+    {
+        t_pool = pool;
+        t_index = 0;
+    }
+
+    Task task = {fn, arg, group};
+    atomic_fetch_add(&group->pending, 1);
+
+    if (!deque_push(&pool->deques[t_index], task))
+    {
+        run_task(&task);
+        return;
+    }
+
+    // Only take the idle lock when a worker is actually asleep
+    atomic_fetch_add(&pool->queued, 1);
+    if (atomic_load(&pool->sleeping) > 0)
+    {
+        pthread_mutex_lock(&pool->idle_lock);
+        pthread_cond_signal(&pool->idle_cond);
+        pthread_mutex_unlock(&pool->idle_lock);
+    }
+}
+
+// Run queued tasks until every task in the group has finished
+void task_group_wait(TaskPool *pool, TaskGroup *group)
+{
+    if (t_pool != pool)
+    {
+        t_pool = pool;
+        t_index = 0;
+    }
+
+    while (atomic_load(&group->pending) > 0)
+    {
+        Task task;
+        if (find_task(pool, t_index, &task))
+            run_task(&task);
+        else
+            sched_yield();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,355 @@
+#include "wavl_tree.h"
+#include "key_index.h"
+
+// Stored rank (rank + 1), kept local so the hot path inlines
+static inline int stored_rank(AVLNode *node)
+{
+    return node ? node->height : 0;
+}
+
+// Rank difference between a parent and its child (missing child has rank -1)
+static inline int rank_diff(AVLNode *parent, AVLNode *child)
+{
+    return stored_rank(parent) - stored_rank(child);
+}
+
+// Refresh the displayed balance factor from the children's ranks, and the
+// subtree aggregate; every retrace step passes through here
+static void refresh_balance(AVLNode *node)
+{
+    node->balance_factor = stored_rank(node->left) - stored_rank(node->right);
+    update_aggregate(node);
+}
+
+// Promote or demote a node, counting the rank change
+static void change_rank(AVLTree *tree, AVLNode *node, int delta)
+{
+    node->height += delta;
+    if (tree)
+        tree->stats.height_changes++;
+}
+
+// Count one ancestor re-checked on the way back up
+static void count_retrace(AVLTree *tree)
+{
+    if (tree)
+        tree->stats.retrace_steps++;
+}
+
+// Rotations only relink; callers adjust ranks explicitly
+static AVLNode *wavl_rotate_right(AVLTree *tree, AVLNode *y)
+{
+    AVLNode *x = y->left;
+    y->left = x->right;
+    x->right = y;
+
+    if (tree)
+        tree->stats.rotations++;
+    return x;
+}
+
+static AVLNode *wavl_rotate_left(AVLTree *tree, AVLNode *x)
+{
+    AVLNode *y = x->right;
+    x->right = y->left;
+    y->left = x;
+
+    if (tree)
+        tree->stats.rotations++;
+    return y;
+}
+
+// Fix a 0-child on the left after insertion
+static AVLNode *insert_fix_left(AVLTree *tree, AVLNode *p)
+{
+    count_retrace(tree);
+
+    AVLNode *x = p->left;
+
+    if (rank_diff(p, x) != 0)
+    {
+        refresh_balance(p);
+        return p;
+    }
+
+    // Sibling is a 1-child: promote and let the parent check again
+    if (rank_diff(p, p->right) == 1)
+    {
+        change_rank(tree, p, 1);
+        refresh_balance(p);
+        return p;
+    }
+
+    // Sibling is a 2-child: one or two rotations finish the insert
+    AVLNode *y = x->right;
+    if (rank_diff(x, y) == 2)
+    {
+        AVLNode *root = wavl_rotate_right(tree, p);
+        change_rank(tree, p, -1);
+        refresh_balance(p);
+        refresh_balance(root);
+        record_rotation(tree, ROTATION_LL, root);
+        return root;
+    }
+
+    p->left = wavl_rotate_left(tree, x);
+    AVLNode *root = wavl_rotate_right(tree, p);
+    change_rank(tree, y, 1);
+    change_rank(tree, x, -1);
+    change_rank(tree, p, -1);
+    refresh_balance(x);
+    refresh_balance(p);
+    refresh_balance(y);
+    record_rotation(tree, ROTATION_LR, root);
+    return root;
+}
+
+// Mirror of insert_fix_left
+static AVLNode *insert_fix_right(AVLTree *tree, AVLNode *p)
+{
+    count_retrace(tree);
+
+    AVLNode *x = p->right;
+
+    if (rank_diff(p, x) != 0)
+    {
+        refresh_balance(p);
+        return p;
+    }
+
+    if (rank_diff(p, p->left) == 1)
+    {
+        change_rank(tree, p, 1);
+        refresh_balance(p);
+        return p;
+    }
+
+    AVLNode *y = x->left;
+    if (rank_diff(x, y) == 2)
+    {
+        AVLNode *root = wavl_rotate_left(tree, p);
+        change_rank(tree, p, -1);
+        refresh_balance(p);
+        refresh_balance(root);
+        record_rotation(tree, ROTATION_RR, root);
+        return root;
+    }
+
+    p->right = wavl_rotate_right(tree, x);
+    AVLNode *root = wavl_rotate_left(tree, p);
+    change_rank(tree, y, 1);
+    change_rank(tree, x, -1);
+    change_rank(tree, p, -1);
+    refresh_balance(x);
+    refresh_balance(p);
+    refresh_balance(y);
+    record_rotation(tree, ROTATION_RL, root);
+    return root;
+}
+
+// Retrace step for callers that walk the path themselves
+AVLNode *wavl_insert_fix(AVLTree *tree, AVLNode *p, int from_left)
+{
+    return from_left ? insert_fix_left(tree, p) : insert_fix_right(tree, p);
+}
+
+// Insert a node
+AVLNode *wavl_insert_node(AVLTree *tree, AVLNode *root, int key)
+{
+    if (root == NULL)
+    {
+        AVLNode *node = tree_new_node(tree, key);
+        if (node && tree)
+            tree->size++;
+        return node;
+    }
+
+    if (key < root->key)
+    {
+        root->left = wavl_insert_node(tree, root->left, key);
+        return insert_fix_left(tree, root);
+    }
+    else if (key > root->key)
+    {
+        root->right = wavl_insert_node(tree, root->right, key);
+        return insert_fix_right(tree, root);
+    }
+
+    // Duplicate keys not allowed
+    return root;
+}
+
+// Fix a 2,2 leaf or a 3-child on the left after deletion
+static AVLNode *delete_fix_left(AVLTree *tree, AVLNode *p)
+{
+    count_retrace(tree);
+
+    // A leaf must have rank 0
+    if (p->left == NULL && p->right == NULL)
+    {
+        if (p->height != 1)
+            change_rank(tree, p, 1 - p->height);
+        refresh_balance(p);
+        return p;
+    }
+
+    if (rank_diff(p, p->left) != 3)
+    {
+        refresh_balance(p);
+        return p;
+    }
+
+    AVLNode *y = p->right;
+
+    // Sibling is a 2-child: demote and let the parent check again
+    if (rank_diff(p, y) == 2)
+    {
+        change_rank(tree, p, -1);
+        refresh_balance(p);
+        return p;
+    }
+
+    // Sibling is a 2,2 node: demote both
+    if (rank_diff(y, y->left) == 2 && rank_diff(y, y->right) == 2)
+    {
+        change_rank(tree, p, -1);
+        change_rank(tree, y, -1);
+        refresh_balance(y);
+        refresh_balance(p);
+        return p;
+    }
+
+    // Otherwise one or two rotations terminate the deletion
+    AVLNode *z = y->right;
+    if (rank_diff(y, z) == 1)
+    {
+        AVLNode *root = wavl_rotate_left(tree, p);
+        change_rank(tree, y, 1);
+        change_rank(tree, p, -1);
+        if (p->left == NULL && p->right == NULL)
+            change_rank(tree, p, -1);
+        refresh_balance(p);
+        refresh_balance(y);
+        record_rotation(tree, ROTATION_RR, root);
+        return root;
+    }
+
+    AVLNode *v = y->left;
+    p->right = wavl_rotate_right(tree, y);
+    AVLNode *root = wavl_rotate_left(tree, p);
+    change_rank(tree, v, 2);
+    change_rank(tree, y, -1);
+    change_rank(tree, p, -2);
+    refresh_balance(y);
+    refresh_balance(p);
+    refresh_balance(v);
+    record_rotation(tree, ROTATION_RL, root);
+    return root;
+}
+
+// Mirror of delete_fix_left
+static AVLNode *delete_fix_right(AVLTree *tree, AVLNode *p)
+{
+    count_retrace(tree);
+
+    if (p->left == NULL && p->right == NULL)
+    {
+        if (p->height != 1)
+            change_rank(tree, p, 1 - p->height);
+        refresh_balance(p);
+        return p;
+    }
+
+    if (rank_diff(p, p->right) != 3)
+    {
+        refresh_balance(p);
+        return p;
+    }
+
+    AVLNode *y = p->left;
+
+    if (rank_diff(p, y) == 2)
+    {
+        change_rank(tree, p, -1);
+        refresh_balance(p);
+        return p;
+    }
+
+    if (rank_diff(y, y->left) == 2 && rank_diff(y, y->right) == 2)
+    {
+        change_rank(tree, p, -1);
+        change_rank(tree, y, -1);
+        refresh_balance(y);
+        refresh_balance(p);
+        return p;
+    }
+
+    AVLNode *z = y->left;
+    if (rank_diff(y, z) == 1)
+    {
+        AVLNode *root = wavl_rotate_right(tree, p);
+        change_rank(tree, y, 1);
+        change_rank(tree, p, -1);
+        if (p->left == NULL && p->right == NULL)
+            change_rank(tree, p, -1);
+        refresh_balance(p);
+        refresh_balance(y);
+        record_rotation(tree, ROTATION_LL, root);
+        return root;
+    }
+
+    AVLNode *v = y->right;
+    p->left = wavl_rotate_left(tree, y);
+    AVLNode *root = wavl_rotate_right(tree, p);
+    change_rank(tree, v, 2);
+    change_rank(tree, y, -1);
+    change_rank(tree, p, -2);
+    refresh_balance(y);
+    refresh_balance(p);
+    refresh_balance(v);
+    record_rotation(tree, ROTATION_LR, root);
+    return root;
+}
+
+AVLNode *wavl_delete_fix(AVLTree *tree, AVLNode *p, int from_left)
+{
+    return from_left ? delete_fix_left(tree, p) : delete_fix_right(tree, p);
+}
+
+// Delete a node
+AVLNode *wavl_delete_node(AVLTree *tree, AVLNode *root, int key)
+{
+    if (root == NULL)
+        return NULL;
+
+    if (key < root->key)
+    {
+        root->left = wavl_delete_node(tree, root->left, key);
+        return delete_fix_left(tree, root);
+    }
+    else if (key > root->key)
+    {
+        root->right = wavl_delete_node(tree, root->right, key);
+        return delete_fix_right(tree, root);
+    }
+
+    // Node found: unary or leaf nodes are replaced by their child
+    if (root->left == NULL || root->right == NULL)
+    {
+        AVLNode *child = root->left ? root->left : root->right;
+        account_removal(tree, root);
+        tree_free_node(tree, root);
+        return child;
+    }
+
+    // Binary node: take the successor's key and remove the successor
+    AVLNode *succ = find_min(root->right);
+    unsigned int flags = root->flags;
+    index_forget(tree, root);
+    root->key = succ->key;
+    root->flags = succ->flags;
+    succ->flags = flags;
+    index_note(tree, root);
+    root->right = wavl_delete_node(tree, root->right, succ->key);
+    return delete_fix_right(tree, root);
+}
\ No newline at end of file
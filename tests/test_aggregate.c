@@ -0,0 +1,160 @@
+#include "parallel_tree.h"
+#include "relocate.h"
+#include "split_join.h"
+
+#include <limits.h>
+#include <stdio.h>
+
+// aggregate_range against a linear scan; needs make AGGREGATE=1
+
+#ifdef TREE_AGGREGATE
+
+static int failures = 0;
+
+#define CHECK(cond)                                                   \
+    do                                                                \
+    {                                                                 \
+        if (!(cond))                                                  \
+        {                                                             \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                               \
+        }                                                             \
+    } while (0)
+
+#define SPAN 2048 // keys are drawn from [0, SPAN)
+
+static unsigned int rng = 5;
+
+static int next_key(void)
+{
+    rng = rng * 1103515245u + 12345u;
+    return (int)((rng >> 8) % SPAN);
+}
+
+// Combine the live keys of [lo, hi] one at a time, in key order
+static TreeAggregate scan(AVLTree *tree, int lo, int hi)
+{
+    TreeAggregate a = aggregate_empty();
+    int from = lo < -1 ? -1 : lo;
+    int to = hi > SPAN ? SPAN : hi;
+    for (int key = from; key <= to; key++)
+    {
+        if (tree_search(tree, key) != NULL)
+            a = aggregate_combine(a, aggregate_of(key));
+    }
+    return a;
+}
+
+static void check_ranges(AVLTree *tree)
+{
+    CHECK(validate_tree(tree, NULL));
+    CHECK(aggregate_equal(aggregate_range(tree, INT_MIN, INT_MAX), scan(tree, INT_MIN, INT_MAX)));
+    CHECK(aggregate_equal(aggregate_range(tree, 10, 9), aggregate_empty()));
+    for (int i = 0; i < 50; i++)
+    {
+        int lo = next_key() - 5;
+        int hi = lo + next_key() % 300;
+        CHECK(aggregate_equal(aggregate_range(tree, lo, hi), scan(tree, lo, hi)));
+        CHECK(aggregate_equal(aggregate_range(tree, lo, lo), scan(tree, lo, lo)));
+    }
+}
+
+static AVLTree *random_tree(BalanceEngine engine, int inserts)
+{
+    AVLTree *tree = create_tree(engine);
+    for (int i = 0; i < inserts; i++)
+        tree_insert(tree, next_key());
+    return tree;
+}
+
+static void churn(BalanceEngine engine, int lazy)
+{
+    AVLTree *tree = random_tree(engine, 1500);
+    if (lazy)
+        set_lazy_delete(tree, 1, 0.4);
+    check_ranges(tree);
+    for (int round = 0; round < 5; round++)
+    {
+        for (int i = 0; i < 400; i++)
+            tree_delete(tree, next_key());
+        for (int i = 0; i < 200; i++)
+            tree_insert(tree, next_key()); // revives tombstones in lazy mode
+        check_ranges(tree);
+    }
+    if (lazy)
+    {
+        compact_tree(tree);
+        check_ranges(tree);
+    }
+    destroy_tree(tree);
+}
+
+static void bulk_updates(BalanceEngine engine)
+{
+    AVLTree *tree = random_tree(engine, 1500);
+    AVLTree *right = create_tree(engine);
+
+    CHECK(tree_split(tree, SPAN / 2, right));
+    check_ranges(tree);
+    check_ranges(right);
+    tree_delete(right, next_key());
+    CHECK(tree_join(tree, right));
+    check_ranges(tree);
+
+    AVLTree *part = tree_extract_range(tree, 300, 700);
+    CHECK(part != NULL);
+    if (part != NULL)
+    {
+        check_ranges(part);
+        destroy_tree(part);
+    }
+    tree_delete_range(tree, 1500, 1600);
+    check_ranges(tree);
+
+    CHECK(tree_relocate(tree, LAYOUT_VEB));
+    check_ranges(tree);
+    tree_insert(tree, 500);
+    tree_delete(tree, next_key());
+    check_ranges(tree);
+    destroy_tree(right);
+    destroy_tree(tree);
+}
+
+static void parallel_build(BalanceEngine engine)
+{
+    int keys[SPAN / 2];
+    for (int i = 0; i < SPAN / 2; i++)
+        keys[i] = 2 * i;
+    TaskPool *pool = create_task_pool(4);
+    AVLTree *tree = create_tree(engine);
+    CHECK(build_tree_from_sorted(tree, keys, SPAN / 2, pool));
+    check_ranges(tree);
+    destroy_tree(tree);
+    destroy_task_pool(pool);
+}
+
+int main(void)
+{
+    BalanceEngine engines[] = {ENGINE_AVL, ENGINE_WAVL};
+    for (size_t i = 0; i < sizeof(engines) / sizeof(engines[0]); i++)
+    {
+        churn(engines[i], 0);
+        churn(engines[i], 1);
+        bulk_updates(engines[i]);
+        parallel_build(engines[i]);
+    }
+
+    if (failures == 0)
+        printf("aggregate tests passed\n");
+    return failures != 0;
+}
+
+#else
+
+int main(void)
+{
+    printf("aggregate tests skipped (build with AGGREGATE=1)\n");
+    return 0;
+}
+
+#endif // TREE_AGGREGATE
@@ -0,0 +1,127 @@
+#include "finger.h"
+#include "key_cache.h"
+#include "split_join.h"
+
+#include <stdio.h>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                   \
+    do                                                                \
+    {                                                                 \
+        if (!(cond))                                                  \
+        {                                                             \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                               \
+        }                                                             \
+    } while (0)
+
+static uint64_t fake_now;
+
+static uint64_t fake_clock(void)
+{
+    return fake_now;
+}
+
+// Fingers admit and evict like tree_insert, without leaving the cache stale
+static void finger_keeps_limits(BalanceEngine engine)
+{
+    AVLTree *tree = create_tree(engine);
+    CacheConfig config = {100, 0, 0, fake_clock};
+    CHECK(tree_enable_cache(tree, &config));
+
+    TreeFinger finger;
+    finger_init(&finger, tree);
+    for (int i = 0; i < 1000; i++)
+        CHECK(finger_insert(&finger, i));
+
+    CHECK(tree->size == 100);
+    CHECK(cache_in_step(tree));
+    CHECK(tree_search(tree, 899) == NULL);
+    CHECK(tree_search(tree, 900) != NULL);
+    CHECK(tree->cache->evictions == 900);
+    destroy_tree(tree);
+}
+
+// A finger re-inserting an expired key revives it
+static void finger_revives_expired(BalanceEngine engine)
+{
+    AVLTree *tree = create_tree(engine);
+    CacheConfig config = {0, 0, 50, fake_clock};
+    fake_now = 1000;
+    CHECK(tree_enable_cache(tree, &config));
+
+    TreeFinger finger;
+    finger_init(&finger, tree);
+    CHECK(finger_insert(&finger, 7));
+    CHECK(!finger_insert(&finger, 7));
+    fake_now += 60;
+    CHECK(tree_search(tree, 7) == NULL);
+    CHECK(finger_insert(&finger, 7));
+    CHECK(tree_search(tree, 7) != NULL);
+    destroy_tree(tree);
+}
+
+// Finger reads skip expired keys and refresh recency like tree_search
+static void finger_search_uses_cache(BalanceEngine engine)
+{
+    AVLTree *tree = create_tree(engine);
+    CacheConfig config = {3, 0, 50, fake_clock};
+    fake_now = 1000;
+    CHECK(tree_enable_cache(tree, &config));
+
+    TreeFinger finger;
+    finger_init(&finger, tree);
+    for (int i = 1; i <= 3; i++)
+        finger_insert(&finger, i);
+
+    // 1 is read last, so 2 is the least recent when 4 arrives
+    CHECK(finger_search(&finger, 1) != NULL);
+    finger_insert(&finger, 4);
+    CHECK(finger_search(&finger, 1) != NULL);
+    CHECK(finger_search(&finger, 2) == NULL);
+    CHECK(tree_search(tree, 2) == NULL);
+
+    fake_now += 60;
+    CHECK(finger_search(&finger, 3) == NULL);
+    CHECK(tree_search(tree, 3) == NULL);
+    destroy_tree(tree);
+}
+
+// Searches skip expired keys while a bulk update has left the cache stale
+static void stale_search_expires(BalanceEngine engine)
+{
+    AVLTree *tree = create_tree(engine);
+    CacheConfig config = {0, 0, 50, fake_clock};
+    fake_now = 1000;
+    CHECK(tree_enable_cache(tree, &config));
+    for (int i = 0; i < 10; i++)
+        tree_insert(tree, i);
+
+    CHECK(tree_delete_range(tree, 0, 4) == 5);
+    CHECK(!cache_in_step(tree));
+    fake_now += 60;
+
+    int keys[] = {5, 9};
+    AVLNode *found[2];
+    CHECK(tree_search(tree, 5) == NULL);
+    tree_search_batch(tree, keys, 2, found);
+    CHECK(found[0] == NULL && found[1] == NULL);
+    destroy_tree(tree);
+}
+
+int main(void)
+{
+    BalanceEngine engines[] = {ENGINE_AVL, ENGINE_WAVL};
+    for (size_t i = 0; i < sizeof(engines) / sizeof(engines[0]); i++)
+    {
+        finger_keeps_limits(engines[i]);
+        finger_revives_expired(engines[i]);
+        finger_search_uses_cache(engines[i]);
+        stale_search_expires(engines[i]);
+    }
+
+    if (failures == 0)
+        printf("cache finger tests passed\n");
+    return failures != 0;
+}
@@ -0,0 +1,73 @@
+#include "key_cache.h"
+#include "relocate.h"
+
+#include <stdio.h>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                   \
+    do                                                                \
+    {                                                                 \
+        if (!(cond))                                                  \
+        {                                                             \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                               \
+        }                                                             \
+    } while (0)
+
+// Evictions and deletes leave no tombstones behind in lazy-delete mode
+static void lazy_tree_stays_bounded(BalanceEngine engine)
+{
+    AVLTree *tree = create_tree(engine);
+    set_lazy_delete(tree, 1, 0.5);
+    for (int i = 0; i < 100; i++)
+        tree_insert(tree, i);
+    for (int i = 0; i < 100; i += 3)
+        tree_delete(tree, i);
+    CHECK(tree->tombstones > 0);
+
+    CacheConfig config = {50, 0, 0, NULL};
+    CHECK(tree_enable_cache(tree, &config));
+    CHECK(tree->tombstones == 0 && tree->size == 50);
+
+    for (int i = 1000; i < 2000; i++)
+    {
+        tree_insert(tree, i);
+        if (i % 7 == 0)
+            tree_delete(tree, i - 3);
+    }
+    CHECK(tree->tombstones == 0);
+    CHECK(tree->size <= 50);
+    CHECK(tree->memory.live_nodes == tree->size);
+    destroy_tree(tree);
+}
+
+// Relocation moves nodes but keeps the keys, so the cache stays exact
+static void relocation_keeps_cache(BalanceEngine engine)
+{
+    AVLTree *tree = create_tree(engine);
+    CacheConfig config = {100, 0, 0, NULL};
+    CHECK(tree_enable_cache(tree, &config));
+    for (int i = 0; i < 500; i++)
+        tree_insert(tree, i);
+
+    CHECK(tree_relocate(tree, LAYOUT_VEB));
+    CHECK(cache_in_step(tree));
+    tree_insert(tree, 1000);
+    CHECK(tree->size == 100 && tree_search(tree, 400) == NULL && tree_search(tree, 1000) != NULL);
+    destroy_tree(tree);
+}
+
+int main(void)
+{
+    BalanceEngine engines[] = {ENGINE_AVL, ENGINE_WAVL};
+    for (size_t i = 0; i < sizeof(engines) / sizeof(engines[0]); i++)
+    {
+        lazy_tree_stays_bounded(engines[i]);
+        relocation_keeps_cache(engines[i]);
+    }
+
+    if (failures == 0)
+        printf("cache limit tests passed\n");
+    return failures != 0;
+}
@@ -0,0 +1,49 @@
+#!/bin/sh
+# Command-driver checks: tests/test_cli.sh [path to avl_cli]
+CLI=${1:-build/avl_cli}
+failures=0
+
+fail()
+{
+    echo "FAIL: $1"
+    failures=$((failures + 1))
+}
+
+# A stats line landing when the output buffer is nearly full must come out
+# whole, with as many fields as on an empty tree: sweep the fill level
+# across the point where it no longer fits
+fields=$(echo stats | "$CLI" | tr -cd '=' | wc -c)
+n=21700
+while [ $n -le 21790 ]; do
+    out=$( (seq 1 $n | sed 's/^/insert /'; echo stats) | "$CLI")
+    lines=$(printf '%s\n' "$out" | wc -l)
+    oks=$(printf '%s\n' "$out" | grep -c '^ok$')
+    last=$(printf '%s\n' "$out" | tail -n 1)
+    if [ "$lines" -ne $((n + 1)) ] || [ "$oks" -ne $n ] ||
+        [ "$(printf '%s' "$last" | tr -cd '=' | wc -c)" -ne "$fields" ] ||
+        ! printf '%s\n' "$last" | grep -q "^engine=AVL size=$n .*=[0-9.]*$"; then
+        fail "stats after $n inserts"
+        break
+    fi
+    n=$((n + 1))
+done
+
+# Long and short forms of every command
+expect()
+{
+    out=$(printf "$1" | "$CLI" 2>&1)
+    [ "$out" = "$(printf "$2")" ] || fail "$(printf "$1" | tr '\n' ';') gave: $out"
+}
+
+expect 'insert 5\ni 3\ni 9\ninsert 3\n' 'ok\nok\nok\nexists\n'
+expect 'i 1\nsearch 1\ns 2\n' 'ok\nfound\nmissing\n'
+expect 'i 1\ndelete 1\nd 1\n' 'ok\nok\nmissing\n'
+expect 'i 1\ni 2\ni 7\nrange 0 5\nr 6 9\n' 'ok\nok\nok\n1 2\n7\n'
+expect 'i 1\ni 2\ni 3\ni 8\ndelete_range 1 5\nr 0 9\n' 'ok\nok\nok\nok\nremoved 3\n8\n'
+expect 'i 1\ni 2\ni 8\ndr 0 2\nrange 0 9\n' 'ok\nok\nok\nremoved 2\n8\n'
+expect 'bogus 1\n' 'line 1: bad command\n'
+expect 'insert 12abc\ni 7x\nr 1 9z\ns 12\n' 'line 1: bad command\nline 2: bad command\nline 3: bad command\nmissing\n'
+expect 'i 4 # note\ni 5#note\ns 5\n' 'ok\nok\nfound\n'
+
+[ $failures -eq 0 ] && echo "cli tests passed"
+[ $failures -eq 0 ]
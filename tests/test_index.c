@@ -0,0 +1,134 @@
+#include "key_index.h"
+#include "parallel_tree.h"
+#include "relocate.h"
+#include "split_join.h"
+
+#include <stdio.h>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                   \
+    do                                                                \
+    {                                                                 \
+        if (!(cond))                                                  \
+        {                                                             \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                               \
+        }                                                             \
+    } while (0)
+
+#define KEYS 1000
+
+static AVLTree *indexed_tree(BalanceEngine engine)
+{
+    AVLTree *tree = create_tree(engine);
+    CHECK(tree_enable_index(tree));
+    for (int i = 0; i < KEYS; i++)
+        tree_insert(tree, (i * 7919) % KEYS);
+    CHECK(index_in_step(tree));
+    return tree;
+}
+
+// Every key in [lo, hi] maps to the node a descent finds. Checked before
+// any lookup, since a lookup rebuilds a stale index first.
+static void check_index(AVLTree *tree, int lo, int hi, int expect_in_step)
+{
+    if (expect_in_step)
+    {
+        CHECK(index_in_step(tree));
+        CHECK(tree->index->count == tree->size + tree->tombstones);
+    }
+    for (int key = lo; key <= hi; key++)
+    {
+        AVLNode *node = (AVLNode *)tree;
+        CHECK(index_lookup(tree, key, &node));
+        CHECK(node == search_node(tree->root, key));
+    }
+    CHECK(index_in_step(tree));
+    CHECK(validate_tree(tree, NULL));
+}
+
+// Deleting a node with two children moves its successor's key; the index
+// follows each node that takes over a key
+static void delete_keeps_step(BalanceEngine engine)
+{
+    AVLTree *tree = indexed_tree(engine);
+    for (int i = 0; i < 200; i++)
+        CHECK(tree_delete(tree, tree->root->key));
+    for (int key = 0; key < KEYS; key += 3)
+        tree_delete(tree, key);
+    check_index(tree, -10, KEYS + 10, 1);
+
+    for (int key = 0; key < KEYS; key += 2)
+        tree_insert(tree, key);
+    check_index(tree, -10, KEYS + 10, 1);
+
+    // Tombstones stay indexed but stay hidden
+    set_lazy_delete(tree, 1, 0.9);
+    for (int key = 0; key < KEYS; key += 5)
+        tree_delete(tree, key);
+    check_index(tree, 0, KEYS, 1);
+    CHECK(tree_search(tree, 5) == NULL && search_node(tree->root, 5) != NULL);
+    compact_tree(tree);
+    check_index(tree, 0, KEYS, 1);
+    destroy_tree(tree);
+}
+
+// Relocation copies every node, so lookups must not hand out the old ones
+static void relocate_refreshes(BalanceEngine engine, NodeLayout layout)
+{
+    AVLTree *tree = indexed_tree(engine);
+    AVLNode *before = tree_search(tree, 500);
+    CHECK(tree_relocate(tree, layout));
+    check_index(tree, -10, KEYS + 10, 0);
+    CHECK(tree->arena != NULL && tree_search(tree, 500) != before);
+
+    for (int key = 0; key < KEYS; key += 4)
+        tree_delete(tree, key);
+    tree_insert(tree, KEYS + 5);
+    check_index(tree, -10, KEYS + 10, 1);
+    destroy_tree(tree);
+}
+
+// Split and join move subtrees wholesale; each side answers only its keys
+static void split_join_refreshes(BalanceEngine engine)
+{
+    AVLTree *tree = indexed_tree(engine);
+    AVLTree *right = create_tree(engine);
+    CHECK(tree_enable_index(right));
+
+    CHECK(tree_search(tree, 700) != NULL);
+    CHECK(tree_split(tree, 500, right));
+    check_index(tree, -10, KEYS + 10, 0);
+    check_index(right, -10, KEYS + 10, 0);
+    CHECK(tree_search(tree, 700) == NULL && tree_search(right, 700) != NULL);
+
+    tree_delete(right, 700);
+    CHECK(tree_join(tree, right));
+    check_index(tree, -10, KEYS + 10, 0);
+    check_index(right, -10, KEYS + 10, 0);
+    CHECK(tree_search(tree, 700) == NULL && tree_search(tree, 701) != NULL);
+    CHECK(tree->size == KEYS - 1 && right->size == 0);
+
+    CHECK(tree_delete_range(tree, 100, 199) == 100);
+    check_index(tree, -10, KEYS + 10, 0);
+    destroy_tree(right);
+    destroy_tree(tree);
+}
+
+int main(void)
+{
+    BalanceEngine engines[] = {ENGINE_AVL, ENGINE_WAVL};
+    NodeLayout layouts[] = {LAYOUT_VEB, LAYOUT_BFS};
+    for (size_t e = 0; e < sizeof(engines) / sizeof(engines[0]); e++)
+    {
+        delete_keeps_step(engines[e]);
+        for (size_t l = 0; l < sizeof(layouts) / sizeof(layouts[0]); l++)
+            relocate_refreshes(engines[e], layouts[l]);
+        split_join_refreshes(engines[e]);
+    }
+
+    if (failures == 0)
+        printf("key index tests passed\n");
+    return failures != 0;
+}
@@ -0,0 +1,162 @@
+#include "parallel_tree.h"
+
+#include <stdio.h>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                   \
+    do                                                                \
+    {                                                                 \
+        if (!(cond))                                                  \
+        {                                                             \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                               \
+        }                                                             \
+    } while (0)
+
+// Deletes only mark nodes; re-inserts revive them in place
+static void tombstones_and_revive(BalanceEngine engine)
+{
+    AVLTree *tree = create_tree(engine);
+    set_lazy_delete(tree, 1, 0.9);
+    for (int i = 0; i < 100; i++)
+        tree_insert(tree, i);
+
+    for (int i = 0; i < 100; i += 4)
+        CHECK(tree_delete(tree, i));
+    CHECK(!tree_delete(tree, 0));
+    CHECK(!tree_delete(tree, 500));
+
+    TreeStats stats;
+    tree_stats(tree, &stats);
+    CHECK(tree->size == 75 && tree->tombstones == 25 && stats.tombstones == 25);
+    CHECK(tree->memory.live_nodes == 100);
+    CHECK(tombstone_ratio(tree) == 0.25);
+    CHECK(validate_tree(tree, NULL));
+
+    // Hidden from searches, but still linked
+    CHECK(tree_search(tree, 4) == NULL && search_node(tree->root, 4) != NULL);
+    CHECK(tree_search(tree, 5) != NULL);
+
+    AVLNode *node = search_node(tree->root, 8);
+    CHECK(tree_insert(tree, 8));
+    CHECK(!tree_insert(tree, 8));
+    CHECK(tree_search(tree, 8) == node);
+    CHECK(tree->size == 76 && tree->tombstones == 24);
+    CHECK(tree->memory.live_nodes == 100);
+    CHECK(validate_tree(tree, NULL));
+    destroy_tree(tree);
+}
+
+// Iterators walk live keys only, from the start or from a tombstone
+static void iterators_skip(BalanceEngine engine)
+{
+    AVLTree *tree = create_tree(engine);
+    set_lazy_delete(tree, 1, 0.9);
+    for (int i = 0; i < 50; i++)
+        tree_insert(tree, i);
+    for (int i = 0; i < 50; i += 2)
+        tree_delete(tree, i);
+
+    TreeIterator it;
+    AVLNode *node;
+    int expect = 1, seen = 0;
+    tree_iter_first(&it, tree);
+    while ((node = tree_iter_next(&it)) != NULL)
+    {
+        CHECK(node->key == expect);
+        expect += 2;
+        seen++;
+    }
+    CHECK(seen == 25);
+
+    tree_iter_seek(&it, tree, 10);
+    node = tree_iter_next(&it);
+    CHECK(node != NULL && node->key == 11);
+    destroy_tree(tree);
+}
+
+// Crossing the ratio rebuilds the tree without its tombstones
+static void compaction_triggers(BalanceEngine engine)
+{
+    AVLTree *tree = create_tree(engine);
+    set_lazy_delete(tree, 1, 0.25);
+    for (int i = 0; i < 100; i++)
+        tree_insert(tree, i);
+    reset_tree_stats(tree);
+
+    for (int i = 0; i < 25; i++)
+        tree_delete(tree, i);
+    TreeStats stats;
+    tree_stats(tree, &stats);
+    CHECK(stats.compactions == 0 && tree->tombstones == 25);
+
+    tree_delete(tree, 25);
+    tree_stats(tree, &stats);
+    CHECK(stats.compactions == 1 && stats.tombstones == 0);
+    CHECK(tree->size == 74 && tree->memory.live_nodes == 74);
+    CHECK(search_node(tree->root, 10) == NULL && tree_search(tree, 26) != NULL);
+    CHECK(validate_tree(tree, NULL));
+
+    // An explicit compaction counts too, and eager mode unlinks at once
+    tree_delete(tree, 50);
+    compact_tree(tree);
+    set_lazy_delete(tree, 0, 0.0);
+    tree_delete(tree, 51);
+    tree_stats(tree, &stats);
+    CHECK(stats.compactions == 2 && tree->tombstones == 0);
+    CHECK(tree->size == 72 && tree->memory.live_nodes == 72);
+    CHECK(validate_tree(tree, NULL));
+    destroy_tree(tree);
+}
+
+// Mixed churn keeps the counts and the shape consistent throughout
+static void churn_stays_valid(BalanceEngine engine)
+{
+    AVLTree *tree = create_tree(engine);
+    set_lazy_delete(tree, 1, 0.3);
+    unsigned int rng = 11;
+    int present[512] = {0};
+    size_t live = 0;
+
+    for (int i = 0; i < 20000; i++)
+    {
+        rng = rng * 1103515245u + 12345u;
+        int key = (int)((rng >> 8) % 512);
+        if ((rng >> 20) & 1)
+        {
+            CHECK(tree_insert(tree, key) == !present[key]);
+            live += !present[key];
+            present[key] = 1;
+        }
+        else
+        {
+            CHECK(tree_delete(tree, key) == present[key]);
+            live -= present[key];
+            present[key] = 0;
+        }
+        if (i % 1000 == 0)
+            CHECK(validate_tree(tree, NULL));
+    }
+    CHECK(tree->size == live);
+    CHECK(tombstone_ratio(tree) <= 0.3);
+    for (int key = 0; key < 512; key++)
+        CHECK((tree_search(tree, key) != NULL) == present[key]);
+    destroy_tree(tree);
+}
+
+int main(void)
+{
+    BalanceEngine engines[] = {ENGINE_AVL, ENGINE_WAVL};
+    for (size_t i = 0; i < sizeof(engines) / sizeof(engines[0]); i++)
+    {
+        tombstones_and_revive(engines[i]);
+        iterators_skip(engines[i]);
+        compaction_triggers(engines[i]);
+        churn_stays_valid(engines[i]);
+    }
+
+    if (failures == 0)
+        printf("lazy delete tests passed\n");
+    return failures != 0;
+}
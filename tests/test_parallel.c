@@ -0,0 +1,123 @@
+#include "parallel_tree.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                   \
+    do                                                                \
+    {                                                                 \
+        if (!(cond))                                                  \
+        {                                                             \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                               \
+        }                                                             \
+    } while (0)
+
+static int same_shape(const AVLNode *a, const AVLNode *b)
+{
+    if (a == NULL || b == NULL)
+        return a == b;
+    return a->key == b->key && a->height == b->height && a->balance_factor == b->balance_factor &&
+           same_shape(a->left, b->left) && same_shape(a->right, b->right);
+}
+
+// Deepest node along the leftmost path
+static AVLNode *leftmost(AVLNode *node)
+{
+    while (node && node->left)
+        node = node->left;
+    return node;
+}
+
+// The pool builds, counts and validates exactly what the serial path does
+static void matches_serial(TaskPool *pool, BalanceEngine engine, size_t n)
+{
+    int *keys = (int *)malloc((n ? n : 1) * sizeof(int));
+    for (size_t i = 0; i < n; i++)
+        keys[i] = (int)(3 * i) - 1000;
+
+    AVLTree *serial = create_tree(engine);
+    AVLTree *parallel = create_tree(engine);
+    CHECK(build_tree_from_sorted(serial, keys, n, NULL));
+    CHECK(build_tree_from_sorted(parallel, keys, n, pool));
+
+    CHECK(same_shape(serial->root, parallel->root));
+    CHECK(serial->size == n && parallel->size == n);
+    CHECK(serial->memory.live_nodes == parallel->memory.live_nodes);
+    CHECK(parallel_count_nodes(NULL, serial->root) == n);
+    CHECK(parallel_count_nodes(pool, parallel->root) == n);
+    CHECK(validate_tree(serial, NULL) && validate_tree(serial, pool));
+    CHECK(validate_tree(parallel, NULL) && validate_tree(parallel, pool));
+
+    // A broken height deep in the tree fails both ways
+    AVLNode *leaf = leftmost(parallel->root);
+    if (leaf != NULL)
+    {
+        leaf->height += 2;
+        CHECK(!validate_tree(parallel, NULL) && !validate_tree(parallel, pool));
+        leaf->height -= 2;
+    }
+
+    // The built tree takes ordinary updates
+    CHECK(tree_insert(parallel, 1));
+    CHECK(tree_delete(parallel, -1000) == (n > 0));
+    CHECK(validate_tree(parallel, pool));
+
+    destroy_tree(serial);
+    destroy_tree(parallel);
+    free(keys);
+}
+
+static void rejects_bad_input(TaskPool *pool)
+{
+    int unsorted[] = {1, 3, 2};
+    int duplicate[] = {1, 2, 2};
+    AVLTree *tree = create_tree(ENGINE_AVL);
+    CHECK(!build_tree_from_sorted(tree, unsorted, 3, pool));
+    CHECK(!build_tree_from_sorted(tree, duplicate, 3, pool));
+    CHECK(tree->root == NULL && tree->size == 0);
+
+    // Only empty trees are built into
+    tree_insert(tree, 5);
+    CHECK(!build_tree_from_sorted(tree, unsorted, 1, pool));
+    destroy_tree(tree);
+}
+
+// Misordered keys are caught by the parallel walk as well
+static void detects_misorder(TaskPool *pool)
+{
+    int keys[4096];
+    for (int i = 0; i < 4096; i++)
+        keys[i] = i;
+    AVLTree *tree = create_tree(ENGINE_AVL);
+    CHECK(build_tree_from_sorted(tree, keys, 4096, pool));
+    AVLNode *leaf = leftmost(tree->root);
+    leaf->key = 5000;
+    CHECK(!validate_tree(tree, NULL) && !validate_tree(tree, pool));
+    leaf->key = 0;
+    CHECK(validate_tree(tree, pool));
+    destroy_tree(tree);
+}
+
+int main(void)
+{
+    TaskPool *pool = create_task_pool(4);
+    CHECK(pool != NULL && task_pool_threads(pool) == 4);
+
+    BalanceEngine engines[] = {ENGINE_AVL, ENGINE_WAVL};
+    size_t sizes[] = {0, 1, 2, 1000, 100000};
+    for (size_t e = 0; e < sizeof(engines) / sizeof(engines[0]); e++)
+    {
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+            matches_serial(pool, engines[e], sizes[s]);
+    }
+    rejects_bad_input(pool);
+    detects_misorder(pool);
+    destroy_task_pool(pool);
+
+    if (failures == 0)
+        printf("parallel tree tests passed\n");
+    return failures != 0;
+}
@@ -0,0 +1,108 @@
+#include "parallel_tree.h"
+#include "persistent_tree.h"
+
+#include <stdio.h>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                   \
+    do                                                                \
+    {                                                                 \
+        if (!(cond))                                                  \
+        {                                                             \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                               \
+        }                                                             \
+    } while (0)
+
+// Same keys, shape and ranks
+static int same_tree(const AVLNode *a, const AVLNode *b)
+{
+    if (a == NULL || b == NULL)
+        return a == b;
+    return a->key == b->key && a->height == b->height &&
+           same_tree(a->left, b->left) && same_tree(a->right, b->right);
+}
+
+// Path copying builds the tree the in-place engine would, one version per step
+static void churn_matches_engine(BalanceEngine engine)
+{
+    PersistentTree *pt = ptree_create(engine, 4096);
+    AVLTree *tree = create_tree(engine);
+    unsigned int rng = 7;
+    for (int i = 0; i < 3000; i++)
+    {
+        rng = rng * 1103515245u + 12345u;
+        int key = (int)(rng >> 16) % 500;
+        if (i % 3 == 2)
+        {
+            CHECK(ptree_delete(pt, key) == tree_delete(tree, key));
+        }
+        else
+        {
+            CHECK(ptree_insert(pt, key) == tree_insert(tree, key));
+        }
+    }
+    CHECK(validate_tree(ptree_handle(pt), NULL));
+    CHECK(ptree_handle(pt)->size == tree->size);
+    CHECK(same_tree(ptree_handle(pt)->root, tree->root));
+
+    // Every earlier version is still a valid tree
+    while (ptree_undo(pt))
+        CHECK(validate_tree(ptree_handle(pt), NULL));
+    CHECK(ptree_handle(pt)->size == 0);
+    while (ptree_redo(pt))
+        ;
+    CHECK(same_tree(ptree_handle(pt)->root, tree->root));
+
+    destroy_tree(tree);
+    ptree_destroy(pt);
+}
+
+static void undo_redo_checkout(BalanceEngine engine)
+{
+    PersistentTree *pt = ptree_create(engine, 8);
+    for (int i = 1; i <= 5; i++)
+        ptree_insert(pt, i);
+    CHECK(!ptree_insert(pt, 3));
+    CHECK(ptree_undo_depth(pt) == 5 && ptree_redo_depth(pt) == 0);
+
+    TreeVersion five = ptree_snapshot(pt);
+    CHECK(ptree_undo(pt) && ptree_undo(pt));
+    CHECK(ptree_handle(pt)->size == 3 && tree_search(ptree_handle(pt), 4) == NULL);
+    CHECK(ptree_redo(pt));
+    CHECK(tree_search(ptree_handle(pt), 4) != NULL);
+
+    // A new update drops the redo state
+    CHECK(ptree_delete(pt, 1));
+    CHECK(ptree_redo_depth(pt) == 0 && !ptree_redo(pt));
+    CHECK(version_search(five, 1) != NULL && version_search(five, 5) != NULL);
+
+    // Checkout is itself an undoable step
+    ptree_checkout(pt, five);
+    CHECK(ptree_handle(pt)->size == 5 && tree_search(ptree_handle(pt), 1) != NULL);
+    CHECK(validate_tree(ptree_handle(pt), NULL));
+    CHECK(ptree_undo(pt));
+    CHECK(tree_search(ptree_handle(pt), 1) == NULL);
+    ptree_release(pt, five);
+
+    // The history is bounded; the oldest versions go first
+    for (int i = 10; i < 30; i++)
+        ptree_insert(pt, i);
+    CHECK(ptree_undo_depth(pt) == 8);
+    ptree_destroy(pt);
+}
+
+int main(void)
+{
+    BalanceEngine engines[] = {ENGINE_AVL, ENGINE_WAVL};
+    for (size_t i = 0; i < sizeof(engines) / sizeof(engines[0]); i++)
+    {
+        churn_matches_engine(engines[i]);
+        undo_redo_checkout(engines[i]);
+    }
+
+    if (failures == 0)
+        printf("persistent tree tests passed\n");
+    return failures != 0;
+}
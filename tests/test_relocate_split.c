@@ -0,0 +1,91 @@
+#include "parallel_tree.h"
+#include "relocate.h"
+#include "split_join.h"
+
+#include <stdio.h>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                   \
+    do                                                                \
+    {                                                                 \
+        if (!(cond))                                                  \
+        {                                                             \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                               \
+        }                                                             \
+    } while (0)
+
+static AVLTree *relocated_tree(BalanceEngine engine, NodeLayout layout)
+{
+    AVLTree *tree = create_tree(engine);
+    for (int i = 0; i < 1000; i++)
+        tree_insert(tree, (i * 7919) % 1000);
+    CHECK(tree_relocate(tree, layout));
+    CHECK(tree->arena != NULL);
+    CHECK(validate_tree(tree, NULL));
+    return tree;
+}
+
+// Split and join move nodes within the pool a relocation left behind
+static void split_after_relocate(BalanceEngine engine, NodeLayout layout)
+{
+    AVLTree *tree = relocated_tree(engine, layout);
+    AVLTree *right = create_tree(engine);
+
+    CHECK(tree_split(tree, 500, right));
+    CHECK(tree->size == 500 && right->size == 500);
+    CHECK(validate_tree(tree, NULL) && validate_tree(right, NULL));
+    CHECK(right->arena == tree->arena);
+    CHECK(tree_search(tree, 499) && !tree_search(tree, 500));
+    CHECK(tree_search(right, 500) && tree_search(right, 999));
+
+    // Both trees draw from the pool now, so neither may be relocated
+    CHECK(!tree_relocate(tree, layout));
+
+    tree_insert(right, 5000);
+    CHECK(tree_join(tree, right));
+    CHECK(tree->size == 1001 && right->size == 0 && validate_tree(tree, NULL));
+
+    // Whichever tree goes first leaves the pool to the other
+    destroy_tree(tree);
+    tree_insert(right, 1);
+    CHECK(right->size == 1 && validate_tree(right, NULL));
+    destroy_tree(right);
+}
+
+static void extract_after_relocate(BalanceEngine engine, NodeLayout layout)
+{
+    AVLTree *tree = relocated_tree(engine, layout);
+    AVLTree *part = tree_extract_range(tree, 100, 199);
+
+    CHECK(part != NULL);
+    if (part != NULL)
+    {
+        CHECK(part->size == 100 && tree->size == 900);
+        CHECK(validate_tree(part, NULL) && validate_tree(tree, NULL));
+        CHECK(tree_delete_range(part, 150, 199) == 50);
+        destroy_tree(part);
+    }
+    CHECK(tree_delete_range(tree, 0, 99) == 100);
+    CHECK(validate_tree(tree, NULL));
+    destroy_tree(tree);
+}
+
+int main(void)
+{
+    BalanceEngine engines[] = {ENGINE_AVL, ENGINE_WAVL};
+    NodeLayout layouts[] = {LAYOUT_VEB, LAYOUT_BFS};
+    for (size_t e = 0; e < sizeof(engines) / sizeof(engines[0]); e++)
+    {
+        for (size_t l = 0; l < sizeof(layouts) / sizeof(layouts[0]); l++)
+        {
+            split_after_relocate(engines[e], layouts[l]);
+            extract_after_relocate(engines[e], layouts[l]);
+        }
+    }
+
+    if (failures == 0)
+        printf("relocate split tests passed\n");
+    return failures != 0;
+}
@@ -0,0 +1,116 @@
+#include "avl_tree.h"
+
+#include <stdio.h>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                   \
+    do                                                                \
+    {                                                                 \
+        if (!(cond))                                                  \
+        {                                                             \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                               \
+        }                                                             \
+    } while (0)
+
+static AVLTree *tree_of(BalanceEngine engine, const int *keys, int n)
+{
+    AVLTree *tree = create_tree(engine);
+    for (int i = 0; i < n; i++)
+        tree_insert(tree, keys[i]);
+    return tree;
+}
+
+// Each rebalancing case is counted once under its own type; a double
+// rotation is one LR/RL event but two structural rotations
+static void insert_cases(BalanceEngine engine)
+{
+    static const struct
+    {
+        int keys[3];
+        RotationType type;
+        unsigned long rotations;
+    } cases[] = {
+        {{3, 2, 1}, ROTATION_LL, 1},
+        {{1, 2, 3}, ROTATION_RR, 1},
+        {{3, 1, 2}, ROTATION_LR, 2},
+        {{1, 3, 2}, ROTATION_RL, 2},
+    };
+
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++)
+    {
+        AVLTree *tree = tree_of(engine, cases[c].keys, 3);
+        TreeStats stats;
+        tree_stats(tree, &stats);
+        for (int type = ROTATION_LL; type <= ROTATION_RL; type++)
+            CHECK(stats.rotations_by_type[type] == (type == (int)cases[c].type));
+        CHECK(stats.rotations == cases[c].rotations);
+        CHECK(g_last_rotation == cases[c].type);
+        CHECK(g_rotation_node == tree->root && tree->root->key == 2);
+        CHECK(stats.inserts == 3);
+        destroy_tree(tree);
+    }
+}
+
+// Deletions are attributed the same way
+static void delete_cases(BalanceEngine engine)
+{
+    int right_heavy[] = {2, 1, 3, 4};
+    AVLTree *tree = tree_of(engine, right_heavy, 4);
+    reset_tree_stats(tree);
+    tree_delete(tree, 1);
+    TreeStats stats;
+    tree_stats(tree, &stats);
+    CHECK(stats.rotations_by_type[ROTATION_RR] == 1 && stats.rotations == 1);
+    CHECK(tree->root->key == 3);
+    destroy_tree(tree);
+
+    int left_inner[] = {3, 1, 4, 2};
+    tree = tree_of(engine, left_inner, 4);
+    reset_tree_stats(tree);
+    tree_delete(tree, 4);
+    tree_stats(tree, &stats);
+    CHECK(stats.rotations_by_type[ROTATION_LR] == 1 && stats.rotations == 2);
+    CHECK(stats.rotations_by_type[ROTATION_LL] == 0 && stats.rotations_by_type[ROTATION_RR] == 0);
+    CHECK(tree->root->key == 2);
+    destroy_tree(tree);
+}
+
+// Ascending inserts: one RR case per rotation, and the other counters move
+static void cumulative_counts(BalanceEngine engine)
+{
+    AVLTree *tree = create_tree(engine);
+    for (int i = 0; i < 1023; i++)
+        tree_insert(tree, i);
+
+    TreeStats stats;
+    tree_stats(tree, &stats);
+    CHECK(stats.rotations_by_type[ROTATION_RR] == stats.rotations);
+    CHECK(stats.rotations_by_type[ROTATION_LL] == 0 && stats.rotations_by_type[ROTATION_LR] == 0);
+    CHECK(stats.rotations > 0 && stats.retrace_steps > 0 && stats.height_changes > 0);
+
+    CHECK(tree_search(tree, 0) != NULL);
+    tree_stats(tree, &stats);
+    CHECK(stats.searches == 1 && stats.search_visits == 10);
+
+    reset_tree_stats(tree);
+    tree_stats(tree, &stats);
+    CHECK(stats.rotations == 0 && stats.searches == 0 && stats.rotations_by_type[ROTATION_RR] == 0);
+    destroy_tree(tree);
+}
+
+int main(void)
+{
+    BalanceEngine engines[] = {ENGINE_AVL, ENGINE_WAVL};
+    for (size_t i = 0; i < sizeof(engines) / sizeof(engines[0]); i++)
+    {
+        insert_cases(engines[i]);
+        delete_cases(engines[i]);
+        cumulative_counts(engines[i]);
+    }
+
+    if (failures == 0)
+        printf("rotation counter tests passed\n");
+    return failures != 0;
+}
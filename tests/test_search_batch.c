@@ -0,0 +1,123 @@
+#include "key_index.h"
+
+#include <stdio.h>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                   \
+    do                                                                \
+    {                                                                 \
+        if (!(cond))                                                  \
+        {                                                             \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                               \
+        }                                                             \
+    } while (0)
+
+#define KEYS 1000
+#define QUERIES 333 // not a multiple of SEARCH_BATCH_GROUP
+
+// Even keys 0..2*KEYS-2 in scrambled order
+static AVLTree *even_tree(BalanceEngine engine)
+{
+    AVLTree *tree = create_tree(engine);
+    for (int i = 0; i < KEYS; i++)
+        tree_insert(tree, 2 * ((i * 7919) % KEYS));
+    return tree;
+}
+
+// Every batch answer matches a single lookup; raw_ok says whether the
+// node search_node finds should be returned as is (no tombstones hidden)
+static void check_batch(AVLTree *tree, int raw_ok)
+{
+    int keys[QUERIES];
+    AVLNode *found[QUERIES];
+    unsigned int rng = 7;
+    for (int i = 0; i < QUERIES; i++)
+    {
+        rng = rng * 1103515245u + 12345u;
+        keys[i] = (int)((rng >> 8) % (2 * KEYS + 20)) - 10; // some absent
+    }
+
+    TreeStats before, after;
+    tree_stats(tree, &before);
+    tree_search_batch(tree, keys, QUERIES, found);
+    tree_stats(tree, &after);
+    CHECK(after.searches == before.searches + QUERIES);
+
+    for (int i = 0; i < QUERIES; i++)
+    {
+        AVLNode *raw = search_node(tree->root, keys[i]);
+        CHECK(found[i] == tree_search(tree, keys[i]));
+        if (raw_ok)
+            CHECK(found[i] == raw);
+        else
+            CHECK(found[i] == NULL || found[i] == raw);
+        CHECK(found[i] == NULL || found[i]->key == keys[i]);
+    }
+}
+
+static void plain_batch(BalanceEngine engine)
+{
+    AVLTree *tree = create_tree(engine);
+    int key = 1;
+    AVLNode *found = (AVLNode *)tree;
+    tree_search_batch(tree, &key, 1, &found);
+    CHECK(found == NULL);
+
+    destroy_tree(tree);
+    tree = even_tree(engine);
+    check_batch(tree, 1);
+    destroy_tree(tree);
+}
+
+// Tombstoned keys are found by search_node but not by either tree lookup
+static void lazy_batch(BalanceEngine engine)
+{
+    AVLTree *tree = even_tree(engine);
+    set_lazy_delete(tree, 1, 0.9);
+    for (int i = 0; i < KEYS; i += 3)
+        tree_delete(tree, 2 * i);
+    CHECK(tree->tombstones > 0);
+
+    int gone = 6;
+    AVLNode *found;
+    tree_search_batch(tree, &gone, 1, &found);
+    CHECK(found == NULL && search_node(tree->root, gone) != NULL);
+    check_batch(tree, 0);
+    destroy_tree(tree);
+}
+
+// The index answers leading keys; the rest fall through to the tree
+static void indexed_batch(BalanceEngine engine)
+{
+    AVLTree *tree = even_tree(engine);
+    CHECK(tree_enable_index(tree));
+    check_batch(tree, 1);
+
+    for (int i = 0; i < KEYS; i += 5)
+        tree_delete(tree, 2 * i);
+    CHECK(index_in_step(tree));
+    check_batch(tree, 1);
+
+    set_lazy_delete(tree, 1, 0.9);
+    for (int i = 1; i < KEYS; i += 5)
+        tree_delete(tree, 2 * i);
+    check_batch(tree, 0);
+    destroy_tree(tree);
+}
+
+int main(void)
+{
+    BalanceEngine engines[] = {ENGINE_AVL, ENGINE_WAVL};
+    for (size_t i = 0; i < sizeof(engines) / sizeof(engines[0]); i++)
+    {
+        plain_batch(engines[i]);
+        lazy_batch(engines[i]);
+        indexed_batch(engines[i]);
+    }
+
+    if (failures == 0)
+        printf("search batch tests passed\n");
+    return failures != 0;
+}
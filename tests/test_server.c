@@ -0,0 +1,213 @@
+#define _GNU_SOURCE
+
+#include "../tools/tree_protocol.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// Round trip through avl_server: tests/test_server [path to avl_server]
+
+static int failures = 0;
+
+#define CHECK(cond)                                                   \
+    do                                                                \
+    {                                                                 \
+        if (!(cond))                                                  \
+        {                                                             \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                               \
+        }                                                             \
+    } while (0)
+
+#define KEYS 5000
+#define MAX_REQUESTS (KEYS + 64)
+
+static ProtoRequest requests[MAX_REQUESTS];
+static int nrequests;
+
+static void sleep_ms(long ms)
+{
+    struct timespec ts = {ms / 1000, (ms % 1000) * 1000000L};
+    nanosleep(&ts, NULL);
+}
+
+static void add(uint8_t op, int32_t key, int32_t hi)
+{
+    ProtoRequest req = {op, {0, 0, 0}, (uint32_t)nrequests, key, hi};
+    requests[nrequests++] = req;
+}
+
+static int send_all(int fd, const void *data, size_t len)
+{
+    const char *p = data;
+    while (len > 0)
+    {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n <= 0)
+            return 0;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
+
+static int recv_all(int fd, void *data, size_t len)
+{
+    char *p = data;
+    while (len > 0)
+    {
+        ssize_t n = recv(fd, p, len, 0);
+        if (n <= 0)
+            return 0;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
+
+// Keep trying until the server is listening or has exited
+static int connect_server(const char *path, pid_t server)
+{
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+    for (int tries = 0; tries < 500; tries++)
+    {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+            return fd;
+        if (fd >= 0)
+            close(fd);
+        if (waitpid(server, NULL, WNOHANG) == server)
+            return -1;
+        sleep_ms(10);
+    }
+    return -1;
+}
+
+// Read reply i and check its header; returns the key count
+static uint32_t expect_reply(int fd, int i, uint8_t status)
+{
+    ProtoReply reply;
+    if (!recv_all(fd, &reply, sizeof(reply)))
+    {
+        fprintf(stderr, "reply %d: connection closed\n", i);
+        failures++;
+        exit(1);
+    }
+    CHECK(reply.id == (uint32_t)i && reply.op == requests[i].op);
+    if (reply.status != status)
+    {
+        fprintf(stderr, "reply %d: status %d, expected %d\n", i, reply.status, status);
+        failures++;
+    }
+    return reply.count;
+}
+
+// A range reply must hold the live keys from lo upwards, in order
+static void expect_range(int fd, int i, uint8_t status, uint32_t count, int32_t lo)
+{
+    uint32_t got = expect_reply(fd, i, status);
+    CHECK(got == count);
+    int32_t expect = lo;
+    for (uint32_t k = 0; k < got; k++)
+    {
+        int32_t key;
+        if (!recv_all(fd, &key, sizeof(key)))
+        {
+            failures++;
+            return;
+        }
+        if (expect == 7)
+            expect++;
+        CHECK(key == expect);
+        expect++;
+    }
+}
+
+static void round_trip(int fd)
+{
+    // Everything goes out before the first reply is read
+    for (int k = 0; k < KEYS; k++)
+        add(PROTO_INSERT, k, 0);
+    add(PROTO_INSERT, 7, 0);
+    add(PROTO_SEARCH, 7, 0);
+    add(PROTO_SEARCH, KEYS, 0);
+    add(PROTO_DELETE, 7, 0);
+    add(PROTO_DELETE, 7, 0);
+    add(PROTO_SEARCH, 7, 0);
+    add(PROTO_RANGE, 0, 9);
+    add(PROTO_RANGE, 0, KEYS);      // more than the limit: partial
+    add(PROTO_RANGE, 1, 4097);      // exactly the limit: complete
+    add(PROTO_RANGE, KEYS - 10, KEYS + 100);
+    add(PROTO_RANGE, KEYS, KEYS + 100);
+    add(99, 0, 0);
+    add(PROTO_SEARCH, KEYS - 1, 0);
+
+    // Split the last frame so the server sees half of it first
+    size_t bytes = (size_t)nrequests * sizeof(ProtoRequest);
+    CHECK(send_all(fd, requests, bytes - 5));
+    sleep_ms(50);
+    CHECK(send_all(fd, (char *)requests + bytes - 5, 5));
+
+    int i = 0;
+    for (; i < KEYS; i++)
+        expect_reply(fd, i, PROTO_OK);
+    expect_reply(fd, i++, PROTO_MISS);
+    expect_reply(fd, i++, PROTO_OK);
+    expect_reply(fd, i++, PROTO_MISS);
+    expect_reply(fd, i++, PROTO_OK);
+    expect_reply(fd, i++, PROTO_MISS);
+    expect_reply(fd, i++, PROTO_MISS);
+    expect_range(fd, i++, PROTO_OK, 9, 0);
+    expect_range(fd, i++, PROTO_PARTIAL, PROTO_RANGE_LIMIT, 0);
+    expect_range(fd, i++, PROTO_OK, PROTO_RANGE_LIMIT, 1);
+    expect_range(fd, i++, PROTO_OK, 10, KEYS - 10);
+    expect_range(fd, i++, PROTO_OK, 0, KEYS);
+    expect_reply(fd, i++, PROTO_BAD_OP);
+    expect_reply(fd, i++, PROTO_OK);
+    CHECK(i == nrequests);
+}
+
+int main(int argc, char **argv)
+{
+    const char *server_bin = argc > 1 ? argv[1] : "build/avl_server";
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/avl_server_test.%ld.sock", (long)getpid());
+
+    pid_t server = fork();
+    if (server == 0)
+    {
+        freopen("/dev/null", "w", stderr);
+        execl(server_bin, server_bin, path, (char *)NULL);
+        _exit(127);
+    }
+    int fd = server > 0 ? connect_server(path, server) : -1;
+    if (fd < 0)
+    {
+        fprintf(stderr, "cannot start %s\n", server_bin);
+        if (server > 0)
+            kill(server, SIGKILL);
+        return 1;
+    }
+
+    round_trip(fd);
+    close(fd);
+
+    // SIGTERM stops the server cleanly and removes its socket
+    int status = 0;
+    kill(server, SIGTERM);
+    CHECK(waitpid(server, &status, 0) == server);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    CHECK(access(path, F_OK) != 0);
+
+    if (failures == 0)
+        printf("server tests passed\n");
+    return failures != 0;
+}
@@ -0,0 +1,166 @@
+#include "sharded_tree.h"
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                   \
+    do                                                                \
+    {                                                                 \
+        if (!(cond))                                                  \
+        {                                                             \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                               \
+        }                                                             \
+    } while (0)
+
+#define MAX_KEYS 40000
+
+static int range_buf[MAX_KEYS];
+
+// Exactly the keys in [0, n) with (key % step == 0), in order, across shards
+static int holds_multiples(ShardedTree *st, int n, int step)
+{
+    size_t count = sharded_range(st, INT_MIN, INT_MAX, range_buf, MAX_KEYS);
+    if (count != (size_t)((n + step - 1) / step) || sharded_size(st) != count)
+        return 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (range_buf[i] != (int)i * step)
+            return 0;
+    }
+    return 1;
+}
+
+// Lower bounds ascend and the sizes add up
+static int layout_consistent(ShardedTree *st)
+{
+    int lower[64];
+    size_t sizes[64], total = 0;
+    size_t n = sharded_layout(st, lower, sizes, 64);
+    for (size_t i = 0; i < n; i++)
+    {
+        if (i > 0 && lower[i] <= lower[i - 1])
+            return 0;
+        total += sizes[i];
+    }
+    return n > 0 && lower[0] == INT_MIN && total == sharded_size(st);
+}
+
+static void routing(BalanceEngine engine)
+{
+    ShardConfig config = {engine, 4, 0, 0, 3999, 64, 0};
+    ShardedTree *st = sharded_create(&config);
+    for (int i = 0; i < 4000; i++)
+        CHECK(sharded_insert(st, (i * 7919) % 4000));
+    CHECK(!sharded_insert(st, 17));
+    CHECK(sharded_insert(st, -5) && sharded_insert(st, 100000));
+
+    int lower[8];
+    size_t sizes[8];
+    CHECK(sharded_layout(st, lower, sizes, 8) == 4);
+    CHECK(lower[0] == INT_MIN && lower[1] == 1000 && lower[2] == 2000 && lower[3] == 3000);
+    CHECK(sizes[0] == 1001 && sizes[1] == 1000 && sizes[2] == 1000 && sizes[3] == 1001);
+
+    CHECK(sharded_contains(st, -5) && sharded_contains(st, 2999) && !sharded_contains(st, 4000));
+    CHECK(sharded_delete(st, -5) && sharded_delete(st, 100000) && !sharded_delete(st, -5));
+
+    // A range crossing shard boundaries comes back sorted
+    CHECK(sharded_range(st, 990, 2010, range_buf, MAX_KEYS) == 1021);
+    CHECK(range_buf[0] == 990 && range_buf[1020] == 2010);
+    CHECK(sharded_range(st, 990, 2010, range_buf, 5) == 5 && range_buf[4] == 994);
+    CHECK(holds_multiples(st, 4000, 1));
+    sharded_destroy(st);
+}
+
+// Skew splits the crowded shard (over several handoff batches), and
+// emptied neighbours merge again
+static void rebalance(BalanceEngine engine)
+{
+    ShardConfig config = {engine, 4, 0, 0, 3999, 64, 0};
+    ShardedTree *st = sharded_create(&config);
+    for (int i = 0; i < MAX_KEYS; i++)
+        sharded_insert(st, i);
+
+    CHECK(sharded_rebalance(st) > 0);
+    unsigned long splits, merges;
+    sharded_counts(st, &splits, &merges);
+    CHECK(splits > 0);
+    CHECK(layout_consistent(st));
+    CHECK(holds_multiples(st, MAX_KEYS, 1));
+
+    size_t sizes[64];
+    size_t n = sharded_layout(st, NULL, sizes, 64);
+    CHECK(n > 1);
+    for (size_t i = 0; i < n && i < 64; i++)
+        CHECK(sizes[i] <= 2 * MAX_KEYS / 4);
+
+    // Moved keys stay writable from their new shard
+    for (int i = 0; i < MAX_KEYS; i++)
+    {
+        if (i % 10 != 0)
+            sharded_delete(st, i);
+    }
+    sharded_rebalance(st);
+    sharded_counts(st, &splits, &merges);
+    CHECK(merges > 0);
+    CHECK(layout_consistent(st));
+    CHECK(holds_multiples(st, MAX_KEYS, 10));
+    sharded_destroy(st);
+}
+
+typedef struct
+{
+    ShardedTree *st;
+    int first;
+    int step;
+} Writer;
+
+static void *write_keys(void *arg)
+{
+    Writer *w = (Writer *)arg;
+    for (int key = w->first; key < MAX_KEYS; key += w->step)
+        sharded_insert(w->st, key);
+    return NULL;
+}
+
+// Writers racing the automatic re-cuts lose no keys
+static void concurrent_writers(BalanceEngine engine)
+{
+    ShardConfig config = {engine, 8, 0, 0, 8 * MAX_KEYS, 256, 1};
+    ShardedTree *st = sharded_create(&config);
+
+    pthread_t ids[4];
+    Writer writers[4];
+    for (int t = 0; t < 4; t++)
+    {
+        writers[t] = (Writer){st, t, 4};
+        pthread_create(&ids[t], NULL, write_keys, &writers[t]);
+    }
+    for (int t = 0; t < 4; t++)
+        pthread_join(ids[t], NULL);
+
+    unsigned long splits, merges;
+    sharded_counts(st, &splits, &merges);
+    CHECK(splits > 0);
+    CHECK(layout_consistent(st));
+    CHECK(holds_multiples(st, MAX_KEYS, 1));
+    sharded_destroy(st);
+}
+
+int main(void)
+{
+    BalanceEngine engines[] = {ENGINE_AVL, ENGINE_WAVL};
+    for (size_t i = 0; i < sizeof(engines) / sizeof(engines[0]); i++)
+    {
+        routing(engines[i]);
+        rebalance(engines[i]);
+        concurrent_writers(engines[i]);
+    }
+
+    if (failures == 0)
+        printf("sharded tree tests passed\n");
+    return failures != 0;
+}
@@ -0,0 +1,95 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "shm_tree.h"
+
+#include <stdio.h>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+static int failures = 0;
+
+#define CHECK(cond)                                                   \
+    do                                                                \
+    {                                                                 \
+        if (!(cond))                                                  \
+        {                                                             \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                               \
+        }                                                             \
+    } while (0)
+
+#ifndef _WIN32
+// Readers cannot attach while the writer is still building the tree
+static void unpublished_segment_refuses_readers(void)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "/avl_test_publish_%ld", (long)getpid());
+    ShmTree *writer = shm_tree_create(name, 64, ENGINE_AVL);
+    CHECK(writer != NULL);
+    if (writer == NULL)
+        return;
+    AVLTree *tree = shm_tree_handle(writer);
+    for (int i = 0; i < 10; i++)
+        tree_insert(tree, i);
+    CHECK(shm_tree_attach(name) == NULL);
+
+    shm_tree_publish(writer);
+    ShmTree *reader = shm_tree_attach(name);
+    CHECK(reader != NULL);
+    if (reader != NULL)
+    {
+        CHECK(shm_tree_size(reader) == 10 && shm_tree_search(reader, 9) == 1);
+        shm_tree_detach(reader);
+    }
+    shm_tree_detach(writer);
+    shm_tree_unlink(name);
+}
+
+// A writer that never finishes its update must not hang readers
+static void stalled_writer_times_out(void)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "/avl_test_stall_%ld", (long)getpid());
+    ShmTree *writer = shm_tree_create(name, 64, ENGINE_AVL);
+    CHECK(writer != NULL);
+    if (writer == NULL)
+        return;
+    for (int i = 0; i < 10; i++)
+        shm_tree_insert(writer, i);
+    shm_tree_publish(writer);
+
+    ShmTree *reader = shm_tree_attach(name);
+    CHECK(reader != NULL);
+    if (reader != NULL)
+    {
+        CHECK(shm_tree_search(reader, 3) == 1);
+        CHECK(shm_tree_size(reader) == 10);
+
+        shm_write_begin(writer); // and the writer "dies" here
+        ShmEntry entries[16];
+        CHECK(shm_tree_search(reader, 3) == -1);
+        CHECK(shm_tree_size(reader) == SHM_READ_FAILED);
+        CHECK(shm_tree_collect(reader, 0, 9, -1, entries, 16) == SHM_READ_FAILED);
+
+        shm_write_end(writer);
+        CHECK(shm_tree_collect(reader, 0, 9, -1, entries, 16) == 10);
+        shm_tree_detach(reader);
+    }
+    shm_tree_detach(writer);
+    shm_tree_unlink(name);
+}
+#endif
+
+int main(void)
+{
+#ifndef _WIN32
+    unpublished_segment_refuses_readers();
+    stalled_writer_times_out();
+#endif
+    if (failures == 0)
+        printf("shm tree tests passed\n");
+    return failures != 0;
+}
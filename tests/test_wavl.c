@@ -0,0 +1,108 @@
+#include "parallel_tree.h"
+
+#include <math.h>
+#include <stdio.h>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                   \
+    do                                                                \
+    {                                                                 \
+        if (!(cond))                                                  \
+        {                                                             \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                               \
+        }                                                             \
+    } while (0)
+
+#define KEY_SPACE 2000
+
+static int same_shape(const AVLNode *a, const AVLNode *b)
+{
+    if (a == NULL || b == NULL)
+        return a == b;
+    return a->key == b->key && a->height == b->height &&
+           same_shape(a->left, b->left) && same_shape(a->right, b->right);
+}
+
+static int tree_height(const AVLNode *node)
+{
+    if (node == NULL)
+        return 0;
+    int l = tree_height(node->left), r = tree_height(node->right);
+    return (l > r ? l : r) + 1;
+}
+
+// Random churn keeps the rank rules (validate_tree) and the key set
+static void churn_keeps_ranks(void)
+{
+    AVLTree *tree = create_tree(ENGINE_WAVL);
+    char present[KEY_SPACE] = {0};
+    unsigned int rng = 26;
+    for (int i = 0; i < 20000; i++)
+    {
+        rng = rng * 1103515245u + 12345u;
+        int key = (int)((rng >> 8) % KEY_SPACE);
+        // Deletions dominate the middle third, so the tree grows, shrinks
+        // and grows again
+        int erase = (i / 6667 == 1) ? (rng >> 4) % 4 != 0 : (rng >> 4) % 3 == 0;
+        if (erase)
+        {
+            CHECK(tree_delete(tree, key) == present[key]);
+            present[key] = 0;
+        }
+        else
+        {
+            CHECK(tree_insert(tree, key) == !present[key]);
+            present[key] = 1;
+        }
+        if (i % 500 == 0)
+            CHECK(validate_tree(tree, NULL));
+    }
+    CHECK(validate_tree(tree, NULL));
+
+    size_t live = 0;
+    for (int key = 0; key < KEY_SPACE; key++)
+    {
+        live += present[key];
+        CHECK((tree_search(tree, key) != NULL) == present[key]);
+    }
+    CHECK(tree->size == live);
+    // Rank-balanced trees stay within 2 log2(n) even after deletions
+    CHECK(tree_height(tree->root) <= 2 * (int)ceil(log2((double)live + 1)));
+
+    // Emptying it leaves a valid empty tree
+    for (int key = 0; key < KEY_SPACE; key++)
+        tree_delete(tree, key);
+    CHECK(tree->root == NULL && tree->size == 0);
+    destroy_tree(tree);
+}
+
+// Without deletions the ranks equal AVL heights and the trees match
+static void inserts_match_avl(void)
+{
+    AVLTree *wavl = create_tree(ENGINE_WAVL);
+    AVLTree *avl = create_tree(ENGINE_AVL);
+    unsigned int rng = 7;
+    for (int i = 0; i < 5000; i++)
+    {
+        rng = rng * 1103515245u + 12345u;
+        int key = (int)((rng >> 8) % 100000);
+        tree_insert(wavl, key);
+        tree_insert(avl, key);
+    }
+    CHECK(validate_tree(wavl, NULL) && validate_tree(avl, NULL));
+    CHECK(same_shape(wavl->root, avl->root));
+    destroy_tree(wavl);
+    destroy_tree(avl);
+}
+
+int main(void)
+{
+    churn_keeps_ranks();
+    inserts_match_avl();
+
+    if (failures == 0)
+        printf("wavl tests passed\n");
+    return failures != 0;
+}
@@ -0,0 +1,483 @@
+#include "avl_tree.h"
+#include "key_cache.h"
+#include "key_index.h"
+#include "split_join.h"
+#ifndef _WIN32
+#include "key_import.h"
+#include "shm_tree.h"
+#endif
+
+#include <ctype.h>
+#include <limits.h>
+#include <stdarg.h>
+
+// Headless command driver: one command per line from stdin or a file.
+//
+//   insert K | search K | delete K | range LO HI | delete_range LO HI | stats
+//   cache KEYS KIB TTL_MS
+//
+// Short forms i/s/d/r/dr are accepted, '#' starts a comment. Results are
+// collected in an output buffer and written in large batches. With --shm
+// the tree lives in a shared-memory segment that avl_shm_reader processes
+// can attach to; the segment is left in place on exit. --import loads a key
+// file (decimal text or little-endian int32) before any commands run.
+// --hash answers search, duplicate inserts and absent deletes from a hash
+// index (key_index.h). `cache` bounds the tree as an LRU/TTL cache from that
+// line on (key_cache.h, 0 = no limit).
+
+#define READ_CHUNK (1 << 16)
+#define WRITE_CHUNK (1 << 16)
+
+// Buffered input with a one-character cursor
+typedef struct
+{
+    FILE *fp;
+    char buf[READ_CHUNK];
+    size_t pos;
+    size_t len;
+    long line;
+} Reader;
+
+// Batched output
+typedef struct
+{
+    char buf[WRITE_CHUNK];
+    size_t len;
+} Writer;
+
+static int reader_peek(Reader *r)
+{
+    if (r->pos == r->len)
+    {
+        r->len = fread(r->buf, 1, sizeof(r->buf), r->fp);
+        r->pos = 0;
+        if (r->len == 0)
+            return EOF;
+    }
+    return (unsigned char)r->buf[r->pos];
+}
+
+static int reader_get(Reader *r)
+{
+    int c = reader_peek(r);
+    if (c != EOF)
+        r->pos++;
+    return c;
+}
+
+// Skip blanks but stop at end of line
+static void skip_blanks(Reader *r)
+{
+    int c;
+    while ((c = reader_peek(r)) == ' ' || c == '\t' || c == '\r')
+        r->pos++;
+}
+
+// Drop the rest of the current line
+static void skip_line(Reader *r)
+{
+    int c;
+    while ((c = reader_get(r)) != EOF && c != '\n')
+        ;
+    r->line++;
+}
+
+// Read a lowercase word (letters and '_') of at most cap - 1 characters
+static size_t read_word(Reader *r, char *word, size_t cap)
+{
+    size_t n = 0;
+    int c;
+    skip_blanks(r);
+    while ((c = reader_peek(r)) != EOF && (isalpha(c) || c == '_'))
+    {
+        if (n + 1 < cap)
+            word[n++] = (char)tolower(c);
+        r->pos++;
+    }
+    word[n] = '\0';
+    return n;
+}
+
+// Parse a signed decimal int ending at a blank, end of line or comment;
+// returns 0 on malformed or out-of-range input
+static int read_int(Reader *r, int *out)
+{
+    skip_blanks(r);
+    int c = reader_peek(r);
+    int negative = 0;
+    if (c == '-' || c == '+')
+    {
+        negative = c == '-';
+        r->pos++;
+        c = reader_peek(r);
+    }
+    if (c == EOF || !isdigit(c))
+        return 0;
+
+    long long value = 0;
+    while ((c = reader_peek(r)) != EOF && isdigit(c))
+    {
+        value = value * 10 + (c - '0');
+        if (value > (long long)INT_MAX + 1)
+            return 0;
+        r->pos++;
+    }
+    if (c != EOF && c != ' ' && c != '\t' && c != '\r' && c != '\n' && c != '#')
+        return 0;
+    if (negative)
+        value = -value;
+    if (value < INT_MIN || value > INT_MAX)
+        return 0;
+
+    *out = (int)value;
+    return 1;
+}
+
+static void writer_flush(Writer *w)
+{
+    fwrite(w->buf, 1, w->len, stdout);
+    w->len = 0;
+}
+
+static void writer_printf(Writer *w, const char *fmt, ...)
+{
+    size_t room = sizeof(w->buf) - w->len;
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(w->buf + w->len, room, fmt, args);
+    va_end(args);
+    if (n < 0)
+        return;
+    if ((size_t)n < room)
+    {
+        w->len += (size_t)n;
+        return;
+    }
+
+    // Truncated: flush what came before and format again, or write a line
+    // longer than the whole buffer straight through
+    writer_flush(w);
+    va_start(args, fmt);
+    if ((size_t)n < sizeof(w->buf))
+        w->len = (size_t)vsnprintf(w->buf, sizeof(w->buf), fmt, args);
+    else
+        vfprintf(stdout, fmt, args);
+    va_end(args);
+}
+
+static void print_stats(Writer *w, AVLTree *tree)
+{
+    TreeStats stats;
+    TreeMemory mem;
+    tree_stats(tree, &stats);
+    tree_memory(tree, &mem);
+    writer_printf(w, "engine=%s size=%zu height=%d inserts=%lu deletes=%lu searches=%lu "
+                     "rotations=%lu ll=%lu rr=%lu lr=%lu rl=%lu retrace=%lu visits=%lu "
+                     "height_changes=%lu tombstones=%zu compactions=%lu "
+                     "nodes=%zu peak_nodes=%zu requested=%zu reserved=%zu slack=%zu "
+                     "peak_reserved=%zu handle=%zu bytes_per_key=%.1f\n",
+                  engine_name(tree->engine), tree->size, height(tree->root),
+                  stats.inserts, stats.deletes, stats.searches, stats.rotations,
+                  stats.rotations_by_type[ROTATION_LL], stats.rotations_by_type[ROTATION_RR],
+                  stats.rotations_by_type[ROTATION_LR], stats.rotations_by_type[ROTATION_RL],
+                  stats.retrace_steps, stats.search_visits, stats.height_changes,
+                  stats.tombstones, stats.compactions,
+                  mem.live_nodes, mem.peak_nodes, mem.requested_bytes, mem.reserved_bytes,
+                  mem.reserved_bytes - mem.requested_bytes, mem.peak_reserved_bytes,
+                  mem.handle_bytes, tree_bytes_per_key(tree));
+    if (tree->cache)
+        writer_printf(w, "cache_limit=%zu evictions=%lu expirations=%lu\n", tree->cache->limit,
+                      tree->cache->evictions, tree->cache->expirations);
+}
+
+static void print_range(Writer *w, AVLTree *tree, int lo, int hi)
+{
+    TreeIterator it;
+    tree_iter_seek(&it, tree, lo);
+
+    size_t count = 0;
+    AVLNode *node;
+    while ((node = tree_iter_next(&it)) != NULL && node->key <= hi)
+    {
+        writer_printf(w, count ? " %d" : "%d", node->key);
+        count++;
+    }
+    writer_printf(w, count ? "\n" : "(empty)\n");
+}
+
+// Publishes mutations to shared-memory readers when shm is set
+typedef struct
+{
+    AVLTree *tree;
+#ifndef _WIN32
+    ShmTree *shm;
+#endif
+} Target;
+
+static void begin_write(Target *t)
+{
+#ifndef _WIN32
+    if (t->shm)
+        shm_write_begin(t->shm);
+#else
+    (void)t;
+#endif
+}
+
+static void end_write(Target *t)
+{
+#ifndef _WIN32
+    if (t->shm)
+        shm_write_end(t->shm);
+#else
+    (void)t;
+#endif
+}
+
+// Readers may attach once the initial tree is built
+static void publish(Target *t)
+{
+#ifndef _WIN32
+    if (t->shm)
+        shm_tree_publish(t->shm);
+#else
+    (void)t;
+#endif
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [--wavl] [--lazy RATIO] [--pool CHUNK] [--hash] [--quiet] [--shm NAME [--shm-nodes N]]\n"
+                    "          [--import KEYFILE [--import-chunk KEYS] [--import-format text|binary]] [FILE]\n",
+            prog);
+}
+
+int main(int argc, char **argv)
+{
+    BalanceEngine engine = ENGINE_AVL;
+    double lazy_ratio = 0.0;
+    int quiet = 0;
+    const char *path = NULL;
+    const char *shm_name = NULL;
+    size_t shm_nodes = 1 << 20;
+    size_t pool_chunk = 0;
+    int hash = 0;
+    const char *import_path = NULL;
+    size_t import_chunk = 0;
+    const char *import_format = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--wavl") == 0)
+            engine = ENGINE_WAVL;
+        else if (strcmp(argv[i], "--lazy") == 0 && i + 1 < argc)
+            lazy_ratio = atof(argv[++i]);
+        else if (strcmp(argv[i], "--quiet") == 0)
+            quiet = 1;
+        else if (strcmp(argv[i], "--hash") == 0)
+            hash = 1;
+        else if (strcmp(argv[i], "--pool") == 0 && i + 1 < argc && atol(argv[i + 1]) > 0)
+            pool_chunk = (size_t)atol(argv[++i]);
+        else if (strcmp(argv[i], "--shm") == 0 && i + 1 < argc)
+            shm_name = argv[++i];
+        else if (strcmp(argv[i], "--shm-nodes") == 0 && i + 1 < argc && atol(argv[i + 1]) > 0)
+            shm_nodes = (size_t)atol(argv[++i]);
+        else if (strcmp(argv[i], "--import") == 0 && i + 1 < argc)
+            import_path = argv[++i];
+        else if (strcmp(argv[i], "--import-chunk") == 0 && i + 1 < argc && atol(argv[i + 1]) > 0)
+            import_chunk = (size_t)atol(argv[++i]);
+        else if (strcmp(argv[i], "--import-format") == 0 && i + 1 < argc)
+            import_format = argv[++i];
+        else if (argv[i][0] == '-' && argv[i][1] != '\0')
+        {
+            usage(argv[0]);
+            return 2;
+        }
+        else
+            path = argv[i];
+    }
+
+    static Reader reader;
+    static Writer writer;
+    reader.fp = stdin;
+    reader.line = 1;
+    if (path && strcmp(path, "-") != 0)
+    {
+        reader.fp = fopen(path, "rb");
+        if (reader.fp == NULL)
+        {
+            perror(path);
+            return 2;
+        }
+    }
+
+    Target target = {0};
+    if (shm_name != NULL)
+    {
+#ifndef _WIN32
+        target.shm = shm_tree_create(shm_name, shm_nodes, engine);
+        if (target.shm == NULL)
+        {
+            perror(shm_name);
+            return 2;
+        }
+        target.tree = shm_tree_handle(target.shm);
+#else
+        fprintf(stderr, "--shm is not supported on this platform\n");
+        return 2;
+#endif
+    }
+    else
+    {
+        target.tree = create_tree(engine);
+        if (target.tree && pool_chunk)
+            tree_use_pool(target.tree, pool_chunk);
+    }
+
+    AVLTree *tree = target.tree;
+    if (tree == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 2;
+    }
+    if (lazy_ratio > 0.0)
+        set_lazy_delete(tree, 1, lazy_ratio);
+
+    if (import_path != NULL)
+    {
+#ifndef _WIN32
+        ImportOptions options = {IMPORT_AUTO, import_chunk};
+        if (import_format && strcmp(import_format, "text") == 0)
+            options.format = IMPORT_TEXT;
+        else if (import_format && strcmp(import_format, "binary") == 0)
+            options.format = IMPORT_BINARY;
+        else if (import_format)
+        {
+            usage(argv[0]);
+            return 2;
+        }
+
+        ImportStats st;
+        if (!tree_import_file(tree, import_path, &options, &st))
+        {
+            perror(import_path);
+            return 2;
+        }
+        fprintf(stderr,
+                "imported %s (%s): %zu keys, %zu new, %zu duplicate, %zu malformed in %.3f s"
+                " (%.1f MB/s, %.2f Mkeys/s, %zu/%zu chunks appended)\n",
+                import_path, import_format_name(st.format), st.keys, st.inserted, st.duplicates, st.malformed,
+                st.seconds, st.mb_per_sec, st.keys_per_sec / 1e6, st.appended_chunks, st.chunks);
+#else
+        (void)import_chunk;
+        (void)import_format;
+        fprintf(stderr, "--import is not supported on this platform\n");
+        return 2;
+#endif
+    }
+
+    // Built after the import so it is filled once
+    if (hash && !tree_enable_index(tree))
+    {
+        fprintf(stderr, "out of memory\n");
+        return 2;
+    }
+    publish(&target);
+
+    int errors = 0;
+    char word[16];
+    while (reader_peek(&reader) != EOF)
+    {
+        read_word(&reader, word, sizeof(word));
+        skip_blanks(&reader);
+        int c = reader_peek(&reader);
+
+        // Blank and comment lines
+        if (word[0] == '\0' && (c == '\n' || c == '#' || c == EOF))
+        {
+            skip_line(&reader);
+            continue;
+        }
+
+        int a, b, ttl;
+        if ((strcmp(word, "insert") == 0 || strcmp(word, "i") == 0) && read_int(&reader, &a))
+        {
+            begin_write(&target);
+            int added = tree_insert(tree, a);
+            end_write(&target);
+            if (!quiet)
+                writer_printf(&writer, added ? "ok\n" : "exists\n");
+        }
+        else if ((strcmp(word, "search") == 0 || strcmp(word, "s") == 0) && read_int(&reader, &a))
+        {
+            // Searches update counters and the cache, so they are writes too
+            begin_write(&target);
+            AVLNode *found = tree_search(tree, a);
+            end_write(&target);
+            if (!quiet)
+                writer_printf(&writer, found ? "found\n" : "missing\n");
+        }
+        else if ((strcmp(word, "delete") == 0 || strcmp(word, "d") == 0) && read_int(&reader, &a))
+        {
+            begin_write(&target);
+            int removed = tree_delete(tree, a);
+            end_write(&target);
+            if (!quiet)
+                writer_printf(&writer, removed ? "ok\n" : "missing\n");
+        }
+        else if ((strcmp(word, "range") == 0 || strcmp(word, "r") == 0) &&
+                 read_int(&reader, &a) && read_int(&reader, &b))
+        {
+            // Iteration does not check expiry, so clear expired keys first
+            if (tree->cache)
+            {
+                begin_write(&target);
+                tree_cache_sweep(tree, (size_t)-1);
+                end_write(&target);
+            }
+            print_range(&writer, tree, a, b);
+        }
+        else if ((strcmp(word, "delete_range") == 0 || strcmp(word, "dr") == 0) &&
+                 read_int(&reader, &a) && read_int(&reader, &b))
+        {
+            begin_write(&target);
+            size_t removed = tree_delete_range(tree, a, b);
+            end_write(&target);
+            if (!quiet)
+                writer_printf(&writer, "removed %zu\n", removed);
+        }
+        else if (strcmp(word, "cache") == 0 && read_int(&reader, &a) && read_int(&reader, &b) &&
+                 read_int(&reader, &ttl) && a >= 0 && b >= 0 && ttl >= 0)
+        {
+            CacheConfig config = {(size_t)a, (size_t)b * 1024, (uint64_t)ttl, NULL};
+            begin_write(&target);
+            int ok = tree_enable_cache(tree, &config);
+            end_write(&target);
+            if (!quiet)
+                writer_printf(&writer, ok ? "ok\n" : "failed\n");
+        }
+        else if (strcmp(word, "stats") == 0)
+        {
+            print_stats(&writer, tree);
+        }
+        else
+        {
+            writer_flush(&writer);
+            fflush(stdout);
+            fprintf(stderr, "line %ld: bad command\n", reader.line);
+            errors++;
+        }
+        skip_line(&reader);
+    }
+
+    writer_flush(&writer);
+    if (reader.fp != stdin)
+        fclose(reader.fp);
+#ifndef _WIN32
+    if (target.shm)
+        shm_tree_detach(target.shm);
+    else
+#endif
+        destroy_tree(tree);
+    return errors ? 1 : 0;
+}
\ No newline at end of file
@@ -0,0 +1,410 @@
+#define _GNU_SOURCE
+
+#include "tree_protocol.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+// Load generator for avl_server. For every combination of connection
+// count and pipeline depth it keeps `depth` requests in flight on each
+// connection until the operation budget is spent, then reports throughput
+// and latency percentiles. Latency runs from queuing a request to parsing
+// its reply, so it includes time spent waiting behind earlier requests.
+
+#define MAX_LIST 16
+#define MAX_DEPTH 4096
+#define IN_CAPACITY (1 << 17)
+
+typedef struct
+{
+    uint64_t rng;
+    int keys;       // keys are drawn from [0, keys)
+    int read_pct;   // searches; the rest splits evenly between insert and delete
+    int range_pct;  // short range scans taken out of the read share
+    int preloading; // sequential inserts of even keys
+    int next_key;
+    uint32_t next_id;
+} Workload;
+
+typedef struct
+{
+    int fd;
+    int depth;
+    int inflight;
+    uint64_t *sent_at; // ring of send times, replies arrive in order
+    int ring_head;
+    int ring_tail;
+    char *out;      // requests not yet accepted by the socket
+    size_t out_len; // bytes
+    size_t out_pos;
+    char *in;
+    size_t in_len;
+    int want_write;
+} Client;
+
+typedef struct
+{
+    uint64_t *latencies;
+    size_t completed;
+    size_t issued;
+    size_t total;
+    unsigned long misses;
+} Run;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// xorshift64*
+static uint64_t next_random(Workload *w)
+{
+    w->rng ^= w->rng >> 12;
+    w->rng ^= w->rng << 25;
+    w->rng ^= w->rng >> 27;
+    return w->rng * 2685821657736338717ull;
+}
+
+static void make_request(Workload *w, ProtoRequest *req)
+{
+    memset(req, 0, sizeof(*req));
+    req->id = w->next_id++;
+    if (w->preloading)
+    {
+        req->op = PROTO_INSERT;
+        req->key = w->next_key;
+        w->next_key += 2;
+        return;
+    }
+
+    int roll = (int)(next_random(w) % 100);
+    req->key = (int32_t)(next_random(w) % (uint64_t)w->keys);
+    if (roll < w->range_pct)
+    {
+        req->op = PROTO_RANGE;
+        req->hi = req->key + 64;
+    }
+    else if (roll < w->read_pct)
+        req->op = PROTO_SEARCH;
+    else if (roll < w->read_pct + (100 - w->read_pct) / 2)
+        req->op = PROTO_INSERT;
+    else
+        req->op = PROTO_DELETE;
+}
+
+static int connect_to(const char *path)
+{
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(path) >= sizeof(addr.sun_path))
+        return -1;
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+// Queue requests until the pipeline is full, then send them together
+static int top_up(Client *c, Workload *w, Run *run)
+{
+    // Unsent bytes belong to in-flight requests, so they always fit in front
+    memmove(c->out, c->out + c->out_pos, c->out_len - c->out_pos);
+    c->out_len -= c->out_pos;
+    c->out_pos = 0;
+    while (c->inflight < c->depth && run->issued < run->total)
+    {
+        ProtoRequest req;
+        make_request(w, &req);
+        memcpy(c->out + c->out_len, &req, sizeof(req));
+        c->out_len += sizeof(req);
+        c->sent_at[c->ring_head] = now_ns();
+        c->ring_head = (c->ring_head + 1) % c->depth;
+        c->inflight++;
+        run->issued++;
+    }
+
+    while (c->out_pos < c->out_len)
+    {
+        ssize_t n = send(c->fd, c->out + c->out_pos, c->out_len - c->out_pos, MSG_NOSIGNAL);
+        if (n > 0)
+            c->out_pos += (size_t)n;
+        else if (n < 0 && errno == EINTR)
+            continue;
+        else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        else
+            return 0;
+    }
+    return 1;
+}
+
+// Consume complete replies; returns 0 on error or disconnect
+static int drain_replies(Client *c, Run *run)
+{
+    for (;;)
+    {
+        ssize_t n = read(c->fd, c->in + c->in_len, IN_CAPACITY - c->in_len);
+        if (n > 0)
+            c->in_len += (size_t)n;
+        else if (n < 0 && errno == EINTR)
+            continue;
+        else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        else
+            return 0;
+        if (c->in_len == IN_CAPACITY)
+            break;
+    }
+
+    uint64_t now = now_ns();
+    size_t pos = 0;
+    while (c->in_len - pos >= sizeof(ProtoReply))
+    {
+        ProtoReply reply;
+        memcpy(&reply, c->in + pos, sizeof(reply));
+        size_t size = sizeof(reply) + (size_t)reply.count * sizeof(int32_t);
+        if (c->in_len - pos < size)
+            break;
+        pos += size;
+
+        if (reply.status == PROTO_MISS)
+            run->misses++;
+        run->latencies[run->completed++] = now - c->sent_at[c->ring_tail];
+        c->ring_tail = (c->ring_tail + 1) % c->depth;
+        c->inflight--;
+    }
+    memmove(c->in, c->in + pos, c->in_len - pos);
+    c->in_len -= pos;
+    return 1;
+}
+
+static int set_events(int ep, Client *c, int want_write)
+{
+    if (want_write == c->want_write)
+        return 1;
+    struct epoll_event ev = {.events = EPOLLIN | (want_write ? EPOLLOUT : 0), .data.ptr = c};
+    c->want_write = want_write;
+    return epoll_ctl(ep, EPOLL_CTL_MOD, c->fd, &ev) == 0;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile_us(const uint64_t *sorted, size_t n, double p)
+{
+    size_t i = (size_t)(p * (double)(n - 1));
+    return (double)sorted[i] / 1000.0;
+}
+
+// Drive `total` operations over `conns` connections; returns elapsed seconds or -1
+static double run_load(const char *path, int conns, int depth, size_t total, Workload *w, Run *run)
+{
+    Client *clients = calloc((size_t)conns, sizeof(Client));
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    double elapsed = -1.0;
+    if (clients == NULL || ep < 0)
+        goto done;
+
+    for (int i = 0; i < conns; i++)
+    {
+        Client *c = &clients[i];
+        c->fd = connect_to(path);
+        c->depth = depth;
+        c->sent_at = malloc((size_t)depth * sizeof(uint64_t));
+        c->out = malloc((size_t)depth * sizeof(ProtoRequest));
+        c->in = malloc(IN_CAPACITY);
+        struct epoll_event ev = {.events = EPOLLIN, .data.ptr = c};
+        if (c->fd < 0 || !c->sent_at || !c->out || !c->in || epoll_ctl(ep, EPOLL_CTL_ADD, c->fd, &ev) != 0)
+        {
+            fprintf(stderr, "cannot connect to %s\n", path);
+            goto done;
+        }
+    }
+
+    run->completed = run->issued = 0;
+    run->total = total;
+    run->misses = 0;
+
+    uint64_t start = now_ns();
+    for (int i = 0; i < conns; i++)
+    {
+        if (!top_up(&clients[i], w, run) || !set_events(ep, &clients[i], clients[i].out_pos < clients[i].out_len))
+            goto done;
+    }
+
+    struct epoll_event events[64];
+    while (run->completed < total)
+    {
+        int n = epoll_wait(ep, events, 64, 1000);
+        if (n < 0 && errno != EINTR)
+            goto done;
+        if (n == 0)
+        {
+            fprintf(stderr, "server stopped responding\n");
+            goto done;
+        }
+        for (int i = 0; i < n; i++)
+        {
+            Client *c = events[i].data.ptr;
+            if ((events[i].events & EPOLLIN) && !drain_replies(c, run))
+            {
+                fprintf(stderr, "connection lost\n");
+                goto done;
+            }
+            if (!top_up(c, w, run) || !set_events(ep, c, c->out_pos < c->out_len))
+                goto done;
+        }
+    }
+    elapsed = (double)(now_ns() - start) / 1e9;
+
+done:
+    if (ep >= 0)
+        close(ep);
+    for (int i = 0; clients && i < conns; i++)
+    {
+        if (clients[i].fd > 0)
+            close(clients[i].fd);
+        free(clients[i].sent_at);
+        free(clients[i].out);
+        free(clients[i].in);
+    }
+    free(clients);
+    return elapsed;
+}
+
+// Parse "1,4,16" into values; returns the count or 0 on bad input
+static int parse_list(const char *s, int *values)
+{
+    int n = 0;
+    while (*s && n < MAX_LIST)
+    {
+        char *end;
+        long v = strtol(s, &end, 10);
+        if (end == s || v < 1 || v > MAX_DEPTH)
+            return 0;
+        values[n++] = (int)v;
+        s = *end == ',' ? end + 1 : end;
+        if (*end != ',' && *end != '\0')
+            return 0;
+    }
+    return n;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [--conns LIST] [--depth LIST] [--ops N] [--keys N] [--read PCT] [--range PCT] "
+            "[--no-preload] SOCKET\n"
+            "  LIST is comma separated, e.g. --conns 1,4,16 --depth 1,8,64\n",
+            prog);
+}
+
+int main(int argc, char **argv)
+{
+    int conns[MAX_LIST] = {1, 4, 16};
+    int depths[MAX_LIST] = {1, 8, 64};
+    int conn_count = 3, depth_count = 3;
+    size_t ops = 200000;
+    int preload = 1;
+    Workload w = {.rng = 0x9E3779B97F4A7C15ull, .keys = 1 << 20, .read_pct = 80};
+    const char *path = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--conns") == 0 && val && (conn_count = parse_list(val, conns)) > 0)
+            i++;
+        else if (strcmp(arg, "--depth") == 0 && val && (depth_count = parse_list(val, depths)) > 0)
+            i++;
+        else if (strcmp(arg, "--ops") == 0 && val && atol(val) > 0)
+            ops = (size_t)atol(argv[++i]);
+        else if (strcmp(arg, "--keys") == 0 && val && atoi(val) > 0)
+            w.keys = atoi(argv[++i]);
+        else if (strcmp(arg, "--read") == 0 && val && atoi(val) >= 0 && atoi(val) <= 100)
+            w.read_pct = atoi(argv[++i]);
+        else if (strcmp(arg, "--range") == 0 && val && atoi(val) >= 0 && atoi(val) <= 100)
+            w.range_pct = atoi(argv[++i]);
+        else if (strcmp(arg, "--no-preload") == 0)
+            preload = 0;
+        else if (arg[0] != '-' && path == NULL)
+            path = arg;
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (path == NULL)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+    if (w.range_pct > w.read_pct)
+        w.range_pct = w.read_pct;
+
+    size_t preload_ops = preload ? (size_t)(w.keys + 1) / 2 : 0;
+    Run run;
+    run.latencies = malloc((ops > preload_ops ? ops : preload_ops) * sizeof(uint64_t));
+    if (run.latencies == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    // Half the key space is present, so searches hit about half the time
+    if (preload)
+    {
+        w.preloading = 1;
+        double t = run_load(path, 1, 64, preload_ops, &w, &run);
+        w.preloading = 0;
+        if (t < 0)
+            return 1;
+        printf("preloaded %zu keys in %.2f s\n", preload_ops, t);
+    }
+
+    printf("%6s %6s %12s %9s %9s %9s %9s %6s\n",
+           "conns", "depth", "ops/s", "p50 us", "p99 us", "p99.9 us", "max us", "miss%");
+    for (int ci = 0; ci < conn_count; ci++)
+    {
+        for (int di = 0; di < depth_count; di++)
+        {
+            double t = run_load(path, conns[ci], depths[di], ops, &w, &run);
+            if (t < 0)
+                return 1;
+            qsort(run.latencies, run.completed, sizeof(uint64_t), compare_u64);
+            printf("%6d %6d %12.0f %9.1f %9.1f %9.1f %9.1f %6.1f\n",
+                   conns[ci], depths[di], (double)run.completed / t,
+                   percentile_us(run.latencies, run.completed, 0.50),
+                   percentile_us(run.latencies, run.completed, 0.99),
+                   percentile_us(run.latencies, run.completed, 0.999),
+                   percentile_us(run.latencies, run.completed, 1.0),
+                   100.0 * (double)run.misses / (double)run.completed);
+            fflush(stdout);
+        }
+    }
+
+    free(run.latencies);
+    return 0;
+}
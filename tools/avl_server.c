@@ -0,0 +1,513 @@
+#define _GNU_SOURCE
+
+#include "avl_tree.h"
+#include "key_cache.h"
+#include "key_index.h"
+#include "relocate.h"
+#include "tree_protocol.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Tree server: one process owns the tree and serves requests from local
+// clients over a Unix domain socket (see tree_protocol.h).
+//
+// A single epoll loop drains each readable connection, answers every
+// complete request in that batch, then writes all replies with one send.
+// Runs of consecutive searches go through tree_search_batch. With
+// --relocate, once the tree has changed about as many times as it has keys
+// the loop polls instead of blocking and spends idle moments relocating the
+// nodes into van Emde Boas order (see relocate.h). --hash serves searches
+// from a hash index (key_index.h). --cache-keys, --cache-mb and --cache-ttl
+// bound the tree as an LRU/TTL cache (key_cache.h); PROTO_CACHE requests
+// change the limits while it runs.
+
+#define MAX_EVENTS 64
+#define READ_CHUNK (1 << 16)
+#define READ_LIMIT (1 << 20)     // unparsed input kept per connection
+#define OUT_HIGH_WATER (1 << 20) // stop reading while this much output is unsent
+#define SEARCH_RUN 256
+#define RELOCATE_STEP 4096 // nodes copied or freed per idle slice
+#define SWEEP_INTERVAL_MS 1000 // longest idle wait while keys can expire
+
+// Growable byte buffer; bytes before pos are already consumed
+typedef struct
+{
+    char *data;
+    size_t pos;
+    size_t len;
+    size_t cap;
+} Buffer;
+
+typedef struct
+{
+    int fd;
+    unsigned int events; // epoll mask currently registered
+    int closing;         // peer finished sending
+    Buffer in;
+    Buffer out;
+} Connection;
+
+typedef struct
+{
+    unsigned long requests;
+    unsigned long batches;
+    unsigned long connections;
+    unsigned long relocations;
+} ServerStats;
+
+static volatile sig_atomic_t g_stop = 0;
+
+static void on_signal(int sig)
+{
+    (void)sig;
+    g_stop = 1;
+}
+
+// Make room for n more bytes, dropping the consumed prefix first
+static int buffer_reserve(Buffer *b, size_t n)
+{
+    if (b->pos > 0)
+    {
+        memmove(b->data, b->data + b->pos, b->len - b->pos);
+        b->len -= b->pos;
+        b->pos = 0;
+    }
+    if (b->len + n <= b->cap)
+        return 1;
+
+    size_t cap = b->cap ? b->cap : READ_CHUNK;
+    while (cap < b->len + n)
+        cap *= 2;
+    char *data = realloc(b->data, cap);
+    if (data == NULL)
+        return 0;
+    b->data = data;
+    b->cap = cap;
+    return 1;
+}
+
+static int buffer_append(Buffer *b, const void *src, size_t n)
+{
+    if (b->len + n > b->cap && !buffer_reserve(b, n))
+        return 0;
+    memcpy(b->data + b->len, src, n);
+    b->len += n;
+    return 1;
+}
+
+static size_t pending(const Buffer *b)
+{
+    return b->len - b->pos;
+}
+
+static int put_reply(Connection *conn, const ProtoRequest *req, int status)
+{
+    ProtoReply reply = {req->op, (uint8_t)status, 0, req->id, 0};
+    return buffer_append(&conn->out, &reply, sizeof(reply));
+}
+
+// Header first, count patched once the keys are written
+static int put_range(Connection *conn, AVLTree *tree, const ProtoRequest *req)
+{
+    size_t header = conn->out.len;
+    if (!put_reply(conn, req, PROTO_OK))
+        return 0;
+
+    TreeIterator it;
+    tree_iter_seek(&it, tree, req->key);
+
+    uint32_t count = 0;
+    AVLNode *node;
+    while ((node = tree_iter_next(&it)) != NULL && node->key <= req->hi)
+    {
+        if (count == PROTO_RANGE_LIMIT)
+        {
+            conn->out.data[header + offsetof(ProtoReply, status)] = PROTO_PARTIAL;
+            break;
+        }
+        int32_t key = node->key;
+        if (!buffer_append(&conn->out, &key, sizeof(key)))
+            return 0;
+        count++;
+    }
+    memcpy(conn->out.data + header + offsetof(ProtoReply, count), &count, sizeof(count));
+    return 1;
+}
+
+// Answer consecutive search frames starting at frames[0] with one batched lookup
+static size_t run_searches(Connection *conn, AVLTree *tree, const char *frames, size_t avail)
+{
+    int keys[SEARCH_RUN];
+    ProtoRequest reqs[SEARCH_RUN];
+    AVLNode *found[SEARCH_RUN];
+
+    size_t n = 0;
+    while (n < SEARCH_RUN && n < avail)
+    {
+        memcpy(&reqs[n], frames + n * sizeof(ProtoRequest), sizeof(ProtoRequest));
+        if (reqs[n].op != PROTO_SEARCH)
+            break;
+        keys[n] = reqs[n].key;
+        n++;
+    }
+
+    tree_search_batch(tree, keys, n, found);
+    for (size_t i = 0; i < n; i++)
+    {
+        if (!put_reply(conn, &reqs[i], found[i] ? PROTO_OK : PROTO_MISS))
+            return 0;
+    }
+    return n;
+}
+
+// New key and memory limits for the cache, keeping its TTL; returns 0 if
+// the values are negative or the cache could not be set up
+static int configure_cache(AVLTree *tree, int max_keys, int max_kib)
+{
+    if (max_keys < 0 || max_kib < 0)
+        return 0;
+
+    CacheConfig config = {0, 0, 0, NULL};
+    if (tree->cache)
+        config = tree->cache->config;
+    config.max_keys = (size_t)max_keys;
+    config.max_bytes = (size_t)max_kib * 1024;
+    return tree_enable_cache(tree, &config);
+}
+
+// Answer every complete request buffered on the connection; returns 0 on
+// allocation failure
+static int process_requests(Connection *conn, AVLTree *tree, ServerStats *stats)
+{
+    Buffer *in = &conn->in;
+    size_t frames = pending(in) / sizeof(ProtoRequest);
+    size_t done = 0;
+
+    while (done < frames && pending(&conn->out) < OUT_HIGH_WATER)
+    {
+        const char *frame = in->data + in->pos + done * sizeof(ProtoRequest);
+        ProtoRequest req;
+        memcpy(&req, frame, sizeof(req));
+
+        int ok = 1;
+        size_t used = 1;
+        switch (req.op)
+        {
+        case PROTO_SEARCH:
+            used = run_searches(conn, tree, frame, frames - done);
+            ok = used > 0;
+            break;
+        case PROTO_INSERT:
+            ok = put_reply(conn, &req, tree_insert(tree, req.key) ? PROTO_OK : PROTO_MISS);
+            break;
+        case PROTO_DELETE:
+            ok = put_reply(conn, &req, tree_delete(tree, req.key) ? PROTO_OK : PROTO_MISS);
+            break;
+        case PROTO_RANGE:
+            // Iteration does not check expiry, so clear expired keys first
+            tree_cache_sweep(tree, (size_t)-1);
+            ok = put_range(conn, tree, &req);
+            break;
+        case PROTO_CACHE:
+            ok = put_reply(conn, &req, configure_cache(tree, req.key, req.hi) ? PROTO_OK : PROTO_MISS);
+            break;
+        default:
+            ok = put_reply(conn, &req, PROTO_BAD_OP);
+            break;
+        }
+        if (!ok)
+            return 0;
+        done += used;
+    }
+
+    in->pos += done * sizeof(ProtoRequest);
+    stats->requests += done;
+    return 1;
+}
+
+// Read everything the socket has ready; returns 0 on error
+static int read_batch(Connection *conn)
+{
+    while (pending(&conn->in) < READ_LIMIT)
+    {
+        if (!buffer_reserve(&conn->in, READ_CHUNK))
+            return 0;
+        ssize_t n = read(conn->fd, conn->in.data + conn->in.len, conn->in.cap - conn->in.len);
+        if (n > 0)
+        {
+            conn->in.len += (size_t)n;
+            continue;
+        }
+        if (n == 0)
+            conn->closing = 1;
+        else if (errno == EINTR)
+            continue;
+        else if (errno != EAGAIN && errno != EWOULDBLOCK)
+            return 0;
+        break;
+    }
+    return 1;
+}
+
+// Send as much queued output as the socket accepts; returns 0 on error
+static int flush_out(Connection *conn)
+{
+    Buffer *out = &conn->out;
+    while (pending(out) > 0)
+    {
+        ssize_t n = send(conn->fd, out->data + out->pos, pending(out), MSG_NOSIGNAL);
+        if (n > 0)
+        {
+            out->pos += (size_t)n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        return 0;
+    }
+    if (pending(out) == 0)
+        out->pos = out->len = 0;
+    return 1;
+}
+
+// Poll for input only while output is below the high-water mark
+static int update_events(int ep, Connection *conn)
+{
+    unsigned int events = 0;
+    if (!conn->closing && pending(&conn->out) < OUT_HIGH_WATER)
+        events |= EPOLLIN;
+    if (pending(&conn->out) > 0)
+        events |= EPOLLOUT;
+    if (events == conn->events)
+        return 1;
+
+    struct epoll_event ev = {.events = events, .data.ptr = conn};
+    conn->events = events;
+    return epoll_ctl(ep, EPOLL_CTL_MOD, conn->fd, &ev) == 0;
+}
+
+static void close_connection(int ep, Connection *conn)
+{
+    epoll_ctl(ep, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    free(conn->in.data);
+    free(conn->out.data);
+    free(conn);
+}
+
+static void accept_connections(int ep, int listener, ServerStats *stats)
+{
+    for (;;)
+    {
+        int fd = accept4(listener, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                perror("accept");
+            return;
+        }
+
+        Connection *conn = calloc(1, sizeof(Connection));
+        struct epoll_event ev = {.events = EPOLLIN, .data.ptr = conn};
+        if (conn == NULL || epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev) != 0)
+        {
+            free(conn);
+            close(fd);
+            continue;
+        }
+        conn->fd = fd;
+        conn->events = EPOLLIN;
+        stats->connections++;
+    }
+}
+
+// Handle one readiness event; returns 0 when the connection should close
+static int serve(int ep, Connection *conn, unsigned int events, AVLTree *tree, ServerStats *stats)
+{
+    if (events & EPOLLERR)
+        return 0;
+    if ((events & (EPOLLIN | EPOLLHUP)) && !conn->closing)
+    {
+        if (!read_batch(conn))
+            return 0;
+        stats->batches++;
+    }
+
+    // Replies for one batch go out together; leftover input resumes once
+    // the output drains below the high-water mark
+    if (!process_requests(conn, tree, stats) || !flush_out(conn))
+        return 0;
+    if (pending(&conn->out) < OUT_HIGH_WATER && pending(&conn->in) >= sizeof(ProtoRequest))
+    {
+        if (!process_requests(conn, tree, stats) || !flush_out(conn))
+            return 0;
+    }
+
+    if (conn->closing && pending(&conn->out) == 0 && pending(&conn->in) < sizeof(ProtoRequest))
+        return 0;
+    return update_events(ep, conn);
+}
+
+static int open_listener(const char *path)
+{
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "%s: socket path too long\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        perror("socket");
+        return -1;
+    }
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0)
+    {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [--wavl] [--lazy RATIO] [--relocate] [--hash] [--cache-keys N] [--cache-mb MB] "
+            "[--cache-ttl MS] SOCKET\n",
+            prog);
+}
+
+int main(int argc, char **argv)
+{
+    BalanceEngine engine = ENGINE_AVL;
+    double lazy_ratio = 0.0;
+    const char *path = NULL;
+    int relocate = 0;
+    int hash = 0;
+    CacheConfig cache = {0, 0, 0, NULL};
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--wavl") == 0)
+            engine = ENGINE_WAVL;
+        else if (strcmp(argv[i], "--lazy") == 0 && i + 1 < argc)
+            lazy_ratio = atof(argv[++i]);
+        else if (strcmp(argv[i], "--relocate") == 0)
+            relocate = 1;
+        else if (strcmp(argv[i], "--hash") == 0)
+            hash = 1;
+        else if (strcmp(argv[i], "--cache-keys") == 0 && i + 1 < argc && atol(argv[i + 1]) > 0)
+            cache.max_keys = (size_t)atol(argv[++i]);
+        else if (strcmp(argv[i], "--cache-mb") == 0 && i + 1 < argc && atol(argv[i + 1]) > 0)
+            cache.max_bytes = (size_t)atol(argv[++i]) << 20;
+        else if (strcmp(argv[i], "--cache-ttl") == 0 && i + 1 < argc && atol(argv[i + 1]) > 0)
+            cache.ttl_ms = (uint64_t)atol(argv[++i]);
+        else if (argv[i][0] == '-' || path != NULL)
+        {
+            usage(argv[0]);
+            return 2;
+        }
+        else
+            path = argv[i];
+    }
+    if (path == NULL)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    AVLTree *tree = create_tree(engine);
+    int listener = open_listener(path);
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event ev = {.events = EPOLLIN, .data.ptr = NULL};
+    if (tree == NULL || listener < 0 || ep < 0 || epoll_ctl(ep, EPOLL_CTL_ADD, listener, &ev) != 0)
+    {
+        fprintf(stderr, "failed to start server\n");
+        return 1;
+    }
+    if (lazy_ratio > 0.0)
+        set_lazy_delete(tree, 1, lazy_ratio);
+    int cached = cache.max_keys || cache.max_bytes || cache.ttl_ms;
+    if ((hash && !tree_enable_index(tree)) || (cached && !tree_enable_cache(tree, &cache)))
+    {
+        fprintf(stderr, "failed to start server\n");
+        return 1;
+    }
+    fprintf(stderr, "serving %s tree on %s\n", engine_name(engine), path);
+
+    ServerStats stats = {0};
+    struct epoll_event events[MAX_EVENTS];
+    Relocation *relocation = NULL;
+    unsigned long relocated_at = tree->version;
+    while (!g_stop)
+    {
+        int idle_work = relocate && (relocation != NULL || tree->version - relocated_at > tree->size + RELOCATE_STEP);
+        int expiring = tree->cache && tree->cache->config.ttl_ms;
+        int n = epoll_wait(ep, events, MAX_EVENTS, idle_work ? 0 : expiring ? SWEEP_INTERVAL_MS : -1);
+        if (expiring)
+            tree_cache_sweep(tree, RELOCATE_STEP);
+        if (n == 0 && idle_work)
+        {
+            if (relocation == NULL)
+                relocation = relocation_start(tree, LAYOUT_VEB);
+            RelocateStatus status = relocation ? relocation_step(relocation, RELOCATE_STEP) : RELOCATE_FAILED;
+            if (status != RELOCATE_RUNNING)
+            {
+                stats.relocations += status == RELOCATE_DONE;
+                relocation_free(relocation);
+                relocation = NULL;
+                relocated_at = tree->version;
+            }
+            continue;
+        }
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("epoll_wait");
+            break;
+        }
+        for (int i = 0; i < n; i++)
+        {
+            Connection *conn = events[i].data.ptr;
+            if (conn == NULL)
+                accept_connections(ep, listener, &stats);
+            else if (!serve(ep, conn, events[i].events, tree, &stats))
+                close_connection(ep, conn);
+        }
+    }
+
+    fprintf(stderr,
+            "served %lu requests in %lu batches over %lu connections (%.1f per batch), %zu keys, %lu relocations\n",
+            stats.requests, stats.batches, stats.connections,
+            stats.batches ? (double)stats.requests / (double)stats.batches : 0.0, tree->size, stats.relocations);
+    if (tree->cache)
+        fprintf(stderr, "cache evicted %lu keys, expired %lu\n", tree->cache->evictions, tree->cache->expirations);
+    close(ep);
+    close(listener);
+    unlink(path);
+    relocation_free(relocation);
+    destroy_tree(tree);
+    return 0;
+}
@@ -0,0 +1,225 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "shm_tree.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <unistd.h>
+
+// Read-only client for a tree published with `avl_cli --shm NAME`.
+// Every command runs directly against the shared mapping.
+//
+//   search K...   report found/missing for each key
+//   range LO HI   print live keys in [LO, HI]
+//   render [D]    draw the top D levels (default 5) sideways
+//   stats         size, capacity, engine, generation
+//   bench N       N random lookups, reporting rate and seqlock retries
+//   watch [MS]    print stats whenever the generation changes
+//   unlink        remove the segment name
+
+#define RENDER_LEVELS 5
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void report_stalled(void)
+{
+    fprintf(stderr, "writer left an update unfinished for over %d ms\n", SHM_READ_TIMEOUT_MS);
+}
+
+static int print_stats(ShmTree *shm)
+{
+    size_t size = shm_tree_size(shm);
+    if (size == SHM_READ_FAILED)
+    {
+        report_stalled();
+        return 0;
+    }
+    printf("engine=%s size=%zu capacity=%zu generation=%lu retries=%lu\n",
+           engine_name(shm_tree_engine(shm)), size, shm_tree_capacity(shm),
+           shm_tree_generation(shm), shm_tree_retries(shm));
+    return 1;
+}
+
+static int print_range(ShmTree *shm, int lo, int hi)
+{
+    size_t cap = shm_tree_capacity(shm);
+    ShmEntry *entries = (ShmEntry *)malloc(cap * sizeof(ShmEntry));
+    if (entries == NULL)
+        return 0;
+
+    size_t n = shm_tree_collect(shm, lo, hi, -1, entries, cap);
+    if (n == SHM_READ_FAILED)
+    {
+        free(entries);
+        report_stalled();
+        return 0;
+    }
+    for (size_t i = 0; i < n; i++)
+        printf(i ? " %d" : "%d", entries[i].key);
+    printf(n ? "\n" : "(empty)\n");
+    free(entries);
+    return 1;
+}
+
+// Right subtree on top, one node per line, indented by depth
+static int render(ShmTree *shm, int levels)
+{
+    size_t cap = ((size_t)1 << levels) - 1;
+    ShmEntry *entries = (ShmEntry *)malloc(cap * sizeof(ShmEntry));
+    if (entries == NULL)
+        return 0;
+
+    size_t n = shm_tree_collect(shm, INT_MIN, INT_MAX, levels - 1, entries, cap);
+    if (n == SHM_READ_FAILED)
+    {
+        free(entries);
+        report_stalled();
+        return 0;
+    }
+    for (size_t i = n; i-- > 0;)
+        printf("%*s%d\n", entries[i].depth * 6, "", entries[i].key);
+    if (n == 0)
+        printf("(empty)\n");
+    free(entries);
+    return 1;
+}
+
+static int bench(ShmTree *shm, long lookups)
+{
+    size_t size = shm_tree_size(shm);
+    if (size == SHM_READ_FAILED)
+    {
+        report_stalled();
+        return 0;
+    }
+    uint64_t span = size ? 2 * (uint64_t)size : 1;
+    uint64_t rng = 0x9E3779B97F4A7C15ull;
+    unsigned long before = shm_tree_retries(shm);
+    long found = 0;
+
+    double start = now_seconds();
+    for (long i = 0; i < lookups; i++)
+    {
+        rng ^= rng >> 12;
+        rng ^= rng << 25;
+        rng ^= rng >> 27;
+        int hit = shm_tree_search(shm, (int)((rng * 2685821657736338717ull) % span));
+        if (hit < 0)
+        {
+            report_stalled();
+            return 0;
+        }
+        found += hit;
+    }
+    double elapsed = now_seconds() - start;
+
+    printf("%ld lookups in %.3f s (%.0f/s), %ld found, %lu retries\n", lookups, elapsed,
+           (double)lookups / elapsed, found, shm_tree_retries(shm) - before);
+    return 1;
+}
+
+// Returns only if the writer stalls
+static int watch(ShmTree *shm, long interval_ms)
+{
+    unsigned long seen = ~0ul;
+    struct timespec pause = {interval_ms / 1000, (interval_ms % 1000) * 1000000L};
+    for (;;)
+    {
+        unsigned long generation = shm_tree_generation(shm);
+        if (generation != seen)
+        {
+            if (!print_stats(shm))
+                return 0;
+            fflush(stdout);
+            seen = generation;
+        }
+        nanosleep(&pause, NULL);
+    }
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s NAME search K... | range LO HI | render [LEVELS] | stats | bench N | watch [MS] | unlink\n",
+            prog);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+    const char *name = argv[1];
+    const char *cmd = argv[2];
+
+    if (strcmp(cmd, "unlink") == 0)
+    {
+        if (!shm_tree_unlink(name))
+        {
+            perror(name);
+            return 1;
+        }
+        return 0;
+    }
+
+    ShmTree *shm = shm_tree_attach(name);
+    if (shm == NULL)
+    {
+        fprintf(stderr, "%s: cannot attach shared tree (missing or not yet published)\n", name);
+        return 1;
+    }
+
+    int status = 0;
+    if (strcmp(cmd, "search") == 0 && argc > 3)
+    {
+        for (int i = 3; i < argc && status == 0; i++)
+        {
+            int found = shm_tree_search(shm, atoi(argv[i]));
+            if (found < 0)
+            {
+                report_stalled();
+                status = 1;
+            }
+            else
+            {
+                printf("%s\n", found ? "found" : "missing");
+            }
+        }
+    }
+    else if (strcmp(cmd, "range") == 0 && argc == 5)
+    {
+        status = !print_range(shm, atoi(argv[3]), atoi(argv[4]));
+    }
+    else if (strcmp(cmd, "render") == 0 && argc <= 4)
+    {
+        int levels = argc == 4 ? atoi(argv[3]) : RENDER_LEVELS;
+        status = levels < 1 || levels > 20 || !render(shm, levels);
+    }
+    else if (strcmp(cmd, "stats") == 0)
+    {
+        status = !print_stats(shm);
+    }
+    else if (strcmp(cmd, "bench") == 0 && argc == 4 && atol(argv[3]) > 0)
+    {
+        status = !bench(shm, atol(argv[3]));
+    }
+    else if (strcmp(cmd, "watch") == 0 && argc <= 4)
+    {
+        status = !watch(shm, argc == 4 && atol(argv[3]) > 0 ? atol(argv[3]) : 200);
+    }
+    else
+    {
+        usage(argv[0]);
+        status = 2;
+    }
+
+    shm_tree_detach(shm);
+    return status;
+}
@@ -0,0 +1,53 @@
+#ifndef TREE_PROTOCOL_H
+#define TREE_PROTOCOL_H
+
+#include <stdint.h>
+
+// Binary protocol spoken by avl_server over a Unix domain socket.
+//
+// Every request is one fixed-size frame; every reply is a fixed header
+// optionally followed by `count` keys. Clients may send any number of
+// requests before reading replies (pipelining); replies come back in
+// request order and echo the request id. Both ends live on the same host,
+// so fields use native byte order.
+
+#define PROTO_RANGE_LIMIT 4096 // most keys returned by a single range reply
+
+// Request opcodes
+enum
+{
+    PROTO_INSERT = 1,
+    PROTO_SEARCH = 2,
+    PROTO_DELETE = 3,
+    PROTO_RANGE = 4,
+    PROTO_CACHE = 5 // key = most keys, hi = memory limit in KiB (0 = none)
+};
+
+// Reply status codes
+enum
+{
+    PROTO_OK = 0,       // inserted, found, deleted, complete range or cache set
+    PROTO_MISS = 1,     // already present (insert), absent (search/delete) or bad limits
+    PROTO_PARTIAL = 2,  // range stopped at PROTO_RANGE_LIMIT keys
+    PROTO_BAD_OP = 3
+};
+
+typedef struct
+{
+    uint8_t op;
+    uint8_t reserved[3];
+    uint32_t id;
+    int32_t key; // key, or low bound of a range
+    int32_t hi;  // high bound of a range, ignored otherwise
+} ProtoRequest;
+
+typedef struct
+{
+    uint8_t op;
+    uint8_t status;
+    uint16_t reserved;
+    uint32_t id;
+    uint32_t count; // keys following the header (range only)
+} ProtoReply;
+
+#endif // TREE_PROTOCOL_H